@@ -6,6 +6,8 @@
 #include <stdexcept>
 #include <functional>
 
+#include "../cpp_impl/options.h"
+
 // RAII 包装器
 class Hdf5Handle {
     hid_t id_;
@@ -19,14 +21,34 @@ public:
     operator hid_t() const { return id_; }
 };
 
-int main() {
+// 以页缓冲方式打开按页分配的文件, 元数据的小读取合并成整页读取;
+// 页缓冲只能用于按页分配的文件, 其他文件或buffer_size为0时按默认方式打开
+hid_t open_paged(const std::string& filename, size_t buffer_size) {
+    if (buffer_size > 0) {
+        Hdf5Handle fapl(H5Pcreate(H5P_FILE_ACCESS), H5Pclose);
+        if (H5Pset_page_buffer_size(fapl, buffer_size, 0, 0) < 0) {
+            throw std::runtime_error("无法设置页缓冲");
+        }
+        H5E_auto2_t func;
+        void* data;
+        H5Eget_auto2(H5E_DEFAULT, &func, &data);
+        H5Eset_auto2(H5E_DEFAULT, nullptr, nullptr);
+        const hid_t file = H5Fopen(filename.c_str(), H5F_ACC_RDONLY, fapl);
+        H5Eset_auto2(H5E_DEFAULT, func, data);
+        if (file >= 0) return file;
+    }
+    return H5Fopen(filename.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+}
+
+int main(int argc, char** argv) {
 
     try {
         const std::string filename = "test_4d.hdf5";
         const std::string dataset = "/data";
+        const size_t page_buffer = std::stoull(find_option(argc, argv, "page-buffer", "1048576"));
         
         // 使用 RAII 方式打开文件和数据集，明确指定类型
-        Hdf5Handle file(H5Fopen(filename.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT), H5Fclose);
+        Hdf5Handle file(open_paged(filename, page_buffer), H5Fclose);
         Hdf5Handle dataset_id(H5Dopen2(file, dataset.c_str(), H5P_DEFAULT), H5Dclose);
         Hdf5Handle dataspace_id(H5Dget_space(dataset_id), H5Sclose);
 
@@ -6,6 +6,8 @@
 #include <functional>
 #include <stdexcept>
 
+#include "../cpp_impl/options.h"
+
 // RAII 包装器
 class Hdf5Handle {
     hid_t id_;
@@ -19,12 +21,13 @@ public:
     operator hid_t() const { return id_; }
 };
 
-int main() {
+int main(int argc, char** argv) {
     try {
         // 定义数据维度
         const std::array<hsize_t, 4> dims = {4, 4, 4, 4};  // {nt, nz, ny, nx}
         const std::string filename = "test_4d.hdf5";
         const std::string dataset = "/data";
+        const hsize_t page_size = std::stoull(find_option(argc, argv, "page-size", "4096"));
         
         // 创建并初始化数据
         const size_t total_size = dims[0] * dims[1] * dims[2] * dims[3];
@@ -33,9 +36,17 @@ int main() {
             data[i] = static_cast<double>(i);
         }
         
+        // 按页分配文件空间, 读方开启页缓冲后元数据按整页读取; page_size为0时使用默认策略
+        Hdf5Handle fcpl(H5Pcreate(H5P_FILE_CREATE), H5Pclose);
+        if (page_size > 0 &&
+            (H5Pset_file_space_strategy(fcpl, H5F_FSPACE_STRATEGY_PAGE, 0, 1) < 0 ||
+             H5Pset_file_space_page_size(fcpl, page_size) < 0)) {
+            throw std::runtime_error("无法设置按页分配的文件空间");
+        }
+
         // 使用 RAII 方式创建文件和数据集，明确指定类型
         Hdf5Handle file(
-            H5Fcreate(filename.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT),
+            H5Fcreate(filename.c_str(), H5F_ACC_TRUNC, fcpl, H5P_DEFAULT),
             H5Fclose);
         Hdf5Handle space(
             H5Screate_simple(dims.size(), dims.data(), nullptr),
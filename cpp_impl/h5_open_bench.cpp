@@ -0,0 +1,151 @@
+#include <H5Cpp.h>
+#include <vector>
+#include <iostream>
+#include <fstream>
+#include <array>
+#include <string>
+#include <stdexcept>
+#include <chrono>
+#include <cstdio>
+#include <algorithm>
+
+#include "options.h"
+
+// 打开并检查大量小文件的开销: 读尺寸、读Lt/Lz/Ly/Lx/Nc属性和第一个格点, 这些都是零碎的小读取
+// 比较三种情况:
+//   默认布局的文件, 默认打开
+//   按页分配的文件 (--page-size), 默认打开
+//   按页分配的文件, 开启页缓冲 (--page-buffer)
+// 系统调用次数取自 /proc/self/io 的 syscr; 网络文件系统上每次读取都要付出一次往返,
+// 按 --rtt-us 给出的往返延迟估算那里的用时: 本地用时 + 次数 * 往返延迟
+namespace {
+
+// 本进程累计的读系统调用次数
+unsigned long long read_syscalls() {
+    std::ifstream io("/proc/self/io");
+    std::string key;
+    unsigned long long value = 0;
+    while (io >> key >> value) {
+        if (key == "syscr:") return value;
+    }
+    throw std::runtime_error("无法读取 /proc/self/io");
+}
+
+void write_file(const std::string& filename, size_t L, hsize_t page_size) {
+    H5::FileCreatPropList fcpl;
+    if (page_size > 0) {
+        fcpl.setFileSpaceStrategy(H5F_FSPACE_STRATEGY_PAGE, false, 1);
+        fcpl.setFileSpacePagesize(page_size);
+    }
+    H5::H5File file(filename, H5F_ACC_TRUNC, fcpl);
+    const size_t nc = 3;
+    const std::vector<hsize_t> dims = {4, L, L, L, L, nc, nc * 2};
+    std::vector<double> data(4 * L * L * L * L * nc * nc * 2);
+    for (size_t i = 0; i < data.size(); ++i) data[i] = static_cast<double>(i);
+    H5::DataSpace dataspace(dims.size(), dims.data());
+    H5::DataSet dataset = file.createDataSet("LatticeMatrix", H5::PredType::NATIVE_DOUBLE, dataspace);
+    dataset.write(data.data(), H5::PredType::NATIVE_DOUBLE);
+
+    const std::array<const char*, 5> names = {"Lt", "Lz", "Ly", "Lx", "Nc"};
+    const std::array<double, 5> values = {double(L), double(L), double(L), double(L), double(nc)};
+    for (size_t i = 0; i < names.size(); ++i) {
+        dataset.createAttribute(names[i], H5::PredType::NATIVE_DOUBLE, H5::DataSpace(H5S_SCALAR))
+            .write(H5::PredType::NATIVE_DOUBLE, &values[i]);
+    }
+}
+
+// 打开文件, 读尺寸、全部属性和第一个格点; 返回读到的值之和, 防止被优化掉
+double inspect(const std::string& filename, size_t page_buffer) {
+    H5::FileAccPropList fapl;
+    if (page_buffer > 0 && H5Pset_page_buffer_size(fapl.getId(), page_buffer, 0, 0) < 0) {
+        throw std::runtime_error("无法设置页缓冲");
+    }
+    H5::H5File file(filename, H5F_ACC_RDONLY, H5::FileCreatPropList::DEFAULT, fapl);
+    H5::DataSet dataset = file.openDataSet("LatticeMatrix");
+    H5::DataSpace filespace = dataset.getSpace();
+    std::array<hsize_t, 7> dims;
+    if (filespace.getSimpleExtentNdims() != 7) throw std::runtime_error("数据集维度不是7维");
+    filespace.getSimpleExtentDims(dims.data());
+
+    double sum = 0;
+    for (int i = 0; i < dataset.getNumAttrs(); ++i) {
+        double value = 0;
+        dataset.openAttribute(static_cast<unsigned>(i)).read(H5::PredType::NATIVE_DOUBLE, &value);
+        sum += value;
+    }
+
+    std::array<hsize_t, 7> count = {1, 1, 1, 1, 1, dims[5], dims[6]}, start = {0, 0, 0, 0, 0, 0, 0};
+    std::vector<double> site(dims[5] * dims[6]);
+    filespace.selectHyperslab(H5S_SELECT_SET, count.data(), start.data());
+    H5::DataSpace memspace(count.size(), count.data());
+    dataset.read(site.data(), H5::PredType::NATIVE_DOUBLE, memspace, filespace);
+    for (double v : site) sum += v;
+    return sum;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    try {
+        const std::string prefix = find_option(argc, argv, "prefix", "open_bench");
+        const int files = std::stoi(find_option(argc, argv, "files", "32"));
+        const size_t L = std::stoul(find_option(argc, argv, "lattice", "4"));
+        const hsize_t page_size = std::stoull(find_option(argc, argv, "page-size", "4096"));
+        const size_t page_buffer = std::stoull(find_option(argc, argv, "page-buffer", "1048576"));
+        const double rtt_us = std::stod(find_option(argc, argv, "rtt-us", "500"));
+        const int repeat = std::max(1, std::stoi(find_option(argc, argv, "repeat", "3")));
+        if (page_size == 0 || page_buffer < page_size) {
+            throw std::runtime_error("--page-size必须大于0, --page-buffer不能小于一页");
+        }
+
+        for (int i = 0; i < files; ++i) {
+            write_file(prefix + "_default_" + std::to_string(i) + ".h5", L, 0);
+            write_file(prefix + "_paged_" + std::to_string(i) + ".h5", L, page_size);
+        }
+
+        struct Case {
+            const char* label;
+            const char* layout;
+            size_t page_buffer;
+        };
+        const std::array<Case, 3> cases = {{
+            {"默认布局", "default", 0},
+            {"按页分配", "paged", 0},
+            {"按页分配+页缓冲", "paged", page_buffer},
+        }};
+
+        std::printf("%d 个文件, 格子 %zu^4, 页大小 %llu, 页缓冲 %zu 字节, 估算往返延迟 %.0f us\n", files, L,
+                    static_cast<unsigned long long>(page_size), page_buffer, rtt_us);
+        double check = 0;
+        for (const Case& c : cases) {
+            double best = 1e30;
+            unsigned long long syscalls = 0;
+            for (int r = 0; r < repeat; ++r) {
+                const unsigned long long before = read_syscalls();
+                const auto t0 = std::chrono::steady_clock::now();
+                for (int i = 0; i < files; ++i) {
+                    check += inspect(prefix + "_" + c.layout + "_" + std::to_string(i) + ".h5", c.page_buffer);
+                }
+                const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+                // 读/proc/self/io本身也是一次读调用
+                syscalls = read_syscalls() - before - 1;
+                best = std::min(best, elapsed);
+            }
+            const double per_file = static_cast<double>(syscalls) / files;
+            std::printf("每个文件 %5.1f 次读调用, 本地 %7.3f ms, 估算网络文件系统 %7.3f ms  (%s)\n", per_file,
+                        best / files * 1e3, best / files * 1e3 + per_file * rtt_us * 1e-3, c.label);
+        }
+
+        for (int i = 0; i < files; ++i) {
+            std::remove((prefix + "_default_" + std::to_string(i) + ".h5").c_str());
+            std::remove((prefix + "_paged_" + std::to_string(i) + ".h5").c_str());
+        }
+        return check == 0 ? 1 : 0;
+    } catch (const H5::Exception& e) {
+        std::cerr << "HDF5错误：" << e.getCDetailMsg() << '\n';
+        return 1;
+    } catch (const std::exception& e) {
+        std::cerr << "错误：" << e.what() << '\n';
+        return 1;
+    }
+}
@@ -6,6 +6,8 @@
 #include <stdexcept>
 #include <complex>
 
+#include "options.h"
+
 template <typename T>
 class Array7D {
 private:
@@ -48,14 +50,48 @@ public:
     static constexpr size_t get_Ndim() { return Ndim; }
 };
 
-int main() {
+// 以页缓冲方式打开: 按页分配空间的文件 (写入方的--page-size) 每次读一整页并缓存,
+// 属性和元数据的零碎小读取合并成少数几次系统调用
+// 页缓冲只能用于按页分配的文件, 其他文件或buffer_size为0时按默认方式打开
+H5::H5File open_paged(const std::string& filename, size_t buffer_size) {
+    if (buffer_size > 0) {
+        H5::FileAccPropList fapl;
+        if (H5Pset_page_buffer_size(fapl.getId(), buffer_size, 0, 0) < 0) {
+            throw std::runtime_error("无法设置页缓冲");
+        }
+        // 只在这次尝试中关闭错误栈打印, 之后恢复调用者原来的设置
+        H5E_auto2_t func;
+        void* data;
+        H5::Exception::getAutoPrint(func, &data);
+        H5::Exception::dontPrint();
+        try {
+            H5::H5File file(filename, H5F_ACC_RDONLY, H5::FileCreatPropList::DEFAULT, fapl);
+            H5::Exception::setAutoPrint(func, data);
+            return file;
+        } catch (const H5::Exception&) {
+            H5::Exception::setAutoPrint(func, data);
+        }
+    }
+    return H5::H5File(filename, H5F_ACC_RDONLY);
+}
+
+int main(int argc, char** argv) {
     try {
-        const std::string filename = "test_7d.hdf5";
+        const std::string filename = find_option(argc, argv, "file", "test_7d.hdf5");
         const std::string dataset_name = "LatticeMatrix";
+        const size_t page_buffer = std::stoull(find_option(argc, argv, "page-buffer", "1048576"));
 
         // 打开HDF5文件
-        H5::H5File file(filename, H5F_ACC_RDONLY);
+        H5::H5File file = open_paged(filename, page_buffer);
         H5::DataSet dataset = file.openDataSet(dataset_name);
+
+        // 写入方记录的格子尺寸属性
+        for (const char* name : {"Lt", "Lz", "Ly", "Lx", "Nc"}) {
+            if (!dataset.attrExists(name)) continue;
+            double value = 0;
+            dataset.openAttribute(name).read(H5::PredType::NATIVE_DOUBLE, &value);
+            std::cout << name << " = " << value << '\n';
+        }
         
         // 获取数据空间
         H5::DataSpace dataspace = dataset.getSpace();
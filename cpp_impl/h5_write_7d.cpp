@@ -4,6 +4,9 @@
 #include <array>
 #include <string>
 #include <stdexcept>
+#include <cassert>
+
+#include "options.h"
 
 template <typename T>
 class Array7D {
@@ -50,7 +53,19 @@ private:
     }
 };
 
-int main() {
+// 按页分配文件空间: 元数据和小的原始数据聚集在固定大小的页中, 读方开启页缓冲后
+// 一次读一整页, 打开文件、读属性这类零碎的小读取合并成少数几次系统调用
+// page_size为0时使用默认的分配策略
+H5::FileCreatPropList make_fcpl(hsize_t page_size) {
+    H5::FileCreatPropList fcpl;
+    if (page_size > 0) {
+        fcpl.setFileSpaceStrategy(H5F_FSPACE_STRATEGY_PAGE, false, 1);
+        fcpl.setFileSpacePagesize(page_size);
+    }
+    return fcpl;
+}
+
+int main(int argc, char** argv) {
     try {
         // 定义数组维度
         const size_t lt = 4, lz = 4, ly = 4, lx = 4, nc = 3;
@@ -74,11 +89,12 @@ int main() {
             }
         }
 
-        const std::string filename = "test_7d.hdf5";
+        const std::string filename = find_option(argc, argv, "out", "test_7d.hdf5");
         const std::string dataset_name = "LatticeMatrix";
+        const hsize_t page_size = std::stoull(find_option(argc, argv, "page-size", "4096"));
 
         // 创建文件
-        H5::H5File file(filename, H5F_ACC_TRUNC);
+        H5::H5File file(filename, H5F_ACC_TRUNC, make_fcpl(page_size));
 
         // 定义HDF5数据维度
         std::vector<hsize_t> dims = {
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <string>
+
+// 串行读写程序共用的命令行解析 (c_impl也包含这个文件)
+
+// --name=value 形式的选项, 没有给出时返回默认值
+inline std::string find_option(int argc, char** argv, const std::string& name, const std::string& fallback) {
+    const std::string prefix = "--" + name + "=";
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg.compare(0, prefix.size(), prefix) == 0) return arg.substr(prefix.size());
+    }
+    return fallback;
+}
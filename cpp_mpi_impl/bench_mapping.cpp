@@ -0,0 +1,155 @@
+#include <H5Cpp.h>
+#include <vector>
+#include <iostream>
+#include <array>
+#include <string>
+#include <stdexcept>
+#include <complex>
+#include <cstdio>
+
+#include "public.h"
+#include "grid.h"
+#include "lattice_io.h"
+
+// 统计本进程8个邻居中与自己位于同一节点的个数
+static int node_local_neighbors(const ProcessGrid& grid) {
+    MPI_Comm node_comm;
+    MPI_Comm_split_type(grid.comm(), MPI_COMM_TYPE_SHARED, grid.rank(), MPI_INFO_NULL, &node_comm);
+    MPI_Group grid_group, node_group;
+    MPI_Comm_group(grid.comm(), &grid_group);
+    MPI_Comm_group(node_comm, &node_group);
+
+    std::array<int, 2 * Nd> neighbors, translated;
+    for (int d = 0; d < Nd; ++d) {
+        neighbors[2 * d] = grid.neighbor(d, 1);
+        neighbors[2 * d + 1] = grid.neighbor(d, -1);
+    }
+    MPI_Group_translate_ranks(grid_group, 2 * Nd, neighbors.data(), node_group, translated.data());
+
+    int count = 0;
+    for (int r : translated) {
+        if (r != MPI_UNDEFINED) ++count;
+    }
+    MPI_Group_free(&grid_group);
+    MPI_Group_free(&node_group);
+    MPI_Comm_free(&node_comm);
+    return count;
+}
+
+// 沿4个方向正反两侧交换宽度为1的面, 返回最慢进程的用时
+static double halo_exchange_time(const ProcessGrid& grid, const std::array<size_t, Nd>& local,
+                                 size_t Nc, int iters) {
+    const size_t volume = local[X_DIM] * local[Y_DIM] * local[Z_DIM] * local[T_DIM];
+    std::vector<std::vector<double>> send(Nd), recv(Nd);
+    for (int d = 0; d < Nd; ++d) {
+        const size_t face = volume / local[d] * Array7D<double>::get_Ndim() * Nc * Nc * 2;
+        send[d].assign(2 * face, 1.0);
+        recv[d].resize(2 * face);
+    }
+
+    MPI_Barrier(grid.comm());
+    const double start = MPI_Wtime();
+    for (int it = 0; it < iters; ++it) {
+        std::vector<MPI_Request> requests;
+        for (int d = 0; d < Nd; ++d) {
+            const int face = static_cast<int>(send[d].size() / 2);
+            const int forward = grid.neighbor(d, 1);
+            const int backward = grid.neighbor(d, -1);
+            requests.resize(requests.size() + 4);
+            MPI_Request* req = &requests[requests.size() - 4];
+            MPI_Irecv(recv[d].data(), face, MPI_DOUBLE, backward, 2 * d, grid.comm(), &req[0]);
+            MPI_Irecv(recv[d].data() + face, face, MPI_DOUBLE, forward, 2 * d + 1, grid.comm(), &req[1]);
+            MPI_Isend(send[d].data(), face, MPI_DOUBLE, forward, 2 * d, grid.comm(), &req[2]);
+            MPI_Isend(send[d].data() + face, face, MPI_DOUBLE, backward, 2 * d + 1, grid.comm(), &req[3]);
+        }
+        MPI_Waitall(static_cast<int>(requests.size()), requests.data(), MPI_STATUSES_IGNORE);
+    }
+    double elapsed = MPI_Wtime() - start;
+    MPI_Allreduce(MPI_IN_PLACE, &elapsed, 1, MPI_DOUBLE, MPI_MAX, grid.comm());
+    return elapsed;
+}
+
+int main(int argc, char** argv) {
+    MPI_Init(&argc, &argv);
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    try {
+        if (argc < 2) {
+            if (rank == 0) {
+                std::cerr << "用法: mpirun -n <进程数> " << argv[0]
+                          << " Nx.Ny.Nz.Nt|auto [--lattice=Lx.Ly.Lz.Lt] [--iters=N]\n";
+            }
+            MPI_Finalize();
+            return 1;
+        }
+
+        const auto lattice = parse_lattice(find_option(argc, argv, "lattice", "16.16.16.16"));
+        const int iters = std::stoi(find_option(argc, argv, "iters", "20"));
+        const size_t Nc = 3;
+        const std::string filename = "bench_mapping.hdf5";
+        const std::string dataset_name = "LatticeMatrix";
+
+        if (rank == 0) {
+            std::printf("%-6s %10s %14s %14s %14s\n",
+                        "映射", "节点内邻居", "halo MB/s", "写 MB/s", "读 MB/s");
+        }
+
+        for (GridMapping mapping : {GridMapping::Plain, GridMapping::Cart, GridMapping::Node}) {
+            ProcessGrid grid(MPI_COMM_WORLD, parse_grid(argv[1]), mapping);
+            const auto local = grid.local_extent(lattice);
+
+            int local_neighbors = node_local_neighbors(grid);
+            MPI_Allreduce(MPI_IN_PLACE, &local_neighbors, 1, MPI_INT, MPI_SUM, grid.comm());
+
+            // halo交换带宽: 所有进程发送的总字节数 / 最慢进程用时
+            const size_t volume = local[X_DIM] * local[Y_DIM] * local[Z_DIM] * local[T_DIM];
+            double halo_bytes = 0;
+            for (int d = 0; d < Nd; ++d) {
+                halo_bytes += 2.0 * volume / local[d] * Array7D<double>::get_Ndim() * Nc * Nc
+                            * sizeof(std::complex<double>);
+            }
+            halo_bytes *= static_cast<double>(grid.size()) * iters;
+            const double halo_time = halo_exchange_time(grid, local, Nc, iters);
+
+            // 聚合I/O带宽
+            Array7D<std::complex<double>> local_array(local[T_DIM], local[Z_DIM], local[Y_DIM], local[X_DIM], Nc);
+            const double io_mbytes = static_cast<double>(volume) * grid.size() * local_array.get_Ndim()
+                                   * Nc * Nc * sizeof(std::complex<double>) / (1024.0 * 1024.0);
+
+            MPI_Barrier(grid.comm());
+            double start = MPI_Wtime();
+            write7d(grid, filename, dataset_name, local_array);
+            MPI_Barrier(grid.comm());
+            const double write_time = MPI_Wtime() - start;
+
+            start = MPI_Wtime();
+            const auto loaded = read7d(grid, filename, dataset_name);
+            MPI_Barrier(grid.comm());
+            const double read_time = MPI_Wtime() - start;
+
+            if (grid.rank() == 0) {
+                std::printf("%-6s %9.1f%% %14.1f %14.1f %14.1f\n",
+                            mapping_name(grid.mapping()),
+                            100.0 * local_neighbors / (2 * Nd * grid.size()),
+                            halo_bytes / halo_time / (1024.0 * 1024.0),
+                            io_mbytes / write_time, io_mbytes / read_time);
+            }
+        }
+
+        MPI_Finalize();
+        return 0;
+    } catch (const H5::Exception& e) {
+        if (rank == 0) {
+            std::cerr << "HDF5错误：" << e.getCDetailMsg() << '\n';
+        }
+        MPI_Finalize();
+        return 1;
+    } catch (const std::exception& e) {
+        if (rank == 0) {
+            std::cerr << "错误：" << e.what() << '\n';
+        }
+        MPI_Finalize();
+        return 1;
+    }
+}
@@ -0,0 +1,114 @@
+#include <H5Cpp.h>
+#include <vector>
+#include <iostream>
+#include <array>
+#include <string>
+#include <stdexcept>
+#include <complex>
+#include <algorithm>
+#include <cstdio>
+
+#include "public.h"
+#include "grid.h"
+#include "lattice_io.h"
+#include "halo.h"
+
+// 比较两种写出带ghost/填充的场的方式:
+//   hyperslab: 直接把跨步视图交给HDF5的内存选择
+//   pack:      先打包成连续数组再按稠密内存空间写出
+int main(int argc, char** argv) {
+    MPI_Init(&argc, &argv);
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    try {
+        if (argc < 2) {
+            if (rank == 0) {
+                std::cerr << "用法: mpirun -n <进程数> " << argv[0]
+                          << " Nx.Ny.Nz.Nt|auto [--lattice=Lx.Ly.Lz.Lt] [--ghost=g] [--pad=n] [--reps=N]\n";
+            }
+            MPI_Finalize();
+            return 1;
+        }
+
+        ProcessGrid grid(MPI_COMM_WORLD, parse_grid(argv[1]));
+        const auto lattice = parse_lattice(find_option(argc, argv, "lattice", "16.16.16.16"));
+        const auto ghost = parse_ghost(find_option(argc, argv, "ghost", "1"));
+        const hsize_t pad = std::stoul(find_option(argc, argv, "pad", "0"));  // 每行颜色矩阵后的填充double数
+        const int reps = std::stoi(find_option(argc, argv, "reps", "3"));
+        const hsize_t Nc = 3;
+        const std::string filename = "bench_strided.hdf5";
+        const std::string dataset_name = "LatticeMatrix";
+
+        // 生产代码中的场布局: 含ghost区, 最内层可能有对齐填充
+        const auto local = grid.local_extent(lattice);
+        StridedView7D view;
+        view.extent = {
+            Array7D<double>::get_Ndim(), local[T_DIM] + 2 * ghost[T_DIM], local[Z_DIM] + 2 * ghost[Z_DIM],
+            local[Y_DIM] + 2 * ghost[Y_DIM], local[X_DIM] + 2 * ghost[X_DIM], Nc, Nc * 2 + pad
+        };
+        view.offset = {0, ghost[T_DIM], ghost[Z_DIM], ghost[Y_DIM], ghost[X_DIM], 0, 0};
+        view.stride = {1, 1, 1, 1, 1, 1, 1};
+        view.count = {
+            Array7D<double>::get_Ndim(), local[T_DIM], local[Z_DIM], local[Y_DIM], local[X_DIM], Nc, Nc * 2
+        };
+
+        size_t storage = 1;
+        for (hsize_t e : view.extent) storage *= e;
+        std::vector<double> field(storage);
+        for (size_t i = 0; i < storage; ++i) field[i] = static_cast<double>(rank * 1000 + i % 997);
+        view.ptr = field.data();
+
+        double best_slab = 1e30, best_pack = 1e30, best_pack_copy = 1e30;
+        for (int r = 0; r < reps; ++r) {
+            MPI_Barrier(grid.comm());
+            double start = MPI_Wtime();
+            write7d(grid, filename, dataset_name, view);
+            double elapsed = MPI_Wtime() - start;
+            MPI_Allreduce(MPI_IN_PLACE, &elapsed, 1, MPI_DOUBLE, MPI_MAX, grid.comm());
+            best_slab = std::min(best_slab, elapsed);
+
+            MPI_Barrier(grid.comm());
+            start = MPI_Wtime();
+            const std::vector<double> packed = pack_view(view);
+            double copy = MPI_Wtime() - start;
+            StridedView7D dense = view;
+            dense.ptr = packed.data();
+            dense.extent = view.count;
+            dense.offset = {0, 0, 0, 0, 0, 0, 0};
+            write7d(grid, filename, dataset_name, dense);
+            elapsed = MPI_Wtime() - start;
+            MPI_Allreduce(MPI_IN_PLACE, &elapsed, 1, MPI_DOUBLE, MPI_MAX, grid.comm());
+            MPI_Allreduce(MPI_IN_PLACE, &copy, 1, MPI_DOUBLE, MPI_MAX, grid.comm());
+            best_pack = std::min(best_pack, elapsed);
+            best_pack_copy = std::min(best_pack_copy, copy);
+        }
+
+        if (grid.rank() == 0) {
+            size_t volume = 1;
+            for (hsize_t c : view.count) volume *= c;
+            const double mbytes = static_cast<double>(volume) * sizeof(double) * grid.size() / (1024.0 * 1024.0);
+            std::printf("数据量 %.1f MB, ghost %zu.%zu.%zu.%zu, 填充 %llu\n", mbytes,
+                        ghost[X_DIM], ghost[Y_DIM], ghost[Z_DIM], ghost[T_DIM],
+                        static_cast<unsigned long long>(pad));
+            std::printf("hyperslab: %.4f s (%.1f MB/s)\n", best_slab, mbytes / best_slab);
+            std::printf("pack     : %.4f s (%.1f MB/s), 其中打包 %.4f s, 额外内存 %.1f MB/进程\n",
+                        best_pack, mbytes / best_pack, best_pack_copy, mbytes / grid.size());
+        }
+
+        MPI_Finalize();
+        return 0;
+    } catch (const H5::Exception& e) {
+        if (rank == 0) {
+            std::cerr << "HDF5错误：" << e.getCDetailMsg() << '\n';
+        }
+        MPI_Finalize();
+        return 1;
+    } catch (const std::exception& e) {
+        if (rank == 0) {
+            std::cerr << "错误：" << e.what() << '\n';
+        }
+        MPI_Finalize();
+        return 1;
+    }
+}
@@ -0,0 +1,183 @@
+#include <H5Cpp.h>
+#include <vector>
+#include <iostream>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <stdexcept>
+#include <complex>
+#include <algorithm>
+
+#include "public.h"
+#include "grid.h"
+#include "lattice_io.h"
+#include "transforms.h"
+#include "hybrid.h"
+
+// 读入后处理的两种方式对比, 结果都是单精度的规范场:
+//   separate: read7d读入双精度, 再分别做时间方向反周期边界、规范变换和精度转换三遍
+//   fused:    read7d_fused每读入一个t切片块就把三步一起做完
+// 两种方式都用OpenMP并行, 输出用时和两者结果的最大差
+int main(int argc, char** argv) {
+    // OpenMP线程只做计算, 只有主线程调用MPI
+    init_mpi_threads(&argc, &argv, MPI_THREAD_FUNNELED);
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    try {
+        if (argc < 2) {
+            if (rank == 0) {
+                std::cerr << "用法: mpirun -n <进程数> " << argv[0]
+                          << " Nx.Ny.Nz.Nt|auto [--lattice=Lx.Ly.Lz.Lt] [--reps=3] [--slab=8M]"
+                          << " [--gauge-transform=1]\n";
+            }
+            MPI_Finalize();
+            return 1;
+        }
+
+        ProcessGrid grid(MPI_COMM_WORLD, parse_grid(argv[1]),
+                         parse_mapping(find_option(argc, argv, "map", "cart")));
+        const auto lattice = parse_lattice(find_option(argc, argv, "lattice", "8.8.8.8"));
+        const int reps = std::max(1, std::stoi(find_option(argc, argv, "reps", "3")));
+        const size_t slab_bytes = parse_bytes(find_option(argc, argv, "slab", "8M"));
+        const bool use_gauge = find_option(argc, argv, "gauge-transform", "1") != "0";
+        const std::string filename = "bench_transform.hdf5";
+        const std::string g_filename = "bench_transform_g.hdf5";
+        const std::string dataset_name = "LatticeMatrix";
+        const size_t Nc = 3;
+
+        IoOptions options;
+        options.max_transfer_bytes = parse_bytes(find_option(argc, argv, "max-transfer", "1G"));
+
+        const auto local = grid.local_extent(lattice);
+        const auto offset = grid.local_offset(local);
+        const size_t lt = local[T_DIM], lz = local[Z_DIM], ly = local[Y_DIM], lx = local[X_DIM];
+
+        // 准备规范场和规范变换文件
+        {
+            Array7D<std::complex<double>> u(lt, lz, ly, lx, Nc);
+            LatticeField<std::complex<double>, 2> g(1, lt, lz, ly, lx, {Nc, Nc});
+            for (size_t t = 0; t < lt; ++t)
+                for (size_t z = 0; z < lz; ++z)
+                    for (size_t y = 0; y < ly; ++y)
+                        for (size_t x = 0; x < lx; ++x) {
+                            const double site = (((t + offset[T_DIM]) * 31 + z + offset[Z_DIM]) * 31
+                                                 + y + offset[Y_DIM]) * 31 + x + offset[X_DIM];
+                            for (size_t a = 0; a < Nc; ++a)
+                                for (size_t b = 0; b < Nc; ++b) {
+                                    g(0, t, z, y, x, a, b) = std::polar(1.0 / Nc, 0.1 * site + a - 2.0 * b);
+                                    for (size_t mu = 0; mu < Nd; ++mu) {
+                                        u(mu, t, z, y, x, a, b) = std::polar(1.0, 0.01 * site + mu + a * Nc + b);
+                                    }
+                                }
+                        }
+            write7d(grid, filename, dataset_name, u, options);
+            write_field(grid, g_filename, "GaugeTransform", g, options);
+        }
+
+        LinkTransforms transforms;
+        transforms.boundary_phase[T_DIM] = -1.0;
+        LatticeField<std::complex<double>, 2> g(1, 1, 1, 1, 1, {Nc, Nc});
+        if (use_gauge) {
+            g = load_gauge_transform(grid, g_filename, "GaugeTransform", options);
+            transforms.gauge_transform = &g;
+        }
+
+        const long long outer = static_cast<long long>(Nd * lt * lz);
+        Array7D<std::complex<float>> separate(lt, lz, ly, lx, Nc);
+        Array7D<std::complex<float>> fused(lt, lz, ly, lx, Nc);
+        double best_separate = 1e30, best_fused = 1e30;
+        for (int r = 0; r < reps; ++r) {
+            // 分开的多遍处理
+            MPI_Barrier(grid.comm());
+            double t0 = MPI_Wtime();
+            Array7D<std::complex<double>> u(lt, lz, ly, lx, Nc);
+            read7d(grid, filename, dataset_name, u, options);
+            if (offset[T_DIM] + lt == lattice[T_DIM]) {
+                #pragma omp parallel for
+                for (long long i = 0; i < static_cast<long long>(lz * ly * lx); ++i) {
+                    std::complex<double>* link = u.site_ptr(T_DIM, lt - 1, i / (ly * lx), i / lx % ly, i % lx);
+                    for (size_t k = 0; k < Nc * Nc; ++k) link[k] = -link[k];
+                }
+            }
+            if (use_gauge) {
+                #pragma omp parallel for
+                for (long long idx = 0; idx < outer; ++idx) {
+                    const size_t mu = idx / (lt * lz), t = idx / lz % lt, z = idx % lz;
+                    std::vector<std::complex<double>> tmp(Nc * Nc);
+                    for (size_t y = 0; y < ly; ++y)
+                        for (size_t x = 0; x < lx; ++x) {
+                            std::complex<double>* link = u.site_ptr(mu, t, z, y, x);
+                            const std::complex<double>* gx = g.site_ptr(0, t, z, y, x);
+                            const std::complex<double>* gy = &g.halo(0, t + (mu == T_DIM), z + (mu == Z_DIM),
+                                                                     y + (mu == Y_DIM), x + (mu == X_DIM), 0, 0);
+                            for (size_t a = 0; a < Nc; ++a)
+                                for (size_t b = 0; b < Nc; ++b) {
+                                    std::complex<double> sum = 0;
+                                    for (size_t c = 0; c < Nc; ++c) sum += gx[a * Nc + c] * link[c * Nc + b];
+                                    tmp[a * Nc + b] = sum;
+                                }
+                            for (size_t a = 0; a < Nc; ++a)
+                                for (size_t b = 0; b < Nc; ++b) {
+                                    std::complex<double> sum = 0;
+                                    for (size_t c = 0; c < Nc; ++c) sum += tmp[a * Nc + c] * std::conj(gy[b * Nc + c]);
+                                    link[a * Nc + b] = sum;
+                                }
+                        }
+                }
+            }
+            #pragma omp parallel for
+            for (long long idx = 0; idx < outer; ++idx) {
+                const size_t mu = idx / (lt * lz), t = idx / lz % lt, z = idx % lz;
+                for (size_t y = 0; y < ly; ++y)
+                    for (size_t x = 0; x < lx; ++x) {
+                        const std::complex<double>* src = u.site_ptr(mu, t, z, y, x);
+                        std::complex<float>* dst = separate.site_ptr(mu, t, z, y, x);
+                        for (size_t k = 0; k < Nc * Nc; ++k) dst[k] = static_cast<std::complex<float>>(src[k]);
+                    }
+            }
+            double elapsed = MPI_Wtime() - t0;
+            MPI_Allreduce(MPI_IN_PLACE, &elapsed, 1, MPI_DOUBLE, MPI_MAX, grid.comm());
+            best_separate = std::min(best_separate, elapsed);
+
+            // 融合处理
+            MPI_Barrier(grid.comm());
+            t0 = MPI_Wtime();
+            read7d_fused(grid, filename, dataset_name, fused, transforms, options, slab_bytes);
+            elapsed = MPI_Wtime() - t0;
+            MPI_Allreduce(MPI_IN_PLACE, &elapsed, 1, MPI_DOUBLE, MPI_MAX, grid.comm());
+            best_fused = std::min(best_fused, elapsed);
+        }
+
+        double max_diff = 0;
+        const size_t n = Nd * lt * lz * ly * lx * Nc * Nc;
+        for (size_t i = 0; i < n; ++i) {
+            max_diff = std::max<double>(max_diff, std::abs(separate.data_ptr()[i] - fused.data_ptr()[i]));
+        }
+        MPI_Allreduce(MPI_IN_PLACE, &max_diff, 1, MPI_DOUBLE, MPI_MAX, grid.comm());
+        if (grid.rank() == 0) {
+            const double mb = n * sizeof(std::complex<double>) * grid.size() / (1024.0 * 1024.0);
+            std::printf("%.1f MB, 规范变换 %s\n", mb, use_gauge ? "开" : "关");
+            std::printf("separate: %.4f s\nfused:    %.4f s (%.2fx)\n最大差 %.3g\n",
+                        best_separate, best_fused, best_separate / best_fused, max_diff);
+            std::remove(filename.c_str());
+            std::remove(g_filename.c_str());
+        }
+
+        MPI_Finalize();
+        return 0;
+    } catch (const H5::Exception& e) {
+        if (rank == 0) {
+            std::cerr << "HDF5错误：" << e.getCDetailMsg() << '\n';
+        }
+        MPI_Finalize();
+        return 1;
+    } catch (const std::exception& e) {
+        if (rank == 0) {
+            std::cerr << "错误：" << e.what() << '\n';
+        }
+        MPI_Finalize();
+        return 1;
+    }
+}
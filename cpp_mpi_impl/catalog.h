@@ -0,0 +1,364 @@
+#pragma once
+
+#include <H5Cpp.h>
+#include <mpi.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cerrno>
+#include <climits>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_set>
+#include <vector>
+
+#include "grid.h"
+#include "lattice_io.h"
+#include "public.h"
+#include "trace.h"
+
+// 系综目录: 只追加的紧凑二进制索引文件, 每个配置一条定长记录
+//   文件头: "LATCAT01" + 记录字节数 (uint64)
+//   记录:   配置文件的绝对路径和数据集名, 全局尺寸, beta, 轨迹号, 与进程划分无关的校验和,
+//           连续布局时数据在文件中的字节偏移和长度, 文件大小和修改时间, 记录自身的散列
+// 查询只需顺序扫描一个小文件, 不必打开每个HDF5文件; 查到的偏移可以直接交给read7d_at,
+// 用MPI-IO按偏移读取而不经过HDF5的文件打开和元数据读取
+// 追加由rank 0在flock保护下一次write完成并fsync, 多个作业可以共用一个目录文件;
+// 写到一半被中断的记录因散列不符在读取时被跳过
+
+struct CatalogRecord {
+    char path[256];
+    char dataset[64];
+    uint64_t dims[7];          // [4, Lt, Lz, Ly, Lx, Nc, 2*Nc]
+    double beta;               // 未知时为NaN
+    int64_t trajectory;        // 未知时为-1
+    uint64_t checksum;         // global_checksum, 0表示未计算
+    uint64_t data_offset;      // 非连续布局时为kNoOffset
+    uint64_t data_bytes;
+    uint64_t file_size;
+    int64_t mtime;
+    double wall_time;          // 登记时刻, Unix时间秒
+    uint64_t record_hash;      // 前面所有字节的fnv1a64
+};
+
+static_assert(std::is_trivially_copyable<CatalogRecord>::value, "目录记录必须可以按字节读写");
+
+constexpr uint64_t kNoOffset = std::numeric_limits<uint64_t>::max();
+
+namespace detail {
+
+constexpr char kCatalogMagic[8] = {'L', 'A', 'T', 'C', 'A', 'T', '0', '1'};
+
+inline uint64_t record_hash(const CatalogRecord& r) {
+    return fnv1a64(&r, offsetof(CatalogRecord, record_hash));
+}
+
+inline void copy_name(char* dst, size_t size, const std::string& src) {
+    if (src.size() >= size) throw std::runtime_error("名字过长, 无法登记: " + src);
+    std::memset(dst, 0, size);
+    std::memcpy(dst, src.data(), src.size());
+}
+
+}  // namespace detail
+
+// 集体调用: 与进程划分无关的校验和, 各链接以全局编号为种子散列后按2^64求和; 结果在所有进程上有效
+inline uint64_t global_checksum(const ProcessGrid& grid, const Array7D<std::complex<double>>& u) {
+    TraceScope scope("catalog.checksum");
+    const std::array<size_t, Nd> local = {u.get_Lx(), u.get_Ly(), u.get_Lz(), u.get_Lt()};
+    const auto offset = grid.local_offset(local);
+    std::array<size_t, Nd> global;
+    for (int d = 0; d < Nd; ++d) global[d] = local[d] * grid.dim(d);
+    const size_t bytes = u.get_Nc() * u.get_Nc() * sizeof(std::complex<double>);
+
+    // 按2^64求和与顺序无关, 以-fopenmp编译时由多个线程分担
+    uint64_t sum = 0;
+    const long long outer = static_cast<long long>(Nd * local[T_DIM] * local[Z_DIM]);
+    #pragma omp parallel for schedule(static) reduction(+ : sum)
+    for (long long idx = 0; idx < outer; ++idx) {
+        const size_t mu = idx / (local[T_DIM] * local[Z_DIM]);
+        const size_t t = idx / local[Z_DIM] % local[T_DIM];
+        const size_t z = idx % local[Z_DIM];
+        for (size_t y = 0; y < local[Y_DIM]; ++y) {
+            const uint64_t row = (((mu * global[T_DIM] + t + offset[T_DIM]) * global[Z_DIM]
+                                  + z + offset[Z_DIM]) * global[Y_DIM] + y + offset[Y_DIM]) * global[X_DIM]
+                               + offset[X_DIM];
+            for (size_t x = 0; x < local[X_DIM]; ++x) {
+                const uint64_t seed = 14695981039346656037ULL ^ ((row + x) * 0x9E3779B97F4A7C15ULL);
+                sum += fnv1a64_words(u.site_ptr(mu, t, z, y, x), bytes, seed);
+            }
+        }
+    }
+    MPI_Allreduce(MPI_IN_PLACE, &sum, 1, MPI_UINT64_T, MPI_SUM, grid.comm());
+    return sum;
+}
+
+// 单进程: 由已写好的HDF5文件填充记录的路径、尺寸、偏移和文件信息;
+// 数据集上有beta/trajectory属性时一并读取, 否则取meta中的值
+inline CatalogRecord describe_config(const std::string& filename, const std::string& dataset_name,
+                                     double beta = std::nan(""), long long trajectory = -1) {
+    CatalogRecord r;
+    std::memset(&r, 0, sizeof(r));
+    char resolved[PATH_MAX];
+    if (::realpath(filename.c_str(), resolved) == nullptr) throw std::runtime_error("找不到文件: " + filename);
+    detail::copy_name(r.path, sizeof(r.path), resolved);
+    detail::copy_name(r.dataset, sizeof(r.dataset), dataset_name);
+    r.beta = beta;
+    r.trajectory = trajectory;
+    r.data_offset = kNoOffset;
+
+    Hdf5Lock hdf5_lock;
+    H5::H5File file(filename, H5F_ACC_RDONLY);
+    H5::DataSet dataset = file.openDataSet(dataset_name);
+    const auto dims = dataset_dims7d(dataset);
+    std::copy(dims.begin(), dims.end(), r.dims);
+    if (dataset.attrExists("beta")) dataset.openAttribute("beta").read(H5::PredType::NATIVE_DOUBLE, &r.beta);
+    if (dataset.attrExists("trajectory")) {
+        dataset.openAttribute("trajectory").read(H5::PredType::NATIVE_INT64, &r.trajectory);
+    }
+    // 只有连续布局且是本机字节序的double时, 偏移才能直接用于按字节读取
+    const haddr_t address = H5Dget_offset(dataset.getId());
+    if (address != HADDR_UNDEF && dataset.getDataType() == H5::PredType::NATIVE_DOUBLE) {
+        r.data_offset = address;
+        r.data_bytes = dataset.getStorageSize();
+    }
+
+    struct stat st;
+    if (::stat(resolved, &st) == 0) {
+        r.file_size = st.st_size;
+        r.mtime = st.st_mtime;
+    }
+    r.wall_time = std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+    return r;
+}
+
+// 单进程: 追加一条记录, 目录文件不存在时创建并写文件头
+inline void append_catalog(const std::string& catalog, CatalogRecord record) {
+    record.record_hash = detail::record_hash(record);
+    const int fd = ::open(catalog.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) throw std::runtime_error("无法打开目录文件 " + catalog + ": " + std::strerror(errno));
+    bool ok = ::flock(fd, LOCK_EX) == 0;
+    struct stat st;
+    ok = ok && ::fstat(fd, &st) == 0;
+    // 上次追加中断留下的半条记录截掉, 否则之后的记录都会错位
+    const off_t header_size = 16;
+    if (ok && st.st_size > header_size && (st.st_size - header_size) % sizeof(CatalogRecord) != 0) {
+        ok = ::ftruncate(fd, st.st_size - (st.st_size - header_size) % sizeof(CatalogRecord)) == 0;
+    }
+    // 文件头只写了一部分 (1-15字节) 时按空文件处理, 否则记录接在残缺的文件头之后, 整个目录都读不出
+    if (ok && st.st_size > 0 && st.st_size < header_size) {
+        ok = ::ftruncate(fd, 0) == 0;
+        st.st_size = 0;
+    }
+    if (ok && st.st_size == 0) {
+        char header[16];
+        std::memcpy(header, detail::kCatalogMagic, 8);
+        const uint64_t size = sizeof(CatalogRecord);
+        std::memcpy(header + 8, &size, sizeof(size));
+        ok = ::write(fd, header, sizeof(header)) == static_cast<ssize_t>(sizeof(header));
+    }
+    ok = ok && ::write(fd, &record, sizeof(record)) == static_cast<ssize_t>(sizeof(record));
+    ok = ok && ::fsync(fd) == 0;
+    ::flock(fd, LOCK_UN);
+    ::close(fd);
+    if (!ok) throw std::runtime_error("写目录文件失败: " + catalog);
+}
+
+// 单进程: 读出全部有效记录; skipped返回因散列不符 (写入中断) 被跳过的记录数
+inline std::vector<CatalogRecord> load_catalog(const std::string& catalog, size_t* skipped = nullptr) {
+    std::ifstream in(catalog, std::ios::binary);
+    if (!in) throw std::runtime_error("无法打开目录文件: " + catalog);
+    char header[16];
+    uint64_t size = 0;
+    if (!in.read(header, sizeof(header)) || std::memcmp(header, detail::kCatalogMagic, 8) != 0) {
+        throw std::runtime_error(catalog + " 不是目录文件");
+    }
+    std::memcpy(&size, header + 8, sizeof(size));
+    if (size != sizeof(CatalogRecord)) throw std::runtime_error(catalog + " 的记录格式与本程序不一致");
+
+    std::vector<CatalogRecord> records;
+    size_t bad = 0;
+    CatalogRecord r;
+    while (in.read(reinterpret_cast<char*>(&r), sizeof(r))) {
+        if (r.record_hash == detail::record_hash(r)) {
+            records.push_back(r);
+        } else {
+            ++bad;
+        }
+    }
+    if (in.gcount() > 0) ++bad;
+    if (skipped != nullptr) *skipped = bad;
+    return records;
+}
+
+// 查询条件, 未设置的条件不参与筛选
+struct CatalogQuery {
+    std::array<size_t, Nd> lattice = {0, 0, 0, 0};   // QcuDims顺序, 全0表示任意
+    size_t Nc = 0;
+    double beta = std::nan("");
+    double beta_tolerance = 1e-9;
+    long long trajectory_min = std::numeric_limits<long long>::min();
+    long long trajectory_max = std::numeric_limits<long long>::max();
+    uint64_t checksum = 0;
+    std::string dataset;
+    std::string path;                               // 路径中包含的子串
+
+    bool matches(const CatalogRecord& r) const {
+        if (lattice != std::array<size_t, Nd>{0, 0, 0, 0} &&
+            (r.dims[1] != lattice[T_DIM] || r.dims[2] != lattice[Z_DIM] || r.dims[3] != lattice[Y_DIM] ||
+             r.dims[4] != lattice[X_DIM])) {
+            return false;
+        }
+        if (Nc != 0 && r.dims[5] != Nc) return false;
+        if (!std::isnan(beta) && !(std::abs(r.beta - beta) <= beta_tolerance)) return false;
+        if (r.trajectory < trajectory_min || r.trajectory > trajectory_max) return false;
+        if (checksum != 0 && r.checksum != checksum) return false;
+        if (!dataset.empty() && dataset != r.dataset) return false;
+        if (!path.empty() && std::strstr(r.path, path.c_str()) == nullptr) return false;
+        return true;
+    }
+};
+
+// 同一路径和数据集登记多次时 (重写或补登) 只保留最后一条
+inline std::vector<CatalogRecord> query_catalog(const std::vector<CatalogRecord>& records,
+                                                const CatalogQuery& query) {
+    std::vector<CatalogRecord> result;
+    std::unordered_set<std::string> seen;
+    for (auto it = records.rbegin(); it != records.rend(); ++it) {
+        const bool latest = seen.insert(std::string(it->path) + '\0' + it->dataset).second;
+        if (latest && query.matches(*it)) result.push_back(*it);
+    }
+    std::reverse(result.begin(), result.end());
+    return result;
+}
+
+// 写入方的钩子, 集体调用, 在write7d之后: 计算校验和, 由rank 0登记; 返回的记录在所有进程上有效
+inline CatalogRecord catalog_config(const ProcessGrid& grid, const std::string& catalog,
+                                    const std::string& filename, const std::string& dataset_name,
+                                    const Array7D<std::complex<double>>& u,
+                                    double beta = std::nan(""), long long trajectory = -1) {
+    const uint64_t checksum = global_checksum(grid, u);
+    CatalogRecord record;
+    std::memset(&record, 0, sizeof(record));
+    int failed = 0;
+    std::string error;
+    if (grid.rank() == 0) {
+        TraceScope scope("catalog.append");
+        try {
+            record = describe_config(filename, dataset_name, beta, trajectory);
+            record.checksum = checksum;
+            append_catalog(catalog, record);
+        } catch (const H5::Exception& e) {
+            failed = 1;
+            error = e.getCDetailMsg();
+        } catch (const std::exception& e) {
+            failed = 1;
+            error = e.what();
+        }
+    }
+    MPI_Bcast(&failed, 1, MPI_INT, 0, grid.comm());
+    if (failed) throw std::runtime_error(grid.rank() == 0 ? error : "rank 0登记目录失败");
+    MPI_Bcast(&record, sizeof(record), MPI_BYTE, 0, grid.comm());
+    return record;
+}
+
+// 集体调用: 目录中filename/dataset_name最后一次登记的校验和, 没有登记或未计算时为0; 结果在所有进程上有效
+inline uint64_t catalog_checksum(const ProcessGrid& grid, const std::string& catalog,
+                                 const std::string& filename, const std::string& dataset_name) {
+    uint64_t checksum = 0;
+    int failed = 0;
+    std::string error;
+    if (grid.rank() == 0) {
+        try {
+            char resolved[PATH_MAX];
+            if (::realpath(filename.c_str(), resolved) == nullptr) throw std::runtime_error("找不到文件: " + filename);
+            CatalogQuery query;
+            query.path = resolved;
+            query.dataset = dataset_name;
+            for (const CatalogRecord& r : query_catalog(load_catalog(catalog), query)) {
+                if (query.path == r.path) checksum = r.checksum;
+            }
+        } catch (const std::exception& e) {
+            failed = 1;
+            error = e.what();
+        }
+    }
+    MPI_Bcast(&failed, 1, MPI_INT, 0, grid.comm());
+    if (failed) throw std::runtime_error(grid.rank() == 0 ? error : "rank 0查询目录失败");
+    MPI_Bcast(&checksum, 1, MPI_UINT64_T, 0, grid.comm());
+    return checksum;
+}
+
+// 集体调用: 按目录记录中的字节偏移直接用MPI-IO读取本进程的子格子, 不经过HDF5;
+// local_array需要预先按本地尺寸分配 (可以带ghost区), 只写入内部区域
+inline void read7d_at(const ProcessGrid& grid, const CatalogRecord& record,
+                      Array7D<std::complex<double>>& local_array) {
+    if (record.data_offset == kNoOffset) {
+        throw std::runtime_error(std::string(record.path) + " 不是连续布局, 请用read7d读取");
+    }
+    // 偏移只对登记时的文件有效: 文件被改写、重新打包或改变布局后大小或修改时间不同, 此时不按偏移读取
+    int unchanged = 0;
+    if (grid.rank() == 0) {
+        struct stat st;
+        unchanged = ::stat(record.path, &st) == 0 && static_cast<uint64_t>(st.st_size) == record.file_size &&
+                    static_cast<int64_t>(st.st_mtime) == record.mtime;
+    }
+    MPI_Bcast(&unchanged, 1, MPI_INT, 0, grid.comm());
+    if (!unchanged) {
+        throw std::runtime_error(std::string(record.path) + " 不存在或登记后已被修改, 请重新登记或用read7d读取");
+    }
+
+    const StridedView7D view = make_view(local_array);
+    const auto offset = grid.local_offset(
+        {local_array.get_Lx(), local_array.get_Ly(), local_array.get_Lz(), local_array.get_Lt()});
+    const std::array<hsize_t, 7> global = {
+        view.count[0], view.count[1] * grid.dim(T_DIM), view.count[2] * grid.dim(Z_DIM),
+        view.count[3] * grid.dim(Y_DIM), view.count[4] * grid.dim(X_DIM), view.count[5], view.count[6]
+    };
+    const std::array<hsize_t, 7> file_start = {0, offset[T_DIM], offset[Z_DIM], offset[Y_DIM], offset[X_DIM], 0, 0};
+    std::array<int, 7> sizes, subsizes, starts, mem_sizes, mem_starts;
+    for (int i = 0; i < 7; ++i) {
+        if (global[i] != record.dims[i]) throw std::runtime_error("本地数组尺寸与目录记录不一致");
+        if (view.extent[i] > INT_MAX || global[i] > INT_MAX) throw std::runtime_error("尺寸超出MPI-IO的int范围");
+        sizes[i] = static_cast<int>(global[i]);
+        subsizes[i] = static_cast<int>(view.count[i]);
+        starts[i] = static_cast<int>(file_start[i]);
+        mem_sizes[i] = static_cast<int>(view.extent[i]);
+        mem_starts[i] = static_cast<int>(view.offset[i]);
+    }
+
+    TraceScope scope("catalog.read_at");
+    MPI_Datatype filetype, memtype;
+    MPI_Type_create_subarray(7, sizes.data(), subsizes.data(), starts.data(), MPI_ORDER_C, MPI_DOUBLE, &filetype);
+    MPI_Type_create_subarray(7, mem_sizes.data(), subsizes.data(), mem_starts.data(), MPI_ORDER_C, MPI_DOUBLE,
+                             &memtype);
+    MPI_Type_commit(&filetype);
+    MPI_Type_commit(&memtype);
+
+    MPI_File fh;
+    int rc = MPI_File_open(grid.comm(), record.path, MPI_MODE_RDONLY, MPI_INFO_NULL, &fh);
+    if (rc == MPI_SUCCESS) {
+        char native[] = "native";
+        MPI_File_set_view(fh, static_cast<MPI_Offset>(record.data_offset), MPI_DOUBLE, filetype, native,
+                          MPI_INFO_NULL);
+        rc = MPI_File_read_all(fh, reinterpret_cast<double*>(local_array.data_ptr()), 1, memtype,
+                               MPI_STATUS_IGNORE);
+        MPI_File_close(&fh);
+    }
+    MPI_Type_free(&filetype);
+    MPI_Type_free(&memtype);
+    MPI_Allreduce(MPI_IN_PLACE, &rc, 1, MPI_INT, MPI_MAX, grid.comm());
+    if (rc != MPI_SUCCESS) throw std::runtime_error(std::string("按偏移读取失败: ") + record.path);
+}
@@ -0,0 +1,257 @@
+#pragma once
+
+#include <H5Cpp.h>
+#include <algorithm>
+#include <array>
+#include <complex>
+#include <cstdint>
+#include <string>
+#include <stdexcept>
+#include <vector>
+
+#include "grid.h"
+#include "lattice_io.h"
+#include "public.h"
+#include "trace.h"
+
+// 一个HMC检查点包含的多个数据集: 规范场、共轭动量等分布式的Array7D,
+// 各进程的随机数状态, 以及只由rank 0写的小数组; 标量存为根组的属性
+// 所有数据集先全部创建, 再用一次H5Dwrite_multi (HDF5 >= 1.14) 集体写入,
+// 集体调用次数从数据集个数降到1; 较老的HDF5逐个数据集集体写入
+// read()按同样的方式读回到注册的数组中
+class Checkpoint {
+private:
+    struct Entry {
+        std::string name;
+        H5::PredType type;
+        std::vector<hsize_t> dims;          // 全局尺寸
+        std::vector<hsize_t> start, count;  // 本进程负责的部分
+        bool rank0_writes;                  // 各进程相同的数据, 只由rank 0写
+        bool is7d;
+        StridedView7D view;                 // is7d时使用
+        std::array<hsize_t, 7> file_offset;
+        void* data;
+
+        size_t local_bytes() const {
+            size_t n = type.getSize();
+            if (is7d) {
+                for (hsize_t c : view.count) n *= c;
+            } else {
+                for (hsize_t c : count) n *= c;
+            }
+            return n;
+        }
+    };
+
+    const ProcessGrid& grid_;
+    IoOptions options_;
+    std::vector<Entry> entries_;
+    std::vector<std::pair<std::string, double>> scalars_;
+    bool use_multi_ = true;
+    int collective_calls_ = 0;
+
+    // 本进程在文件和内存中的选择
+    void select(const Entry& entry, bool write, H5::DataSpace& memspace, H5::DataSpace& filespace) const {
+        if (entry.is7d) {
+            memspace = view_memspace(entry.view);
+            filespace.selectHyperslab(H5S_SELECT_SET, entry.view.count.data(), entry.file_offset.data());
+        } else if (write && entry.rank0_writes && grid_.rank() != 0) {
+            const hsize_t one = 1;
+            memspace = H5::DataSpace(1, &one);
+            memspace.selectNone();
+            filespace.selectNone();
+        } else {
+            memspace = H5::DataSpace(entry.count.size(), entry.count.data());
+            filespace.selectHyperslab(H5S_SELECT_SET, entry.count.data(), entry.start.data());
+        }
+    }
+
+    // 超过单次传输上限的数据集必须拆分, 不能放进一次多数据集调用
+    bool multi_possible() const {
+#if H5_VERSION_GE(1, 14, 0)
+        if (!use_multi_) return false;
+        int fits = 1;
+        for (const Entry& entry : entries_) {
+            if (entry.local_bytes() > options_.max_transfer_bytes) fits = 0;
+        }
+        MPI_Allreduce(MPI_IN_PLACE, &fits, 1, MPI_INT, MPI_MIN, grid_.comm());
+        return fits != 0;
+#else
+        return false;
+#endif
+    }
+
+    template <bool Write>
+    void transfer(std::vector<H5::DataSet>& datasets) {
+        H5::DSetMemXferPropList xfer_plist = make_dxpl(options_);
+        const size_t n = entries_.size();
+        std::vector<H5::DataSpace> memspaces(n), filespaces(n);
+        for (size_t i = 0; i < n; ++i) {
+            filespaces[i] = datasets[i].getSpace();
+            select(entries_[i], Write, memspaces[i], filespaces[i]);
+        }
+
+        if (multi_possible()) {
+#if H5_VERSION_GE(1, 14, 0)
+            std::vector<hid_t> dset_ids(n), type_ids(n), mem_ids(n), file_ids(n);
+            std::vector<void*> buffers(n);
+            for (size_t i = 0; i < n; ++i) {
+                dset_ids[i] = datasets[i].getId();
+                type_ids[i] = entries_[i].type.getId();
+                mem_ids[i] = memspaces[i].getId();
+                file_ids[i] = filespaces[i].getId();
+                buffers[i] = entries_[i].data;
+            }
+            TraceScope scope(Write ? "checkpoint.write_multi" : "checkpoint.read_multi");
+            herr_t status;
+            if (Write) {
+                std::vector<const void*> const_buffers(buffers.begin(), buffers.end());
+                status = H5Dwrite_multi(n, dset_ids.data(), type_ids.data(), mem_ids.data(), file_ids.data(),
+                                        xfer_plist.getId(), const_buffers.data());
+            } else {
+                status = H5Dread_multi(n, dset_ids.data(), type_ids.data(), mem_ids.data(), file_ids.data(),
+                                       xfer_plist.getId(), buffers.data());
+            }
+            if (status < 0) throw std::runtime_error("多数据集集体传输失败");
+            ++collective_calls_;
+            trace_mpio(xfer_plist, options_.collective);
+            return;
+#endif
+        }
+
+        // 逐个数据集集体传输, 大的本地块再按max_transfer_bytes拆分
+        for (size_t i = 0; i < n; ++i) {
+            const Entry& entry = entries_[i];
+            auto call = [&](const H5::DataSpace& mem, const H5::DataSpace& file) {
+                if (Write) {
+                    datasets[i].write(entry.data, entry.type, mem, file, xfer_plist);
+                } else {
+                    datasets[i].read(entry.data, entry.type, mem, file, xfer_plist);
+                }
+                ++collective_calls_;
+                trace_mpio(xfer_plist, options_.collective);
+            };
+            if (entry.is7d) {
+                transfer_pieces(grid_.comm(), entry.view, entry.file_offset, memspaces[i], filespaces[i],
+                                options_, call);
+            } else {
+                TraceScope scope("transfer");
+                call(memspaces[i], filespaces[i]);
+            }
+        }
+    }
+
+public:
+    explicit Checkpoint(const ProcessGrid& grid, const IoOptions& options = IoOptions())
+        : grid_(grid), options_(options) {}
+
+    // 分布式场, 全局尺寸 [4, Lt, Lz, Ly, Lx, Nc, 2*Nc], 与write7d的布局相同
+    void add(const std::string& name, Array7D<std::complex<double>>& field) {
+        Entry entry{name, H5::PredType::NATIVE_DOUBLE, {}, {}, {}, false, true, make_view(field), {}, nullptr};
+        const auto& count = entry.view.count;
+        entry.dims = {
+            count[0], count[1] * grid_.dim(T_DIM), count[2] * grid_.dim(Z_DIM),
+            count[3] * grid_.dim(Y_DIM), count[4] * grid_.dim(X_DIM), count[5], count[6]
+        };
+        const auto offset = grid_.local_offset({count[4], count[3], count[2], count[1]});
+        entry.file_offset = {0, offset[T_DIM], offset[Z_DIM], offset[Y_DIM], offset[X_DIM], 0, 0};
+        entry.data = reinterpret_cast<double*>(field.data_ptr());
+        entries_.push_back(entry);
+    }
+
+    // 每个进程各一份的状态 (如随机数发生器), 数据集为 [进程数, n], 各进程的n必须相同
+    void add_per_rank(const std::string& name, std::vector<uint64_t>& state) {
+        unsigned long long n = state.size(), n_max = 0;
+        MPI_Allreduce(&n, &n_max, 1, MPI_UNSIGNED_LONG_LONG, MPI_MAX, grid_.comm());
+        if (n != n_max) throw std::runtime_error("各进程的 " + name + " 长度不一致");
+        Entry entry{name, H5::PredType::NATIVE_UINT64,
+                    {static_cast<hsize_t>(grid_.size()), n}, {static_cast<hsize_t>(grid_.rank()), 0}, {1, n},
+                    false, false, StridedView7D(), {}, state.data()};
+        entries_.push_back(entry);
+    }
+
+    // 各进程相同的小数组, 只由rank 0写出, 读取时每个进程都读
+    void add_shared(const std::string& name, std::vector<double>& values) {
+        Entry entry{name, H5::PredType::NATIVE_DOUBLE, {values.size()}, {0}, {values.size()},
+                    true, false, StridedView7D(), {}, values.data()};
+        entries_.push_back(entry);
+    }
+
+    // 标量存为根组的属性, 与数据一起写出
+    void set_scalar(const std::string& name, double value) {
+        for (auto& scalar : scalars_) {
+            if (scalar.first == name) {
+                scalar.second = value;
+                return;
+            }
+        }
+        scalars_.emplace_back(name, value);
+    }
+
+    double scalar(const std::string& name) const {
+        for (const auto& scalar : scalars_) {
+            if (scalar.first == name) return scalar.second;
+        }
+        throw std::runtime_error("检查点中没有标量 " + name);
+    }
+
+    // false时即使HDF5支持也逐个数据集写入, 用于对比
+    void set_multi(bool use_multi) { use_multi_ = use_multi; }
+
+    // 上一次write()/read()中数据传输的集体调用次数
+    int collective_calls() const { return collective_calls_; }
+
+    void write(const std::string& filename) {
+        Hdf5Lock hdf5_lock;
+        collective_calls_ = 0;
+        TraceScope file_scope("file.create");
+        H5::H5File file(filename, H5F_ACC_TRUNC, H5::FileCreatPropList::DEFAULT,
+                        make_fapl(grid_.comm(), options_));
+        file_scope.finish();
+
+        std::vector<H5::DataSet> datasets;
+        {
+            TraceScope scope("dataset.create");
+            for (const Entry& entry : entries_) {
+                H5::DataSpace space(entry.dims.size(), entry.dims.data());
+                datasets.push_back(file.createDataSet(entry.name, entry.type, space));
+            }
+            H5::Group root = file.openGroup("/");
+            for (const auto& scalar : scalars_) {
+                root.createAttribute(scalar.first, H5::PredType::NATIVE_DOUBLE, H5::DataSpace())
+                    .write(H5::PredType::NATIVE_DOUBLE, &scalar.second);
+            }
+        }
+
+        transfer<true>(datasets);
+
+        TraceScope close_scope("file.close");
+        datasets.clear();
+        file.close();
+    }
+
+    // 读回到注册的数组中, 尺寸必须与文件一致; 标量从属性读出
+    void read(const std::string& filename) {
+        Hdf5Lock hdf5_lock;
+        collective_calls_ = 0;
+        H5::H5File file = open7d(grid_, filename, options_);
+        std::vector<H5::DataSet> datasets;
+        for (const Entry& entry : entries_) {
+            datasets.push_back(file.openDataSet(entry.name));
+            std::vector<hsize_t> dims(entry.dims.size());
+            H5::DataSpace space = datasets.back().getSpace();
+            if (space.getSimpleExtentNdims() != static_cast<int>(dims.size())) {
+                throw std::runtime_error("数据集 " + entry.name + " 的维数与注册的数组不一致");
+            }
+            space.getSimpleExtentDims(dims.data());
+            if (dims != entry.dims) {
+                throw std::runtime_error("数据集 " + entry.name + " 的尺寸与注册的数组不一致");
+            }
+        }
+        H5::Group root = file.openGroup("/");
+        for (auto& scalar : scalars_) {
+            root.openAttribute(scalar.first).read(H5::PredType::NATIVE_DOUBLE, &scalar.second);
+        }
+        transfer<false>(datasets);
+    }
+};
@@ -0,0 +1,306 @@
+#pragma once
+
+#include <H5Cpp.h>
+#include <algorithm>
+#include <array>
+#include <complex>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <stdexcept>
+#include <vector>
+
+#include "grid.h"
+#include "lattice_io.h"
+#include "public.h"
+
+// 一次增量写入的统计 (全局)
+struct DeltaStats {
+    size_t dirty_chunks = 0;
+    size_t total_chunks = 0;
+    double bytes_written = 0;
+    bool full = false;        // 文件不存在或尺寸不同, 整体重写
+};
+
+// 按chunk增量写检查点: 数据集使用分块布局, chunk为 [1, chunk_t, lz, ly, lx, Nc, 2*Nc],
+// 即一个方向上某个进程本地块的chunk_t个t切片, 每个chunk只属于一个进程
+// 每个进程散列自己的chunk, 与上次检查点的散列(内存中保存, 文件中存为属性chunk_hashes)比较,
+// 只原地重写变化的chunk; 写入量随变化量而不是格子大小增长
+// 文件中始终是最新状态, 普通的read7d即可读取; load()在读取的同时校验散列
+class DeltaCheckpoint {
+private:
+    const ProcessGrid& grid_;
+    std::string filename_;
+    std::string dataset_name_;
+    size_t chunk_t_;
+    IoOptions options_;
+    std::vector<uint64_t> hashes_;    // 上次写入或读入的全局chunk散列, 空表示未知
+
+    // 散列算法的版本, 存为属性hash_version; 版本不同的旧散列无法比较, 下次commit()整体重写一次
+    static constexpr unsigned hash_version = 2;
+
+    H5::FileAccPropList delta_fapl() const {
+        H5::FileAccPropList plist = make_fapl(grid_.comm(), options_);
+        // 散列表可能超过64 KiB, 需要1.8以后的格式才能存为大属性
+        H5Pset_libver_bounds(plist.getId(), H5F_LIBVER_V18, H5F_LIBVER_LATEST);
+        return plist;
+    }
+
+    // 本地块的尺寸和在全局中的偏移, 顺序 [dim, t, z, y, x, c1, 2*c2]
+    struct Layout {
+        std::array<hsize_t, 7> global, local, offset;
+        size_t chunks_t;             // 全局t方向的chunk数
+        size_t local_chunks_t;       // 本地t方向的chunk数
+
+        size_t total() const {
+            return global[0] * chunks_t * (global[2] / local[2]) * (global[3] / local[3]) * (global[4] / local[4]);
+        }
+        // 本进程第(dim, tc)个chunk的全局编号
+        size_t index(size_t dim, size_t tc) const {
+            const size_t gt = offset[1] / local[1] * local_chunks_t + tc;
+            const size_t gz = offset[2] / local[2], gy = offset[3] / local[3], gx = offset[4] / local[4];
+            return (((dim * chunks_t + gt) * (global[2] / local[2]) + gz) * (global[3] / local[3]) + gy)
+                   * (global[4] / local[4]) + gx;
+        }
+    };
+
+    Layout layout(const StridedView7D& view) const {
+        Layout l;
+        l.local = view.count;
+        if (l.local[1] % chunk_t_ != 0) {
+            throw std::runtime_error("chunk_t必须整除本地t方向大小");
+        }
+        l.global = {
+            l.local[0], l.local[1] * grid_.dim(T_DIM), l.local[2] * grid_.dim(Z_DIM),
+            l.local[3] * grid_.dim(Y_DIM), l.local[4] * grid_.dim(X_DIM), l.local[5], l.local[6]
+        };
+        const auto offset = grid_.local_offset({l.local[4], l.local[3], l.local[2], l.local[1]});
+        l.offset = {0, offset[T_DIM], offset[Z_DIM], offset[Y_DIM], offset[X_DIM], 0, 0};
+        l.local_chunks_t = l.local[1] / chunk_t_;
+        l.chunks_t = l.global[1] / chunk_t_;
+        return l;
+    }
+
+    // 本进程各chunk的散列, 填到全局表中自己的位置上, 其余为0
+    // 直接在数组中按x行逐字散列, 行之间通过种子串联, 不需要先打包chunk
+    std::vector<uint64_t> hash_chunks(const Array7D<std::complex<double>>& local_array, const Layout& l) const {
+        std::vector<uint64_t> hashes(l.total(), 0);
+        const size_t row_bytes = l.local[4] * l.local[5] * l.local[6] * sizeof(double);
+        for (size_t dim = 0; dim < l.local[0]; ++dim) {
+            for (size_t tc = 0; tc < l.local_chunks_t; ++tc) {
+                uint64_t h = 14695981039346656037ULL;
+                for (size_t t = tc * chunk_t_; t < (tc + 1) * chunk_t_; ++t) {
+                    for (size_t z = 0; z < l.local[2]; ++z) {
+                        for (size_t y = 0; y < l.local[3]; ++y) {
+                            h = fnv1a64_words(local_array.site_ptr(dim, t, z, y, 0), row_bytes, h);
+                        }
+                    }
+                }
+                hashes[l.index(dim, tc)] = h;
+            }
+        }
+        return hashes;
+    }
+
+    bool file_exists() const {
+        int exists = 0;
+        if (grid_.rank() == 0) exists = std::ifstream(filename_).good() ? 1 : 0;
+        MPI_Bcast(&exists, 1, MPI_INT, 0, grid_.comm());
+        return exists != 0;
+    }
+
+    static bool current_hash_version(const H5::DataSet& dataset) {
+        if (!dataset.attrExists("hash_version")) return false;
+        unsigned version = 0;
+        dataset.openAttribute("hash_version").read(H5::PredType::NATIVE_UINT, &version);
+        return version == hash_version;
+    }
+
+    // 从已有文件读出散列表; 数据集不兼容时返回空表
+    // 散列按chunk的全局位置编号, 只有chunk形状 (即本地块尺寸) 相同时编号才对应同一区域;
+    // 换了进程网格而chunk数恰好相同时也要整体重写
+    std::vector<uint64_t> read_hashes(const H5::DataSet& dataset, const Layout& l) const {
+        if (dataset_dims7d(dataset) != l.global || !dataset.attrExists("chunk_hashes") ||
+            !dataset.attrExists("chunk_t") || !current_hash_version(dataset)) {
+            return {};
+        }
+        const H5::DSetCreatPropList dcpl = dataset.getCreatePlist();
+        if (dcpl.getLayout() != H5D_CHUNKED) return {};
+        std::array<hsize_t, 7> chunk;
+        if (dcpl.getChunk(static_cast<int>(chunk.size()), chunk.data()) != static_cast<int>(chunk.size())) return {};
+        const std::array<hsize_t, 7> expected = {1, chunk_t_, l.local[2], l.local[3], l.local[4], l.local[5],
+                                                 l.local[6]};
+        if (chunk != expected) return {};
+        unsigned long long chunk_t = 0;
+        dataset.openAttribute("chunk_t").read(H5::PredType::NATIVE_ULLONG, &chunk_t);
+        H5::Attribute attr = dataset.openAttribute("chunk_hashes");
+        if (chunk_t != chunk_t_ || attr.getSpace().getSimpleExtentNpoints() != static_cast<hssize_t>(l.total())) {
+            return {};
+        }
+        std::vector<uint64_t> hashes(l.total());
+        attr.read(H5::PredType::NATIVE_UINT64, hashes.data());
+        return hashes;
+    }
+
+    void write_hashes(H5::DataSet& dataset, const std::vector<uint64_t>& hashes) const {
+        if (dataset.attrExists("chunk_hashes")) dataset.removeAttr("chunk_hashes");
+        const hsize_t n = hashes.size();
+        H5::DataSpace space(1, &n);
+        dataset.createAttribute("chunk_hashes", H5::PredType::NATIVE_UINT64, space)
+            .write(H5::PredType::NATIVE_UINT64, hashes.data());
+        if (!dataset.attrExists("chunk_t")) {
+            const unsigned long long chunk_t = chunk_t_;
+            dataset.createAttribute("chunk_t", H5::PredType::NATIVE_ULLONG, H5::DataSpace())
+                .write(H5::PredType::NATIVE_ULLONG, &chunk_t);
+        }
+        if (!dataset.attrExists("hash_version")) {
+            const unsigned version = hash_version;
+            dataset.createAttribute("hash_version", H5::PredType::NATIVE_UINT, H5::DataSpace())
+                .write(H5::PredType::NATIVE_UINT, &version);
+        }
+    }
+
+    H5::DataSet create_dataset(H5::H5File& file, const Layout& l) const {
+        H5::DSetCreatPropList dcpl;
+        const std::array<hsize_t, 7> chunk = {1, chunk_t_, l.local[2], l.local[3], l.local[4], l.local[5], l.local[6]};
+        dcpl.setChunk(chunk.size(), chunk.data());
+        // 全部chunk都会被写入, 不需要先写填充值
+        dcpl.setFillTime(H5D_FILL_TIME_NEVER);
+        H5::DataSpace filespace(l.global.size(), l.global.data());
+        return file.createDataSet(dataset_name_, H5::PredType::NATIVE_DOUBLE, filespace, dcpl);
+    }
+
+public:
+    DeltaCheckpoint(const ProcessGrid& grid, const std::string& filename,
+                    const std::string& dataset_name, size_t chunk_t = 1,
+                    const IoOptions& options = IoOptions())
+        : grid_(grid), filename_(filename), dataset_name_(dataset_name),
+          chunk_t_(std::max<size_t>(1, chunk_t)), options_(options) {}
+
+    // 写入local_array, 只重写与上次检查点不同的chunk
+    DeltaStats commit(const Array7D<std::complex<double>>& local_array) {
+        const StridedView7D view = make_view(local_array);
+        const Layout l = layout(view);
+
+        std::vector<uint64_t> hashes = hash_chunks(local_array, l);
+        MPI_Allreduce(MPI_IN_PLACE, hashes.data(), static_cast<int>(hashes.size()),
+                      MPI_UINT64_T, MPI_BOR, grid_.comm());
+
+        DeltaStats stats;
+        stats.total_chunks = hashes.size();
+
+        Hdf5Lock hdf5_lock;
+        std::unique_ptr<H5::H5File> file;
+        H5::DataSet dataset;
+        if (file_exists()) {
+            file.reset(new H5::H5File(filename_, H5F_ACC_RDWR, H5::FileCreatPropList::DEFAULT,
+                                      delta_fapl()));
+            if (file->nameExists(dataset_name_)) {
+                dataset = file->openDataSet(dataset_name_);
+                if (hashes_.size() != hashes.size()) hashes_ = read_hashes(dataset, l);
+                // 尺寸或分块不兼容时重建数据集
+                if (hashes_.empty()) {
+                    dataset.close();
+                    file->unlink(dataset_name_);
+                }
+            } else {
+                hashes_.clear();
+            }
+        } else {
+            file.reset(new H5::H5File(filename_, H5F_ACC_TRUNC, H5::FileCreatPropList::DEFAULT,
+                                      delta_fapl()));
+            hashes_.clear();
+        }
+        if (hashes_.empty()) {
+            dataset = create_dataset(*file, l);
+            stats.full = true;
+        }
+
+        // 本进程需要重写的chunk
+        std::vector<std::array<size_t, 2>> dirty;
+        for (size_t dim = 0; dim < l.local[0]; ++dim) {
+            for (size_t tc = 0; tc < l.local_chunks_t; ++tc) {
+                const size_t k = l.index(dim, tc);
+                if (stats.full || hashes_[k] != hashes[k]) dirty.push_back({dim, tc});
+            }
+        }
+
+        // 按max_transfer_bytes分批, 每批是若干chunk的并集选择; 各进程调用次数相同
+        size_t chunk_elems = chunk_t_;
+        for (int i = 2; i < 7; ++i) chunk_elems *= l.local[i];
+        const size_t per_batch = std::max<size_t>(1, options_.max_transfer_bytes / (chunk_elems * sizeof(double)));
+        long long batches = static_cast<long long>((dirty.size() + per_batch - 1) / per_batch);
+        MPI_Allreduce(MPI_IN_PLACE, &batches, 1, MPI_LONG_LONG, MPI_MAX, grid_.comm());
+
+        H5::DSetMemXferPropList xfer_plist = make_dxpl(options_);
+
+        H5::DataSpace memspace(view.extent.size(), view.extent.data());
+        H5::DataSpace filespace = dataset.getSpace();
+        std::array<hsize_t, 7> count = {1, chunk_t_, l.local[2], l.local[3], l.local[4], l.local[5], l.local[6]};
+        for (long long b = 0; b < batches; ++b) {
+            const size_t first = b * per_batch;
+            const size_t last = std::min(dirty.size(), first + per_batch);
+            if (first >= last) {
+                memspace.selectNone();
+                filespace.selectNone();
+            }
+            for (size_t i = first; i < last; ++i) {
+                const H5S_seloper_t op = i == first ? H5S_SELECT_SET : H5S_SELECT_OR;
+                const std::array<hsize_t, 7> mem_start = {
+                    view.offset[0] + dirty[i][0] * view.stride[0],
+                    view.offset[1] + dirty[i][1] * chunk_t_ * view.stride[1],
+                    view.offset[2], view.offset[3], view.offset[4], view.offset[5], view.offset[6]
+                };
+                const std::array<hsize_t, 7> file_start = {
+                    dirty[i][0], l.offset[1] + dirty[i][1] * chunk_t_, l.offset[2], l.offset[3], l.offset[4], 0, 0
+                };
+                memspace.selectHyperslab(op, count.data(), mem_start.data(), view.stride.data());
+                filespace.selectHyperslab(op, count.data(), file_start.data());
+            }
+            dataset.write(view.ptr, H5::PredType::NATIVE_DOUBLE, memspace, filespace, xfer_plist);
+        }
+
+        write_hashes(dataset, hashes);
+        hashes_.swap(hashes);
+
+        unsigned long long local_dirty = dirty.size(), total_dirty = 0;
+        MPI_Allreduce(&local_dirty, &total_dirty, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, grid_.comm());
+        stats.dirty_chunks = total_dirty;
+        stats.bytes_written = static_cast<double>(total_dirty) * chunk_elems * sizeof(double);
+        return stats;
+    }
+
+    // 读取最新状态, 并用文件中的散列校验; 之后的commit()以读入的内容为基准
+    void load(Array7D<std::complex<double>>& local_array) {
+        Hdf5Lock hdf5_lock;
+        H5::H5File file = open7d(grid_, filename_, options_);
+        H5::DataSet dataset = file.openDataSet(dataset_name_);
+        read7d(grid_, dataset, local_array, options_);
+
+        const StridedView7D view = make_view(local_array);
+        const Layout l = layout(view);
+        // 旧版本的散列无法校验: 只读入数据, 下次commit()整体重写并写入新散列
+        if (dataset.attrExists("chunk_hashes") && !current_hash_version(dataset)) {
+            hashes_.clear();
+            return;
+        }
+        std::vector<uint64_t> stored = read_hashes(dataset, l);
+        if (stored.empty()) {
+            throw std::runtime_error(filename_ + " 不是增量检查点或分块不一致");
+        }
+        std::vector<uint64_t> hashes = hash_chunks(local_array, l);
+        int bad = 0;
+        for (size_t dim = 0; dim < l.local[0]; ++dim) {
+            for (size_t tc = 0; tc < l.local_chunks_t; ++tc) {
+                const size_t k = l.index(dim, tc);
+                if (hashes[k] != stored[k]) ++bad;
+            }
+        }
+        MPI_Allreduce(MPI_IN_PLACE, &bad, 1, MPI_INT, MPI_SUM, grid_.comm());
+        if (bad > 0) {
+            throw std::runtime_error("检查点校验失败: " + std::to_string(bad) + " 个chunk的散列不一致");
+        }
+        hashes_.swap(stored);
+    }
+};
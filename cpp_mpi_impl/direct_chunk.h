@@ -0,0 +1,624 @@
+#pragma once
+
+#include <H5Cpp.h>
+#include <mpi.h>
+#include <zlib.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <climits>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "grid.h"
+#include "lattice_io.h"
+#include "public.h"
+#include "trace.h"
+
+// 预压缩的直接chunk写入: chunk为 [1, chunk_t, lz, ly, lx, Nc, 2*Nc], 每个chunk只属于一个进程;
+// 各进程用线程池自己做shuffle+deflate, 再用H5Dwrite_chunk绕过HDF5的过滤器管线写入,
+// 压缩吞吐随每个节点的核数增长, 而不受库内部压缩路径的限制
+// 文件中是普通的shuffle+deflate分块数据集, 任何HDF5读取方式 (包括read7d) 都能读
+//
+// 并行HDF5不支持H5Dwrite_chunk/H5Dread_chunk (chunk索引的修改必须在所有进程上一致),
+// 因此写入时各进程把压缩好的chunk发给rank 0, 由它以串行方式打开文件依次写入,
+// chunk在文件中的空间分配只有一个进程在做, 不会冲突; rank 0一边写一边接收下一个进程的数据
+// 所有压缩后的数据都经过rank 0一个进程, 写入带宽受限于它的网络和单进程写文件的速度, 不随进程数增长;
+// ChunkStats分开报告rank 0等待接收和调用HDF5写入的用时, 用来判断瓶颈在哪一边
+// 读取不修改元数据, 各进程以串行方式只读打开文件, 各自读取并在线程池中解压自己的chunk
+//
+// 有损模式 (tolerance或relative_tolerance大于0) 用于分析用的副本, 生产检查点保持默认的无损:
+// 每个实数按步长 2*tolerance 量化为整数 q = round(v / step), 误差不超过tolerance;
+// 按全局最大的|q|选16位或32位整数存储, 再做shuffle+deflate
+// 数据集为整数类型, 属性quantization_step/tolerance (以及relative_tolerance) 记录量化参数,
+// 其他读取方式乘以quantization_step即可还原; read7d_direct自动识别并还原
+struct ChunkCodec {
+    int level = 1;            // deflate压缩级别 1-9
+    bool shuffle = true;      // 先按字节重排 (HDF5 shuffle过滤器的格式), 对浮点数压缩率明显更好
+    unsigned threads = 0;     // 每个进程的压缩线程数, 0表示节点核数除以节点内进程数
+    double tolerance = 0;            // 绝对误差上限, 0表示无损
+    double relative_tolerance = 0;   // 相对于全局最大|v|的误差上限; 与tolerance都给出时取较严的一个
+};
+
+// 一次写入或读取的全局统计
+struct ChunkStats {
+    size_t chunks = 0;
+    double raw_bytes = 0;
+    double stored_bytes = 0;
+    double codec_seconds = 0;   // 各进程压缩/解压用时的最大值
+    double io_seconds = 0;      // 写入/读取文件的用时
+    double gather_seconds = 0;  // 写入时rank 0等待接收其他进程chunk的用时 (io_seconds的一部分)
+    double write_seconds = 0;   // 写入时rank 0创建数据集、H5Dwrite_chunk和关闭文件的用时 (io_seconds的一部分)
+    double tolerance = 0;       // 有损模式实际使用的绝对误差上限, 无损为0
+};
+
+namespace detail {
+
+// 节点内进程数平分节点的核
+inline unsigned codec_threads(MPI_Comm comm, unsigned threads) {
+    if (threads > 0) return threads;
+    MPI_Comm node_comm;
+    MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &node_comm);
+    int node_size = 1;
+    MPI_Comm_size(node_comm, &node_size);
+    MPI_Comm_free(&node_comm);
+    const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    return std::max(1u, cores / static_cast<unsigned>(node_size));
+}
+
+// 用threads个线程 (含调用线程) 执行 body(0..n-1), 任一调用抛出异常时停止分配并在最后重新抛出
+template <typename Body>
+inline void parallel_chunks(size_t n, unsigned threads, Body&& body) {
+    std::atomic<size_t> next(0);
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    auto worker = [&] {
+        try {
+            for (size_t i = next++; i < n; i = next++) body(i);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(error_mutex);
+            if (!error) error = std::current_exception();
+            next = n;
+        }
+    };
+    std::vector<std::thread> pool;
+    for (size_t k = 1; k < std::min<size_t>(threads, n); ++k) pool.emplace_back(worker);
+    worker();
+    for (std::thread& t : pool) t.join();
+    if (error) std::rethrow_exception(error);
+}
+
+// HDF5 shuffle过滤器的字节重排: 所有元素的第0字节, 再所有元素的第1字节, ...
+inline void shuffle_bytes(const unsigned char* in, unsigned char* out, size_t elements, size_t width) {
+    for (size_t b = 0; b < width; ++b) {
+        for (size_t i = 0; i < elements; ++i) out[b * elements + i] = in[i * width + b];
+    }
+}
+
+inline void unshuffle_bytes(const unsigned char* in, unsigned char* out, size_t elements, size_t width) {
+    for (size_t b = 0; b < width; ++b) {
+        for (size_t i = 0; i < elements; ++i) out[i * width + b] = in[b * elements + i];
+    }
+}
+
+// 量化为整数, |v - q * step| <= step / 2
+template <typename Int>
+inline std::vector<unsigned char> quantize(const std::vector<double>& packed, double step) {
+    std::vector<unsigned char> out(packed.size() * sizeof(Int));
+    Int* q = reinterpret_cast<Int*>(out.data());
+    for (size_t i = 0; i < packed.size(); ++i) q[i] = static_cast<Int>(std::llround(packed[i] / step));
+    return out;
+}
+
+template <typename Int>
+inline void dequantize(const unsigned char* in, double* out, size_t elements, double step) {
+    const Int* q = reinterpret_cast<const Int*>(in);
+    for (size_t i = 0; i < elements; ++i) out[i] = q[i] * step;
+}
+
+// 有损模式的参数, step为0表示无损
+struct Quantization {
+    double step = 0;
+    size_t width = sizeof(double);   // 文件中每个元素的字节数
+};
+
+// 集体调用: 按全局最大|v|确定量化步长和整数宽度
+inline Quantization choose_quantization(MPI_Comm comm, const Array7D<std::complex<double>>& a,
+                                        const ChunkCodec& codec) {
+    Quantization quant;
+    if (codec.tolerance < 0 || codec.relative_tolerance < 0) throw std::runtime_error("误差上限不能为负");
+    if (codec.tolerance == 0 && codec.relative_tolerance == 0) return quant;
+
+    double max_abs = 0;
+    const size_t row = a.get_Lx() * a.get_Nc() * a.get_Nc();
+    for (size_t mu = 0; mu < Nd; ++mu)
+        for (size_t t = 0; t < a.get_Lt(); ++t)
+            for (size_t z = 0; z < a.get_Lz(); ++z)
+                for (size_t y = 0; y < a.get_Ly(); ++y) {
+                    const std::complex<double>* p = a.site_ptr(mu, t, z, y, 0);
+                    for (size_t i = 0; i < row; ++i) {
+                        max_abs = std::max({max_abs, std::abs(p[i].real()), std::abs(p[i].imag())});
+                    }
+                }
+    MPI_Allreduce(MPI_IN_PLACE, &max_abs, 1, MPI_DOUBLE, MPI_MAX, comm);
+
+    double tolerance = codec.tolerance;
+    if (codec.relative_tolerance > 0) {
+        const double relative = codec.relative_tolerance * max_abs;
+        tolerance = tolerance > 0 ? std::min(tolerance, relative) : relative;
+    }
+    if (!(tolerance > 0)) throw std::runtime_error("数据全为0, 无法按相对误差量化");
+    quant.step = 2 * tolerance;
+    const double max_q = std::ceil(max_abs / quant.step) + 1;
+    if (max_q <= INT16_MAX) {
+        quant.width = sizeof(int16_t);
+    } else if (max_q <= INT32_MAX) {
+        quant.width = sizeof(int32_t);
+    } else {
+        throw std::runtime_error("误差上限相对数据范围过小, 请使用无损模式");
+    }
+    return quant;
+}
+
+// zlib格式, 与HDF5 deflate过滤器一致; src为elements个width字节的元素
+inline std::vector<unsigned char> deflate_chunk(const unsigned char* src, size_t elements, size_t width,
+                                                const ChunkCodec& codec) {
+    const size_t bytes = elements * width;
+    std::vector<unsigned char> shuffled;
+    if (codec.shuffle) {
+        shuffled.resize(bytes);
+        shuffle_bytes(src, shuffled.data(), elements, width);
+        src = shuffled.data();
+    }
+    uLongf out_bytes = compressBound(bytes);
+    std::vector<unsigned char> out(out_bytes);
+    if (compress2(out.data(), &out_bytes, src, bytes, codec.level) != Z_OK) {
+        throw std::runtime_error("chunk压缩失败");
+    }
+    out.resize(out_bytes);
+    return out;
+}
+
+// 解出elements个width字节的元素; shuffled/deflated: 写入时实际做了的过滤步骤
+inline void inflate_chunk(const std::vector<unsigned char>& stored, unsigned char* out, size_t elements,
+                          size_t width, bool shuffled, bool deflated) {
+    const size_t bytes = elements * width;
+    std::vector<unsigned char> raw;
+    const unsigned char* src = stored.data();
+    if (deflated) {
+        raw.resize(bytes);
+        uLongf raw_bytes = bytes;
+        if (uncompress(raw.data(), &raw_bytes, stored.data(), stored.size()) != Z_OK || raw_bytes != bytes) {
+            throw std::runtime_error("chunk解压失败");
+        }
+        src = raw.data();
+    } else if (stored.size() != bytes) {
+        throw std::runtime_error("未压缩chunk的大小不正确");
+    }
+    if (shuffled) {
+        unshuffle_bytes(src, out, elements, width);
+    } else {
+        std::memcpy(out, src, bytes);
+    }
+}
+
+// 按max_bytes (不超过INT_MAX) 拆分的字节收发
+inline void send_bytes(const unsigned char* data, size_t bytes, int dest, int tag, MPI_Comm comm, size_t max_bytes) {
+    const size_t piece = std::max<size_t>(1, std::min<size_t>(max_bytes, INT_MAX));
+    for (size_t pos = 0; pos < bytes; pos += piece) {
+        MPI_Send(data + pos, static_cast<int>(std::min(piece, bytes - pos)), MPI_BYTE, dest, tag, comm);
+    }
+}
+
+inline std::vector<MPI_Request> irecv_bytes(unsigned char* data, size_t bytes, int source, int tag, MPI_Comm comm,
+                                            size_t max_bytes) {
+    const size_t piece = std::max<size_t>(1, std::min<size_t>(max_bytes, INT_MAX));
+    std::vector<MPI_Request> requests;
+    for (size_t pos = 0; pos < bytes; pos += piece) {
+        requests.emplace_back();
+        MPI_Irecv(data + pos, static_cast<int>(std::min(piece, bytes - pos)), MPI_BYTE, source, tag, comm,
+                  &requests.back());
+    }
+    return requests;
+}
+
+// 本地块在数据集中的chunk划分, 本进程的第k个chunk为方向 k / local_chunks_t 上的第 k % local_chunks_t 个t块
+struct ChunkLayout {
+    std::array<hsize_t, 7> global, local, offset, chunk;
+    size_t local_chunks_t;
+
+    ChunkLayout(const ProcessGrid& grid, const StridedView7D& view, size_t chunk_t) {
+        local = view.count;
+        if (chunk_t == 0) chunk_t = local[1];
+        if (local[1] % chunk_t != 0) {
+            throw std::runtime_error("chunk_t必须整除本地t方向大小");
+        }
+        global = {
+            local[0], local[1] * grid.dim(T_DIM), local[2] * grid.dim(Z_DIM),
+            local[3] * grid.dim(Y_DIM), local[4] * grid.dim(X_DIM), local[5], local[6]
+        };
+        const auto offset_local = grid.local_offset({local[4], local[3], local[2], local[1]});
+        offset = {0, offset_local[T_DIM], offset_local[Z_DIM], offset_local[Y_DIM], offset_local[X_DIM], 0, 0};
+        chunk = {1, chunk_t, local[2], local[3], local[4], local[5], local[6]};
+        local_chunks_t = local[1] / chunk_t;
+    }
+
+    size_t count() const { return local[0] * local_chunks_t; }
+    size_t elements() const {
+        size_t n = 1;
+        for (hsize_t c : chunk) n *= c;
+        return n;
+    }
+    // 第k个chunk在数据集中的起点
+    std::array<hsize_t, 7> start(size_t k) const {
+        return {k / local_chunks_t, offset[1] + k % local_chunks_t * chunk[1], offset[2], offset[3], offset[4], 0, 0};
+    }
+    // 第k个chunk在本地视图中的位置
+    StridedView7D view(const StridedView7D& whole, size_t k) const {
+        StridedView7D v = whole;
+        v.offset[0] += k / local_chunks_t * whole.stride[0];
+        v.offset[1] += k % local_chunks_t * chunk[1] * whole.stride[1];
+        v.count[0] = 1;
+        v.count[1] = chunk[1];
+        return v;
+    }
+};
+
+}  // namespace detail
+
+// 集体调用: 各进程并行压缩本地chunk, rank 0用H5Dwrite_chunk写入
+// 使用options的chunk_t (0表示每个chunk为本地块的一个方向) 和max_transfer_bytes (发往rank 0的单条消息上限)
+inline ChunkStats write7d_direct(const ProcessGrid& grid, const std::string& filename,
+                                 const std::string& dataset_name, const Array7D<std::complex<double>>& local_array,
+                                 const ChunkCodec& codec = ChunkCodec(), const IoOptions& options = IoOptions()) {
+    Hdf5Lock hdf5_lock;
+    if (codec.level < 1 || codec.level > 9) throw std::runtime_error("deflate压缩级别应为1-9");
+    const StridedView7D view = make_view(local_array);
+    const detail::ChunkLayout layout(grid, view, options.chunk_t);
+    const size_t n = layout.count();
+    const unsigned threads = detail::codec_threads(grid.comm(), codec.threads);
+    const detail::Quantization quant = detail::choose_quantization(grid.comm(), local_array, codec);
+
+    // 1. 线程池压缩 (有损模式先量化) 本进程的chunk
+    std::vector<std::vector<unsigned char>> compressed(n);
+    double t0 = MPI_Wtime();
+    int failed = 0;
+    std::string error;
+    {
+        TraceScope scope("chunk.compress");
+        try {
+            detail::parallel_chunks(n, threads, [&](size_t k) {
+                const std::vector<double> packed = pack_view(layout.view(view, k), false);
+                if (quant.step == 0) {
+                    compressed[k] = detail::deflate_chunk(reinterpret_cast<const unsigned char*>(packed.data()),
+                                                          packed.size(), sizeof(double), codec);
+                } else {
+                    const std::vector<unsigned char> q = quant.width == sizeof(int16_t)
+                        ? detail::quantize<int16_t>(packed, quant.step)
+                        : detail::quantize<int32_t>(packed, quant.step);
+                    compressed[k] = detail::deflate_chunk(q.data(), packed.size(), quant.width, codec);
+                }
+            });
+        } catch (const std::exception& e) {
+            failed = 1;
+            error = e.what();
+        }
+    }
+    const double codec_seconds = MPI_Wtime() - t0;
+    MPI_Allreduce(MPI_IN_PLACE, &failed, 1, MPI_INT, MPI_MAX, grid.comm());
+    if (failed) throw std::runtime_error(error.empty() ? "其他进程压缩chunk失败" : error);
+
+    // 2. 各chunk的大小和起点汇总到rank 0; 各进程本地尺寸相同, chunk数也相同
+    std::vector<unsigned long long> sizes(n), all_sizes;
+    unsigned long long local_bytes = 0;
+    for (size_t k = 0; k < n; ++k) local_bytes += sizes[k] = compressed[k].size();
+    std::vector<unsigned long long> starts(n * 7), all_starts;
+    for (size_t k = 0; k < n; ++k) {
+        const auto s = layout.start(k);
+        std::copy(s.begin(), s.end(), starts.begin() + k * 7);
+    }
+    if (grid.rank() == 0) {
+        all_sizes.resize(n * grid.size());
+        all_starts.resize(n * 7 * grid.size());
+    }
+    MPI_Gather(sizes.data(), static_cast<int>(n), MPI_UNSIGNED_LONG_LONG, all_sizes.data(), static_cast<int>(n),
+               MPI_UNSIGNED_LONG_LONG, 0, grid.comm());
+    MPI_Gather(starts.data(), static_cast<int>(n * 7), MPI_UNSIGNED_LONG_LONG, all_starts.data(),
+               static_cast<int>(n * 7), MPI_UNSIGNED_LONG_LONG, 0, grid.comm());
+
+    // 3. rank 0接收并写入; 出错时仍接收完所有数据, 最后统一报告
+    const int tag = 41;
+    t0 = MPI_Wtime();
+    double rank0_times[2] = {0, 0};  // rank 0的 {等待接收, HDF5写入} 用时
+    if (grid.rank() != 0) {
+        std::vector<unsigned char> payload;
+        payload.reserve(local_bytes);
+        for (const auto& c : compressed) payload.insert(payload.end(), c.begin(), c.end());
+        std::vector<std::vector<unsigned char>>().swap(compressed);
+        detail::send_bytes(payload.data(), payload.size(), 0, tag, grid.comm(), options.max_transfer_bytes);
+    } else {
+        TraceScope scope("chunk.write");
+        std::unique_ptr<H5::H5File> file;
+        H5::DataSet dataset;
+        double t1 = MPI_Wtime();
+        try {
+            file.reset(new H5::H5File(filename, H5F_ACC_TRUNC));
+            H5::DSetCreatPropList dcpl;
+            dcpl.setChunk(layout.chunk.size(), layout.chunk.data());
+            if (codec.shuffle) dcpl.setShuffle();
+            dcpl.setDeflate(codec.level);
+            dcpl.setFillTime(H5D_FILL_TIME_NEVER);
+            H5::DataSpace filespace(layout.global.size(), layout.global.data());
+            const H5::PredType& type = quant.step == 0 ? H5::PredType::NATIVE_DOUBLE
+                                     : quant.width == sizeof(int16_t) ? H5::PredType::NATIVE_INT16
+                                     : H5::PredType::NATIVE_INT32;
+            dataset = file->createDataSet(dataset_name, type, filespace, dcpl);
+            if (quant.step > 0) {
+                auto attr = [&](const char* name, double value) {
+                    dataset.createAttribute(name, H5::PredType::NATIVE_DOUBLE, H5::DataSpace())
+                        .write(H5::PredType::NATIVE_DOUBLE, &value);
+                };
+                attr("quantization_step", quant.step);
+                attr("tolerance", quant.step / 2);
+                if (codec.relative_tolerance > 0) attr("relative_tolerance", codec.relative_tolerance);
+            }
+        } catch (const H5::Exception& e) {
+            failed = 1;
+            error = e.getCDetailMsg();
+        }
+        rank0_times[1] += MPI_Wtime() - t1;
+
+        auto bytes_of = [&](int r) {
+            unsigned long long total = 0;
+            for (size_t k = 0; k < n; ++k) total += all_sizes[r * n + k];
+            return total;
+        };
+        // 双缓冲: 写第r个进程的chunk时接收第r+1个进程的数据
+        std::vector<unsigned char> current, incoming;
+        std::vector<MPI_Request> requests;
+        auto post = [&](int r) {
+            incoming.resize(bytes_of(r));
+            requests = detail::irecv_bytes(incoming.data(), incoming.size(), r, tag, grid.comm(),
+                                           options.max_transfer_bytes);
+        };
+        if (grid.size() > 1) post(1);
+        for (int r = 0; r < grid.size(); ++r) {
+            if (r > 0) {
+                t1 = MPI_Wtime();
+                MPI_Waitall(static_cast<int>(requests.size()), requests.data(), MPI_STATUSES_IGNORE);
+                current.swap(incoming);
+                if (r + 1 < grid.size()) post(r + 1);
+                rank0_times[0] += MPI_Wtime() - t1;
+            }
+            t1 = MPI_Wtime();
+            size_t pos = 0;
+            for (size_t k = 0; k < n && !failed; ++k) {
+                const size_t bytes = all_sizes[r * n + k];
+                const unsigned char* data = r == 0 ? compressed[k].data() : current.data() + pos;
+                pos += bytes;
+                std::array<hsize_t, 7> start;
+                std::copy(all_starts.begin() + (r * n + k) * 7, all_starts.begin() + (r * n + k + 1) * 7,
+                          start.begin());
+                if (H5Dwrite_chunk(dataset.getId(), H5P_DEFAULT, 0, start.data(), bytes, data) < 0) {
+                    failed = 1;
+                    error = "H5Dwrite_chunk失败: " + filename;
+                }
+            }
+            rank0_times[1] += MPI_Wtime() - t1;
+        }
+        t1 = MPI_Wtime();
+        try {
+            dataset.close();
+            if (file) file->close();
+        } catch (const H5::Exception& e) {
+            failed = 1;
+            error = e.getCDetailMsg();
+        }
+        rank0_times[1] += MPI_Wtime() - t1;
+    }
+    double io_seconds = MPI_Wtime() - t0;
+
+    MPI_Bcast(&failed, 1, MPI_INT, 0, grid.comm());
+    if (failed) throw std::runtime_error(grid.rank() == 0 ? error : "rank 0写入chunk失败");
+    MPI_Bcast(rank0_times, 2, MPI_DOUBLE, 0, grid.comm());
+
+    double stored = static_cast<double>(local_bytes), max_codec = codec_seconds;
+    MPI_Allreduce(MPI_IN_PLACE, &stored, 1, MPI_DOUBLE, MPI_SUM, grid.comm());
+    MPI_Allreduce(MPI_IN_PLACE, &max_codec, 1, MPI_DOUBLE, MPI_MAX, grid.comm());
+    MPI_Allreduce(MPI_IN_PLACE, &io_seconds, 1, MPI_DOUBLE, MPI_MAX, grid.comm());
+    ChunkStats stats;
+    stats.chunks = n * grid.size();
+    stats.raw_bytes = static_cast<double>(stats.chunks) * layout.elements() * sizeof(double);
+    stats.stored_bytes = stored;
+    stats.codec_seconds = max_codec;
+    stats.io_seconds = io_seconds;
+    stats.gather_seconds = rank0_times[0];
+    stats.write_seconds = rank0_times[1];
+    stats.tolerance = quant.step / 2;
+    return stats;
+}
+
+// 集体调用: 数据集的chunk与本进程的本地块对齐且只用了shuffle/deflate时, 各进程用H5Dread_chunk
+// 读取自己的chunk并用线程池解压; 否则 (进程网格不同、其他过滤器等) 退回read7d
+// 有损模式写入的数据集自动乘以quantization_step还原, stats.tolerance为记录的误差上限
+// local_array需要预先按本地尺寸分配 (可以带ghost区), 只写入内部区域
+inline ChunkStats read7d_direct(const ProcessGrid& grid, const std::string& filename,
+                                const std::string& dataset_name, Array7D<std::complex<double>>& local_array,
+                                const ChunkCodec& codec = ChunkCodec(), const IoOptions& options = IoOptions()) {
+    Hdf5Lock hdf5_lock;
+    const StridedView7D view = make_view(local_array);
+    int usable = 1;
+    bool shuffled = false;
+    std::array<hsize_t, 7> chunk = {0, 0, 0, 0, 0, 0, 0};
+    detail::Quantization quant;
+    H5::H5File file;
+    H5::DataSet dataset;
+    double t0 = MPI_Wtime();
+    {
+        TraceScope scope("chunk.open");
+        // 只读打开不修改文件, 各进程可以各自以串行方式打开
+        file.openFile(filename, H5F_ACC_RDONLY);
+        dataset = file.openDataSet(dataset_name);
+        const auto dims = dataset_dims7d(dataset);
+        const std::array<hsize_t, 7> expected = {
+            view.count[0], view.count[1] * grid.dim(T_DIM), view.count[2] * grid.dim(Z_DIM),
+            view.count[3] * grid.dim(Y_DIM), view.count[4] * grid.dim(X_DIM), view.count[5], view.count[6]
+        };
+        if (dims != expected) throw std::runtime_error("本地数组尺寸与数据集不一致");
+        if (dataset.attrExists("quantization_step")) {
+            dataset.openAttribute("quantization_step").read(H5::PredType::NATIVE_DOUBLE, &quant.step);
+            quant.width = dataset.getDataType().getSize();
+            if (dataset.getTypeClass() != H5T_INTEGER || (quant.width != 2 && quant.width != 4)) {
+                throw std::runtime_error("量化数据集的类型应为16位或32位整数");
+            }
+        } else if (dataset.getTypeClass() != H5T_FLOAT || dataset.getDataType().getSize() != sizeof(double)) {
+            usable = 0;
+        }
+
+        H5::DSetCreatPropList dcpl = dataset.getCreatePlist();
+        if (dcpl.getLayout() != H5D_CHUNKED) {
+            usable = 0;
+        } else if (usable) {
+            dcpl.getChunk(static_cast<int>(chunk.size()), chunk.data());
+            usable = chunk[0] == 1 && chunk[1] > 0 && view.count[1] % chunk[1] == 0;
+            for (int i = 2; i < 7; ++i) usable = usable && chunk[i] == view.count[i];
+            // 过滤器只能是 [shuffle,] deflate
+            const int nfilters = dcpl.getNfilters();
+            usable = usable && nfilters > 0;
+            for (int i = 0; i < nfilters && usable; ++i) {
+                unsigned flags, config;
+                size_t nelmts = 0;
+                char name[64];
+                const H5Z_filter_t id = dcpl.getFilter(i, flags, nelmts, nullptr, sizeof(name), name, config);
+                if (id == H5Z_FILTER_SHUFFLE && i == 0 && nfilters == 2) {
+                    shuffled = true;
+                } else if (id != H5Z_FILTER_DEFLATE || i != nfilters - 1) {
+                    usable = 0;
+                }
+            }
+        }
+    }
+    // 文件相同, 各进程的判断本应一致; 仍然归约一次, 保证集体调用路径相同
+    MPI_Allreduce(MPI_IN_PLACE, &usable, 1, MPI_INT, MPI_MIN, grid.comm());
+    ChunkStats stats;
+    stats.tolerance = quant.step / 2;
+    if (!usable) {
+        dataset.close();
+        file.close();
+        read7d(grid, filename, dataset_name, local_array, options);
+        if (quant.step > 0) {
+            const size_t row = local_array.get_Lx() * local_array.get_Nc() * local_array.get_Nc();
+            for (size_t mu = 0; mu < Nd; ++mu)
+                for (size_t t = 0; t < local_array.get_Lt(); ++t)
+                    for (size_t z = 0; z < local_array.get_Lz(); ++z)
+                        for (size_t y = 0; y < local_array.get_Ly(); ++y) {
+                            std::complex<double>* p = local_array.site_ptr(mu, t, z, y, 0);
+                            for (size_t i = 0; i < row; ++i) p[i] *= quant.step;
+                        }
+        }
+        stats.io_seconds = MPI_Wtime() - t0;
+        MPI_Allreduce(MPI_IN_PLACE, &stats.io_seconds, 1, MPI_DOUBLE, MPI_MAX, grid.comm());
+        return stats;
+    }
+
+    const detail::ChunkLayout layout(grid, view, chunk[1]);
+    const size_t n = layout.count();
+
+    // 1. 依次读出本进程的压缩chunk, HDF5调用都在本线程
+    std::vector<std::vector<unsigned char>> stored(n);
+    std::vector<uint32_t> masks(n, 0);
+    int failed = 0;
+    std::string error;
+    unsigned long long local_bytes = 0;
+    {
+        TraceScope scope("chunk.read");
+        for (size_t k = 0; k < n && !failed; ++k) {
+            const auto start = layout.start(k);
+            hsize_t bytes = 0;
+            if (H5Dget_chunk_storage_size(dataset.getId(), start.data(), &bytes) < 0 || bytes == 0) {
+                failed = 1;
+                error = "数据集中缺少chunk: " + filename;
+                break;
+            }
+            stored[k].resize(bytes);
+            local_bytes += bytes;
+            if (H5Dread_chunk(dataset.getId(), H5P_DEFAULT, start.data(), &masks[k], stored[k].data()) < 0) {
+                failed = 1;
+                error = "H5Dread_chunk失败: " + filename;
+            }
+        }
+        dataset.close();
+        file.close();
+    }
+    double io_seconds = MPI_Wtime() - t0;
+
+    // 2. 线程池解压并拷入本地数组的内部区域
+    t0 = MPI_Wtime();
+    if (!failed) {
+        TraceScope scope("chunk.decompress");
+        const unsigned threads = detail::codec_threads(grid.comm(), codec.threads);
+        const size_t elements = layout.elements();
+        const size_t lz = layout.chunk[2], ly = layout.chunk[3];
+        const size_t row = layout.chunk[4] * layout.chunk[5] * layout.chunk[6] / 2;
+        try {
+            detail::parallel_chunks(n, threads, [&](size_t k) {
+                // 过滤器掩码中置位的过滤器在写入时被跳过
+                const bool shuffle_applied = shuffled && !(masks[k] & 1u);
+                const bool deflate_applied = !(masks[k] & (shuffled ? 2u : 1u));
+                std::vector<double> packed(elements);
+                if (quant.step == 0) {
+                    detail::inflate_chunk(stored[k], reinterpret_cast<unsigned char*>(packed.data()), elements,
+                                          sizeof(double), shuffle_applied, deflate_applied);
+                } else {
+                    std::vector<unsigned char> q(elements * quant.width);
+                    detail::inflate_chunk(stored[k], q.data(), elements, quant.width, shuffle_applied,
+                                          deflate_applied);
+                    if (quant.width == sizeof(int16_t)) {
+                        detail::dequantize<int16_t>(q.data(), packed.data(), elements, quant.step);
+                    } else {
+                        detail::dequantize<int32_t>(q.data(), packed.data(), elements, quant.step);
+                    }
+                }
+                std::vector<unsigned char>().swap(stored[k]);
+
+                const size_t mu = k / layout.local_chunks_t;
+                const size_t t_begin = k % layout.local_chunks_t * layout.chunk[1];
+                const std::complex<double>* src = reinterpret_cast<const std::complex<double>*>(packed.data());
+                for (size_t t = 0; t < layout.chunk[1]; ++t) {
+                    for (size_t z = 0; z < lz; ++z) {
+                        for (size_t y = 0; y < ly; ++y, src += row) {
+                            std::copy(src, src + row, local_array.site_ptr(mu, t_begin + t, z, y, 0));
+                        }
+                    }
+                }
+            });
+        } catch (const std::exception& e) {
+            failed = 1;
+            error = e.what();
+        }
+    }
+    double codec_seconds = MPI_Wtime() - t0;
+
+    MPI_Allreduce(MPI_IN_PLACE, &failed, 1, MPI_INT, MPI_MAX, grid.comm());
+    if (failed) throw std::runtime_error(error.empty() ? "其他进程读取chunk失败" : error);
+
+    double stored_bytes = static_cast<double>(local_bytes);
+    MPI_Allreduce(MPI_IN_PLACE, &stored_bytes, 1, MPI_DOUBLE, MPI_SUM, grid.comm());
+    MPI_Allreduce(MPI_IN_PLACE, &codec_seconds, 1, MPI_DOUBLE, MPI_MAX, grid.comm());
+    MPI_Allreduce(MPI_IN_PLACE, &io_seconds, 1, MPI_DOUBLE, MPI_MAX, grid.comm());
+    stats.chunks = n * grid.size();
+    stats.raw_bytes = static_cast<double>(stats.chunks) * layout.elements() * sizeof(double);
+    stats.stored_bytes = stored_bytes;
+    stats.codec_seconds = codec_seconds;
+    stats.io_seconds = io_seconds;
+    return stats;
+}
@@ -0,0 +1,245 @@
+#pragma once
+
+#include <mpi.h>
+#include <array>
+#include <string>
+#include <stdexcept>
+#include <vector>
+
+#include "public.h"
+
+// 进程到4D网格坐标的映射方式
+enum class GridMapping {
+    Plain,  // 沿用启动器给出的rank顺序 (x变化最快), 不重排
+    Cart,   // MPI_Cart_create(reorder=1), 由MPI实现重排rank
+    Node    // 节点感知: 每个节点持有一个连续的子网格块
+};
+
+inline GridMapping parse_mapping(const std::string& name) {
+    if (name == "plain") return GridMapping::Plain;
+    if (name == "cart")  return GridMapping::Cart;
+    if (name == "node")  return GridMapping::Node;
+    throw std::runtime_error("未知的映射方式: " + name);
+}
+
+inline const char* mapping_name(GridMapping mapping) {
+    switch (mapping) {
+        case GridMapping::Plain: return "plain";
+        case GridMapping::Cart:  return "cart";
+        case GridMapping::Node:  return "node";
+    }
+    return "unknown";
+}
+
+// 解析 "Nx.Ny.Nz.Nt" 形式的进程网格, 按QcuDims下标存放
+// "auto" 时全部置0, 由MPI_Dims_create决定
+inline std::array<int, Nd> parse_grid(const std::string& text) {
+    std::array<int, Nd> grid = {0, 0, 0, 0};
+    if (text == "auto") {
+        return grid;
+    }
+    std::string grid_str(text);
+    size_t pos = 0;
+    grid[X_DIM] = std::stoi(grid_str, &pos); grid_str = grid_str.substr(pos + 1);
+    grid[Y_DIM] = std::stoi(grid_str, &pos); grid_str = grid_str.substr(pos + 1);
+    grid[Z_DIM] = std::stoi(grid_str, &pos); grid_str = grid_str.substr(pos + 1);
+    grid[T_DIM] = std::stoi(grid_str);
+    return grid;
+}
+
+// 解析 "Lx.Ly.Lz.Lt" 形式的全局格子尺寸, 按QcuDims下标存放
+inline std::array<size_t, Nd> parse_lattice(const std::string& text) {
+    const auto lattice = parse_grid(text);
+    return {static_cast<size_t>(lattice[X_DIM]), static_cast<size_t>(lattice[Y_DIM]),
+            static_cast<size_t>(lattice[Z_DIM]), static_cast<size_t>(lattice[T_DIM])};
+}
+
+// 基于MPI笛卡尔通信子的4D进程网格
+// 笛卡尔维度按 {t, z, y, x} 排列, 使行主序rank与原先手工计算的顺序一致
+class ProcessGrid {
+private:
+    MPI_Comm comm_ = MPI_COMM_NULL;
+    std::array<int, Nd> dims_;
+    Coords coords_;
+    GridMapping mapping_;
+    int rank_ = 0;
+    int size_ = 0;
+
+    static int cart_axis(int d) { return Nd - 1 - d; }
+
+    // 按x最快变化的行主序把线性下标展开为坐标
+    static std::array<int, Nd> unflatten(int index, const std::array<int, Nd>& extent) {
+        std::array<int, Nd> c;
+        for (int d = 0; d < Nd; ++d) {
+            c[d] = index % extent[d];
+            index /= extent[d];
+        }
+        return c;
+    }
+
+    static int flatten(const std::array<int, Nd>& c, const std::array<int, Nd>& extent) {
+        int index = 0;
+        for (int d = Nd - 1; d >= 0; --d) {
+            index = index * extent[d] + c[d];
+        }
+        return index;
+    }
+
+    // 把每节点进程数ppn分解成节点内的子块, 要求各方向能整除进程网格
+    // 每个素因子放到剩余份数最多且可整除的方向上
+    static bool node_block(const std::array<int, Nd>& dims, int ppn,
+                           std::array<int, Nd>& block) {
+        block = {1, 1, 1, 1};
+        std::vector<int> factors;
+        for (int p = 2; p * p <= ppn; ++p) {
+            while (ppn % p == 0) { factors.push_back(p); ppn /= p; }
+        }
+        if (ppn > 1) factors.push_back(ppn);
+
+        for (auto it = factors.rbegin(); it != factors.rend(); ++it) {
+            int best = -1;
+            for (int d = 0; d < Nd; ++d) {
+                const int rest = dims[d] / block[d];
+                if (rest % *it == 0 && (best < 0 || rest >= dims[best] / block[best])) {
+                    best = d;
+                }
+            }
+            if (best < 0) return false;
+            block[best] *= *it;
+        }
+        return true;
+    }
+
+    // 节点感知映射: 返回按目标网格位置排序后的通信子, 失败时返回MPI_COMM_NULL
+    MPI_Comm node_ordered_comm(MPI_Comm parent) {
+        int parent_rank;
+        MPI_Comm_rank(parent, &parent_rank);
+
+        MPI_Comm node_comm;
+        MPI_Comm_split_type(parent, MPI_COMM_TYPE_SHARED, parent_rank, MPI_INFO_NULL, &node_comm);
+        int local_rank, ppn;
+        MPI_Comm_rank(node_comm, &local_rank);
+        MPI_Comm_size(node_comm, &ppn);
+
+        // 各节点进程数必须一致
+        int ppn_minmax[2] = {-ppn, ppn};
+        MPI_Allreduce(MPI_IN_PLACE, ppn_minmax, 2, MPI_INT, MPI_MAX, parent);
+
+        MPI_Comm leader_comm;
+        MPI_Comm_split(parent, local_rank == 0 ? 0 : MPI_UNDEFINED, parent_rank, &leader_comm);
+        int node_info[2] = {0, 0};  // {节点编号, 节点数}
+        if (leader_comm != MPI_COMM_NULL) {
+            MPI_Comm_rank(leader_comm, &node_info[0]);
+            MPI_Comm_size(leader_comm, &node_info[1]);
+            MPI_Comm_free(&leader_comm);
+        }
+        MPI_Bcast(node_info, 2, MPI_INT, 0, node_comm);
+        MPI_Comm_free(&node_comm);
+
+        std::array<int, Nd> block;
+        if (-ppn_minmax[0] != ppn_minmax[1] || !node_block(dims_, ppn, block)) {
+            return MPI_COMM_NULL;
+        }
+
+        std::array<int, Nd> node_grid;
+        for (int d = 0; d < Nd; ++d) node_grid[d] = dims_[d] / block[d];
+        const auto node_coords = unflatten(node_info[0], node_grid);
+        const auto local_coords = unflatten(local_rank, block);
+        std::array<int, Nd> target;
+        for (int d = 0; d < Nd; ++d) target[d] = node_coords[d] * block[d] + local_coords[d];
+
+        MPI_Comm ordered;
+        MPI_Comm_split(parent, 0, flatten(target, dims_), &ordered);
+        return ordered;
+    }
+
+public:
+    ProcessGrid(MPI_Comm parent, std::array<int, Nd> dims, GridMapping mapping = GridMapping::Cart)
+        : dims_(dims), mapping_(mapping) {
+        int parent_size;
+        MPI_Comm_size(parent, &parent_size);
+
+        std::array<int, Nd> cart_dims;
+        for (int d = 0; d < Nd; ++d) cart_dims[cart_axis(d)] = dims_[d];
+        int fixed = 1;
+        bool free_dims = false;
+        for (int d = 0; d < Nd; ++d) {
+            if (dims_[d] > 0) fixed *= dims_[d];
+            else free_dims = true;
+        }
+        // 各维都给定时不调用MPI_Dims_create, 否则尺寸不符时它直接报错退出, 走不到下面的检查
+        if (free_dims && parent_size % fixed == 0) {
+            MPI_Dims_create(parent_size, Nd, cart_dims.data());
+        }
+        for (int d = 0; d < Nd; ++d) dims_[d] = cart_dims[cart_axis(d)];
+
+        if (dims_[X_DIM] * dims_[Y_DIM] * dims_[Z_DIM] * dims_[T_DIM] != parent_size) {
+            throw std::runtime_error("进程网格大小与总进程数 " + std::to_string(parent_size) + " 不匹配");
+        }
+
+        const std::array<int, Nd> periods = {1, 1, 1, 1};
+        MPI_Comm base = parent;
+        int reorder = mapping_ == GridMapping::Cart ? 1 : 0;
+        if (mapping_ == GridMapping::Node) {
+            base = node_ordered_comm(parent);
+            if (base == MPI_COMM_NULL) {
+                // 节点内进程数无法分块时退回到MPI自身的重排
+                mapping_ = GridMapping::Cart;
+                base = parent;
+                reorder = 1;
+            }
+        }
+        MPI_Cart_create(base, Nd, cart_dims.data(), periods.data(), reorder, &comm_);
+        if (base != parent) MPI_Comm_free(&base);
+
+        MPI_Comm_rank(comm_, &rank_);
+        MPI_Comm_size(comm_, &size_);
+
+        std::array<int, Nd> cart_coords;
+        MPI_Cart_coords(comm_, rank_, Nd, cart_coords.data());
+        for (int d = 0; d < Nd; ++d) coords_.data[d] = cart_coords[cart_axis(d)];
+    }
+
+    ~ProcessGrid() {
+        // 允许在MPI_Finalize之后析构
+        int finalized = 0;
+        MPI_Finalized(&finalized);
+        if (!finalized && comm_ != MPI_COMM_NULL) MPI_Comm_free(&comm_);
+    }
+
+    ProcessGrid(const ProcessGrid&) = delete;
+    ProcessGrid& operator=(const ProcessGrid&) = delete;
+
+    MPI_Comm comm() const { return comm_; }
+    int rank() const { return rank_; }
+    int size() const { return size_; }
+    int dim(int d) const { return dims_[d]; }
+    const Coords& coords() const { return coords_; }
+    GridMapping mapping() const { return mapping_; }
+
+    // 沿方向d位移disp的邻居rank (周期边界)
+    int neighbor(int d, int disp) const {
+        int source, dest;
+        MPI_Cart_shift(comm_, cart_axis(d), disp, &source, &dest);
+        return dest;
+    }
+
+    // 全局格子尺寸 {Lx, Ly, Lz, Lt} 对应的本地尺寸, 不能整除时抛出异常
+    std::array<size_t, Nd> local_extent(const std::array<size_t, Nd>& global) const {
+        std::array<size_t, Nd> local;
+        for (int d = 0; d < Nd; ++d) {
+            if (global[d] % dims_[d] != 0) {
+                throw std::runtime_error("网格维度必须能被进程数整除");
+            }
+            local[d] = global[d] / dims_[d];
+        }
+        return local;
+    }
+
+    // 本地子格子在全局格子中的偏移
+    std::array<size_t, Nd> local_offset(const std::array<size_t, Nd>& local) const {
+        std::array<size_t, Nd> offset;
+        for (int d = 0; d < Nd; ++d) offset[d] = coords_.data[d] * local[d];
+        return offset;
+    }
+};
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <mpi.h>
+#include <string>
+#include <stdexcept>
+#include <vector>
+
+// 一个作业中并行运行多个相互独立的小格子系综
+// 读写接口都以ProcessGrid为参数, 网格可以建在任意通信子上; 把作业划分成K组,
+// 每组在自己的通信子上建网格、读写自己的文件, 各组的集体调用和文件互不相干
+// 组按rank顺序连续划分: 按块放置进程时同一组落在相邻的节点上, 组内的halo交换不跨越其他组
+
+// 把父通信子按rank顺序均分成count组, 前 size % count 组各多一个进程
+class JobGroups {
+private:
+    MPI_Comm parent_;
+    MPI_Comm comm_ = MPI_COMM_NULL;
+    int index_ = 0;
+    int count_ = 1;
+
+public:
+    JobGroups(MPI_Comm parent, int count) : parent_(parent), count_(count) {
+        int rank, size;
+        MPI_Comm_rank(parent, &rank);
+        MPI_Comm_size(parent, &size);
+        if (count < 1 || count > size) {
+            throw std::runtime_error("组数必须在1到总进程数 " + std::to_string(size) + " 之间");
+        }
+        const int base = size / count, extra = size % count;
+        const int split = extra * (base + 1);
+        index_ = rank < split ? rank / (base + 1) : extra + (rank - split) / base;
+        MPI_Comm_split(parent, index_, rank, &comm_);
+    }
+
+    ~JobGroups() {
+        // 允许在MPI_Finalize之后析构
+        int finalized = 0;
+        MPI_Finalized(&finalized);
+        if (!finalized && comm_ != MPI_COMM_NULL) MPI_Comm_free(&comm_);
+    }
+
+    JobGroups(const JobGroups&) = delete;
+    JobGroups& operator=(const JobGroups&) = delete;
+
+    MPI_Comm comm() const { return comm_; }
+    MPI_Comm parent() const { return parent_; }
+    int index() const { return index_; }
+    int count() const { return count_; }
+};
+
+// 各组自己的文件名: 只有一组时不变, 否则在扩展名前插入 _g<组号>
+inline std::string group_filename(const std::string& filename, const JobGroups& groups) {
+    if (groups.count() == 1) return filename;
+    const std::string tag = "_g" + std::to_string(groups.index());
+    const size_t slash = filename.find_last_of('/');
+    const size_t dot = filename.find_last_of('.');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) return filename + tag;
+    return filename.substr(0, dot) + tag + filename.substr(dot);
+}
+
+struct GroupResult {
+    double bytes = 0;
+    double seconds = 0;
+};
+
+// 在父通信子上的集体调用: 各组组内rank 0给出本组的数据量和用时, 父通信子rank 0得到按组号排列的结果,
+// 其余进程返回空
+inline std::vector<GroupResult> gather_group_results(const JobGroups& groups, double bytes, double seconds) {
+    int group_rank, parent_rank, parent_size;
+    MPI_Comm_rank(groups.comm(), &group_rank);
+    MPI_Comm_rank(groups.parent(), &parent_rank);
+    MPI_Comm_size(groups.parent(), &parent_size);
+
+    const double mine[3] = {group_rank == 0 ? 1.0 : 0.0, bytes, seconds};
+    std::vector<double> all(parent_rank == 0 ? 3 * parent_size : 0);
+    MPI_Gather(mine, 3, MPI_DOUBLE, all.data(), 3, MPI_DOUBLE, 0, groups.parent());
+
+    std::vector<GroupResult> results;
+    if (parent_rank != 0) return results;
+    // 组按rank顺序连续划分, 组内rank 0按父rank递增出现的次序就是组号
+    for (int r = 0; r < parent_size; ++r) {
+        if (all[3 * r] == 0) continue;
+        results.push_back({all[3 * r + 1], all[3 * r + 2]});
+    }
+    return results;
+}
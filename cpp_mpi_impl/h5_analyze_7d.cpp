@@ -0,0 +1,105 @@
+#include <H5Cpp.h>
+#include <vector>
+#include <iostream>
+#include <array>
+#include <string>
+#include <stdexcept>
+#include <complex>
+
+#include "public.h"
+#include "grid.h"
+#include "lattice_io.h"
+#include "prefetch.h"
+
+// 依次分析多个配置, 后台预取下一个配置以隐藏读取时间
+// 每个配置计算链变量迹实部的平均值, --work=秒 可以额外模拟测量的计算量
+int main(int argc, char** argv) {
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &provided);
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    try {
+        std::vector<std::string> files;
+        for (int i = 2; i < argc; ++i) {
+            if (std::string(argv[i]).compare(0, 2, "--") != 0) files.push_back(argv[i]);
+        }
+        if (argc < 3 || files.empty()) {
+            if (rank == 0) {
+                std::cerr << "用法: mpirun -n <进程数> " << argv[0]
+                          << " Nx.Ny.Nz.Nt|auto cfg1.hdf5 [cfg2.hdf5 ...] [--depth=2] [--work=0]\n";
+            }
+            MPI_Finalize();
+            return 1;
+        }
+
+        ProcessGrid grid(MPI_COMM_WORLD, parse_grid(argv[1]),
+                         parse_mapping(find_option(argc, argv, "map", "cart")));
+        const size_t depth = std::stoul(find_option(argc, argv, "depth", "2"));
+        const double work = std::stod(find_option(argc, argv, "work", "0"));
+        const std::string dataset_name = "LatticeMatrix";
+
+        // 预取线程在MPI_Finalize之前结束
+        {
+            ConfigPrefetcher prefetcher(grid, files, dataset_name, depth);
+            if (grid.rank() == 0) {
+                std::cout << "线程级别 " << provided << (prefetcher.asynchronous() ? ", 后台预取" : ", 同步读取")
+                          << ", 缓冲区 " << depth << " 个\n";
+            }
+
+            double total_wait = 0, total_compute = 0;
+            MPI_Barrier(grid.comm());
+            const double start = MPI_Wtime();
+            for (;;) {
+                double t0 = MPI_Wtime();
+                const Array7D<std::complex<double>>* field = prefetcher.next();
+                const double wait = MPI_Wtime() - t0;
+                if (field == nullptr) break;
+
+                t0 = MPI_Wtime();
+                double trace = 0;
+                const size_t Nc = field->get_Nc();
+                for (size_t dim = 0; dim < field->get_Ndim(); ++dim)
+                    for (size_t t = 0; t < field->get_Lt(); ++t)
+                        for (size_t z = 0; z < field->get_Lz(); ++z)
+                            for (size_t y = 0; y < field->get_Ly(); ++y)
+                                for (size_t x = 0; x < field->get_Lx(); ++x)
+                                    for (size_t c = 0; c < Nc; ++c)
+                                        trace += (*field)(dim, t, z, y, x, c, c).real();
+                while (MPI_Wtime() - t0 < work) {
+                }
+                MPI_Allreduce(MPI_IN_PLACE, &trace, 1, MPI_DOUBLE, MPI_SUM, grid.comm());
+                const double compute = MPI_Wtime() - t0;
+
+                total_wait += wait;
+                total_compute += compute;
+                if (grid.rank() == 0) {
+                    const double links = static_cast<double>(field->get_Ndim()) * field->get_Lt() * field->get_Lz()
+                                       * field->get_Ly() * field->get_Lx() * grid.size();
+                    std::cout << prefetcher.current_file() << ": 平均迹 " << trace / (links * Nc)
+                              << ", 等待 " << wait << " s, 计算 " << compute << " s\n";
+                }
+            }
+            const double elapsed = MPI_Wtime() - start;
+            if (grid.rank() == 0) {
+                std::cout << "总用时 " << elapsed << " s, 其中等待读取 " << total_wait
+                          << " s, 计算 " << total_compute << " s\n";
+            }
+        }
+
+        MPI_Finalize();
+        return 0;
+    } catch (const H5::Exception& e) {
+        if (rank == 0) {
+            std::cerr << "HDF5错误：" << e.getCDetailMsg() << '\n';
+        }
+        MPI_Finalize();
+        return 1;
+    } catch (const std::exception& e) {
+        if (rank == 0) {
+            std::cerr << "错误：" << e.what() << '\n';
+        }
+        MPI_Finalize();
+        return 1;
+    }
+}
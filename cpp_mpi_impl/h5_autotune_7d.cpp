@@ -0,0 +1,195 @@
+#include <H5Cpp.h>
+#include <vector>
+#include <iostream>
+#include <array>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <stdexcept>
+#include <complex>
+
+#include "public.h"
+#include "grid.h"
+#include "lattice_io.h"
+#include "io_profile.h"
+
+// 在当前进程网格上用一个代表性的LatticeMatrix做短时间读写试验, 搜索较好的I/O参数,
+// 结果按 (文件系统类型, 进程数, 本地数据量) 写入I/O配置文件, 供write7d/read7d自动使用
+//
+// 搜索方式为逐参数坐标下降: 每次只改一个参数, 保留更快的取值, 一轮没有改进就停止;
+// 重复测量时第一次就明显慢于当前最优(超过prune倍)的取值直接放弃
+namespace {
+
+struct Candidate {
+    std::string name;
+    std::function<void(IoOptions&)> apply;
+};
+
+struct Parameter {
+    std::string name;
+    std::vector<Candidate> values;
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    MPI_Init(&argc, &argv);
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    try {
+        if (argc < 2) {
+            if (rank == 0) {
+                std::cerr << "用法: mpirun -n <进程数> " << argv[0]
+                          << " Nx.Ny.Nz.Nt|auto [--lattice=Lx.Ly.Lz.Lt] [--file=autotune_7d.hdf5]"
+                          << " [--profile=~/.lattice_io_profile] [--repeat=2] [--passes=2] [--prune=1.5]\n";
+            }
+            MPI_Finalize();
+            return 1;
+        }
+
+        ProcessGrid grid(MPI_COMM_WORLD, parse_grid(argv[1]),
+                         parse_mapping(find_option(argc, argv, "map", "cart")));
+        const auto lattice = parse_lattice(find_option(argc, argv, "lattice", "8.8.8.8"));
+        const std::string filename = find_option(argc, argv, "file", "autotune_7d.hdf5");
+        const std::string profile = find_option(argc, argv, "profile", default_profile_path());
+        const int repeat = std::max(1, std::stoi(find_option(argc, argv, "repeat", "2")));
+        const int passes = std::max(1, std::stoi(find_option(argc, argv, "passes", "2")));
+        const double prune = std::stod(find_option(argc, argv, "prune", "1.5"));
+        const std::string dataset_name = "LatticeMatrix";
+
+        const auto local = grid.local_extent(lattice);
+        const size_t Nc = 3;
+        Array7D<std::complex<double>> field(local[T_DIM], local[Z_DIM], local[Y_DIM], local[X_DIM], Nc);
+        Array7D<std::complex<double>> readback(local[T_DIM], local[Z_DIM], local[Y_DIM], local[X_DIM], Nc);
+        const double local_bytes = static_cast<double>(field.get_Ndim()) * local[T_DIM] * local[Z_DIM]
+                                 * local[Y_DIM] * local[X_DIM] * Nc * Nc * sizeof(std::complex<double>);
+        const IoProfileKey key = io_profile_key(grid, filename, local_bytes);
+
+        // 一次试验: 写入再读回, 返回各进程中最慢的总用时
+        auto trial = [&](const IoOptions& options) {
+            MPI_Barrier(grid.comm());
+            double t0 = MPI_Wtime();
+            write7d(grid, filename, dataset_name, field, options);
+            double write_time = MPI_Wtime() - t0;
+            MPI_Barrier(grid.comm());
+            t0 = MPI_Wtime();
+            read7d(grid, filename, dataset_name, readback, options);
+            double read_time = MPI_Wtime() - t0;
+            MPI_Allreduce(MPI_IN_PLACE, &write_time, 1, MPI_DOUBLE, MPI_MAX, grid.comm());
+            MPI_Allreduce(MPI_IN_PLACE, &read_time, 1, MPI_DOUBLE, MPI_MAX, grid.comm());
+            return write_time + read_time;
+        };
+
+        // 重复repeat次取最短用时; 明显慢于best时提前放弃
+        auto measure = [&](const IoOptions& options, double best) {
+            double time = trial(options);
+            for (int r = 1; r < repeat && time < best * prune; ++r) {
+                time = std::min(time, trial(options));
+            }
+            return time;
+        };
+
+        // 候选取值
+        std::vector<Parameter> parameters;
+        {
+            Parameter p{"collective", {}};
+            p.values.push_back({"1", [](IoOptions& o) { o.collective = true; }});
+            p.values.push_back({"0", [](IoOptions& o) { o.collective = false; }});
+            parameters.push_back(p);
+        }
+        {
+            Parameter p{"cb_nodes", {}};
+            p.values.push_back({"default", [](IoOptions& o) { o.cb_nodes = 0; }});
+            for (int n = 1; n <= grid.size() && p.values.size() < 6; n *= 2) {
+                p.values.push_back({std::to_string(n), [n](IoOptions& o) { o.cb_nodes = n; }});
+            }
+            parameters.push_back(p);
+        }
+        {
+            Parameter p{"cb_buffer_size", {}};
+            p.values.push_back({"default", [](IoOptions& o) { o.cb_buffer_size = 0; }});
+            for (size_t mb : {1, 4, 16, 64}) {
+                p.values.push_back({std::to_string(mb) + "M", [mb](IoOptions& o) { o.cb_buffer_size = mb << 20; }});
+            }
+            parameters.push_back(p);
+        }
+        {
+            Parameter p{"alignment", {}};
+            p.values.push_back({"0", [](IoOptions& o) { o.alignment = 0; }});
+            for (size_t mb : {1, 4}) {
+                p.values.push_back({std::to_string(mb) + "M", [mb](IoOptions& o) { o.alignment = mb << 20; }});
+            }
+            parameters.push_back(p);
+        }
+        {
+            Parameter p{"chunk_t", {}};
+            p.values.push_back({"contiguous", [](IoOptions& o) { o.chunk_t = 0; }});
+            for (size_t ct = 1; ct <= local[T_DIM]; ct *= 2) {
+                if (local[T_DIM] % ct == 0 && (ct == 1 || ct == local[T_DIM] || p.values.size() < 3)) {
+                    p.values.push_back({std::to_string(ct), [ct](IoOptions& o) { o.chunk_t = ct; }});
+                }
+            }
+            parameters.push_back(p);
+        }
+
+        IoOptions best;
+        load_io_profile(grid, profile, key, best);  // 已有配置时从它开始
+        double best_time = measure(best, 1e300);
+        if (grid.rank() == 0) {
+            std::cout << "键 [" << key.str() << "], 每进程 " << local_bytes / (1024.0 * 1024.0) << " MB\n"
+                      << "起点 " << format_io_options(best) << ": " << best_time << " s\n";
+        }
+
+        int trials = 1;
+        for (int pass = 0; pass < passes; ++pass) {
+            bool improved = false;
+            for (const Parameter& parameter : parameters) {
+                for (const Candidate& value : parameter.values) {
+                    IoOptions options = best;
+                    value.apply(options);
+                    if (format_io_options(options) == format_io_options(best)) continue;
+
+                    const double time = measure(options, best_time);
+                    ++trials;
+                    const bool better = time < best_time * 0.97;  // 小于3%的差异视为噪声
+                    if (grid.rank() == 0) {
+                        std::cout << "  " << parameter.name << "=" << value.name << ": " << time << " s"
+                                  << (better ? "  *" : "") << "\n";
+                    }
+                    if (better) {
+                        best = options;
+                        best_time = time;
+                        improved = true;
+                    }
+                }
+            }
+            if (!improved) break;
+        }
+
+        const double bandwidth = 2 * local_bytes * grid.size() / (1024.0 * 1024.0) / best_time;
+        char comment[64];
+        std::snprintf(comment, sizeof(comment), "%.1f MB/s", bandwidth);
+        save_io_profile(grid, profile, key, best, comment);
+        if (grid.rank() == 0) {
+            std::cout << "共试验 " << trials << " 组参数, 最优 " << format_io_options(best)
+                      << ", 读写 " << comment << "\n已写入 " << profile << "\n";
+            std::remove(filename.c_str());
+        }
+
+        MPI_Finalize();
+        return 0;
+    } catch (const H5::Exception& e) {
+        if (rank == 0) {
+            std::cerr << "HDF5错误：" << e.getCDetailMsg() << '\n';
+        }
+        MPI_Finalize();
+        return 1;
+    } catch (const std::exception& e) {
+        if (rank == 0) {
+            std::cerr << "错误：" << e.what() << '\n';
+        }
+        MPI_Finalize();
+        return 1;
+    }
+}
@@ -0,0 +1,187 @@
+#include <H5Cpp.h>
+#include <vector>
+#include <iostream>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <sstream>
+#include <stdexcept>
+#include <complex>
+#include <algorithm>
+
+#include "public.h"
+#include "grid.h"
+#include "lattice_io.h"
+#include "catalog.h"
+
+// 系综目录的查询和补登工具:
+//   --add=a.hdf5,b.hdf5   把已有的配置登记进目录 (并行读入计算校验和), 之后再执行查询
+//   查询条件: --lattice=Lx.Ly.Lz.Lt --nc=3 --beta=6.0 --traj=a:b --checksum=16进制 --dataset= --path=子串
+//   --read=1              按目录中的偏移用MPI-IO直接读取第一个匹配的配置, 重算校验和并与read7d比较用时
+// 查询本身只扫描目录文件, 由rank 0完成
+namespace {
+
+std::string hex(uint64_t value) {
+    char text[17];
+    std::snprintf(text, sizeof(text), "%016llx", static_cast<unsigned long long>(value));
+    return text;
+}
+
+CatalogQuery parse_query(int argc, char** argv) {
+    CatalogQuery query;
+    const std::string lattice = find_option(argc, argv, "lattice", "");
+    if (!lattice.empty()) query.lattice = parse_lattice(lattice);
+    query.Nc = std::stoul(find_option(argc, argv, "nc", "0"));
+    const std::string beta = find_option(argc, argv, "beta", "");
+    if (!beta.empty()) query.beta = std::stod(beta);
+    const std::string traj = find_option(argc, argv, "traj", "");
+    if (!traj.empty()) {
+        // "a:b", "a:" 或 ":b", 单个数字表示一条轨迹
+        const size_t colon = traj.find(':');
+        const std::string lo = traj.substr(0, colon);
+        const std::string hi = colon == std::string::npos ? lo : traj.substr(colon + 1);
+        if (!lo.empty()) query.trajectory_min = std::stoll(lo);
+        if (!hi.empty()) query.trajectory_max = std::stoll(hi);
+    }
+    query.checksum = std::stoull(find_option(argc, argv, "checksum", "0"), nullptr, 16);
+    query.dataset = find_option(argc, argv, "dataset", "");
+    query.path = find_option(argc, argv, "path", "");
+    return query;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    MPI_Init(&argc, &argv);
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    try {
+        if (find_option(argc, argv, "help", "0") != "0") {
+            if (rank == 0) {
+                std::cerr << "用法: mpirun -n <进程数> " << argv[0]
+                          << " [--catalog=ensemble.cat] [--grid=auto] [--add=文件,...] [--add-dataset=LatticeMatrix]"
+                          << " [--lattice=Lx.Ly.Lz.Lt] [--nc=3] [--beta=6.0] [--traj=a:b] [--checksum=16进制]"
+                          << " [--dataset=名字] [--path=子串] [--read=0]\n";
+            }
+            MPI_Finalize();
+            return 1;
+        }
+
+        ProcessGrid grid(MPI_COMM_WORLD, parse_grid(find_option(argc, argv, "grid", "auto")),
+                         parse_mapping(find_option(argc, argv, "map", "cart")));
+        const std::string catalog = find_option(argc, argv, "catalog", "ensemble.cat");
+        const std::string add = find_option(argc, argv, "add", "");
+        const std::string add_dataset = find_option(argc, argv, "add-dataset", "LatticeMatrix");
+        const bool read = find_option(argc, argv, "read", "0") != "0";
+        const CatalogQuery query = parse_query(argc, argv);
+
+        // 补登: 读入整个配置计算与进程划分无关的校验和
+        std::stringstream files(add);
+        std::string file;
+        while (std::getline(files, file, ',')) {
+            if (file.empty()) continue;
+            const Array7D<std::complex<double>> u = read7d(grid, file, add_dataset);
+            const CatalogRecord r = catalog_config(grid, catalog, file, add_dataset, u);
+            if (grid.rank() == 0) std::cout << "已登记 " << r.path << " 校验和 " << hex(r.checksum) << '\n';
+        }
+
+        // 查询由rank 0完成, 结果广播给需要读取的各进程; 目录读不出时各进程一起退出
+        std::vector<CatalogRecord> matches;
+        int count = 0;
+        int failed = 0;
+        std::string error;
+        if (grid.rank() == 0) {
+            const double t0 = MPI_Wtime();
+            size_t skipped = 0;
+            std::vector<CatalogRecord> records;
+            try {
+                records = load_catalog(catalog, &skipped);
+                matches = query_catalog(records, query);
+            } catch (const std::exception& e) {
+                failed = 1;
+                error = e.what();
+            }
+            const double elapsed = MPI_Wtime() - t0;
+            for (const CatalogRecord& r : matches) {
+                std::printf("%s:%s  [%llu %llu %llu %llu %llu %llu %llu]  beta %g  轨迹 %lld  校验和 %s  ", r.path,
+                            r.dataset, static_cast<unsigned long long>(r.dims[0]),
+                            static_cast<unsigned long long>(r.dims[1]), static_cast<unsigned long long>(r.dims[2]),
+                            static_cast<unsigned long long>(r.dims[3]), static_cast<unsigned long long>(r.dims[4]),
+                            static_cast<unsigned long long>(r.dims[5]), static_cast<unsigned long long>(r.dims[6]),
+                            r.beta, static_cast<long long>(r.trajectory), hex(r.checksum).c_str());
+                if (r.data_offset == kNoOffset) {
+                    std::printf("非连续布局\n");
+                } else {
+                    std::printf("偏移 %llu, %llu 字节\n", static_cast<unsigned long long>(r.data_offset),
+                                static_cast<unsigned long long>(r.data_bytes));
+                }
+            }
+            if (!failed) {
+                std::printf("%zu 条记录中 %zu 条匹配, 查询用时 %.3f ms", records.size(), matches.size(),
+                            elapsed * 1e3);
+                if (skipped > 0) std::printf(", 跳过 %zu 条不完整的记录", skipped);
+                std::printf("\n");
+            }
+            count = static_cast<int>(matches.size());
+        }
+        MPI_Bcast(&failed, 1, MPI_INT, 0, grid.comm());
+        if (failed) throw std::runtime_error(grid.rank() == 0 ? error : "rank 0读取目录失败");
+        MPI_Bcast(&count, 1, MPI_INT, 0, grid.comm());
+        if (!read || count == 0) {
+            MPI_Finalize();
+            return 0;
+        }
+
+        // 按偏移直接读取第一个匹配, 与HDF5读取比较
+        CatalogRecord record;
+        if (grid.rank() == 0) record = matches.front();
+        MPI_Bcast(&record, sizeof(record), MPI_BYTE, 0, grid.comm());
+        const std::array<size_t, Nd> lattice = {record.dims[4], record.dims[3], record.dims[2], record.dims[1]};
+        const auto local = grid.local_extent(lattice);
+        Array7D<std::complex<double>> direct(local[T_DIM], local[Z_DIM], local[Y_DIM], local[X_DIM], record.dims[5]);
+        Array7D<std::complex<double>> hdf5(local[T_DIM], local[Z_DIM], local[Y_DIM], local[X_DIM], record.dims[5]);
+
+        MPI_Barrier(grid.comm());
+        double t0 = MPI_Wtime();
+        read7d_at(grid, record, direct);
+        double direct_elapsed = MPI_Wtime() - t0;
+        MPI_Barrier(grid.comm());
+        t0 = MPI_Wtime();
+        read7d(grid, record.path, record.dataset, hdf5);
+        double hdf5_elapsed = MPI_Wtime() - t0;
+        MPI_Allreduce(MPI_IN_PLACE, &direct_elapsed, 1, MPI_DOUBLE, MPI_MAX, grid.comm());
+        MPI_Allreduce(MPI_IN_PLACE, &hdf5_elapsed, 1, MPI_DOUBLE, MPI_MAX, grid.comm());
+
+        const uint64_t checksum = global_checksum(grid, direct);
+        long long bad = 0;
+        for (size_t i = 0; i < direct.storage_size(); ++i) {
+            if (direct.data_ptr()[i] != hdf5.data_ptr()[i]) ++bad;
+        }
+        MPI_Allreduce(MPI_IN_PLACE, &bad, 1, MPI_LONG_LONG, MPI_SUM, grid.comm());
+        const bool ok = bad == 0 && (record.checksum == 0 || checksum == record.checksum);
+        if (grid.rank() == 0) {
+            const double mb = record.data_bytes / (1024.0 * 1024.0);
+            std::printf("按偏移读取 %.1f MB: %.4f s (%.1f MB/s); read7d: %.4f s (%.1f MB/s)\n", mb, direct_elapsed,
+                        mb / direct_elapsed, hdf5_elapsed, mb / hdf5_elapsed);
+            std::printf("校验和 %s (目录中 %s), %lld 处与read7d不一致\n", hex(checksum).c_str(),
+                        hex(record.checksum).c_str(), bad);
+        }
+
+        MPI_Finalize();
+        return ok ? 0 : 1;
+    } catch (const H5::Exception& e) {
+        if (rank == 0) {
+            std::cerr << "HDF5错误：" << e.getCDetailMsg() << '\n';
+        }
+        MPI_Finalize();
+        return 1;
+    } catch (const std::exception& e) {
+        if (rank == 0) {
+            std::cerr << "错误：" << e.what() << '\n';
+        }
+        MPI_Finalize();
+        return 1;
+    }
+}
@@ -0,0 +1,164 @@
+#include <H5Cpp.h>
+#include <vector>
+#include <iostream>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <stdexcept>
+#include <complex>
+#include <algorithm>
+
+#include "public.h"
+#include "grid.h"
+#include "lattice_io.h"
+#include "direct_chunk.h"
+#include "validate.h"
+#include "hybrid.h"
+
+// 预压缩直接chunk写入的测试和基准:
+//   写入: write7d_direct (各进程线程池压缩, rank 0直接写chunk)
+//   读回: read7d_direct (各进程直接读chunk, 线程池解压), 再用read7d走HDF5过滤器管线读一遍,
+//         确认文件是普通的压缩数据集
+// --input给出时压缩已有的规范场文件, 否则生成测试数据
+// --tolerance/--relative给出时为有损模式: 报告实际的最大误差和平均plaquette的变化, 而不要求逐位相同
+int main(int argc, char** argv) {
+    // OpenMP线程只做计算, 只有主线程调用MPI
+    init_mpi_threads(&argc, &argv, MPI_THREAD_FUNNELED);
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    try {
+        if (argc < 2) {
+            if (rank == 0) {
+                std::cerr << "用法: mpirun -n <进程数> " << argv[0]
+                          << " Nx.Ny.Nz.Nt|auto [--input=文件 --dataset=LatticeMatrix] [--lattice=Lx.Ly.Lz.Lt]"
+                          << " [--out=chunk_7d.hdf5] [--chunk-t=0] [--level=1] [--shuffle=1] [--threads=0]"
+                          << " [--tolerance=0] [--relative=0] [--repeat=2] [--max-transfer=1G]\n";
+                std::cerr << "注意: 写入时所有压缩后的chunk都经rank 0一个进程串行写入文件, 写带宽不随进程数增长;"
+                          << " 进程数多时输出中rank 0的接收和写入用时会占满写入时间, 大规模的检查点请用write7d\n";
+            }
+            MPI_Finalize();
+            return 1;
+        }
+
+        ProcessGrid grid(MPI_COMM_WORLD, parse_grid(argv[1]),
+                         parse_mapping(find_option(argc, argv, "map", "cart")));
+        const std::string input = find_option(argc, argv, "input", "");
+        const std::string dataset_name = find_option(argc, argv, "dataset", "LatticeMatrix");
+        const std::string filename = find_option(argc, argv, "out", "chunk_7d.hdf5");
+        const int repeat = std::max(1, std::stoi(find_option(argc, argv, "repeat", "2")));
+
+        ChunkCodec codec;
+        codec.level = std::stoi(find_option(argc, argv, "level", "1"));
+        codec.shuffle = find_option(argc, argv, "shuffle", "1") != "0";
+        codec.threads = static_cast<unsigned>(std::stoul(find_option(argc, argv, "threads", "0")));
+        codec.tolerance = std::stod(find_option(argc, argv, "tolerance", "0"));
+        codec.relative_tolerance = std::stod(find_option(argc, argv, "relative", "0"));
+        const bool lossy = codec.tolerance > 0 || codec.relative_tolerance > 0;
+
+        IoOptions options;
+        options.max_transfer_bytes = parse_bytes(find_option(argc, argv, "max-transfer", "1G"));
+        options.chunk_t = std::stoul(find_option(argc, argv, "chunk-t", "0"));
+
+        // 有损模式需要计算plaquette, 各数组带1层ghost区
+        const std::array<size_t, Nd> ghost = lossy ? std::array<size_t, Nd>{1, 1, 1, 1}
+                                                   : std::array<size_t, Nd>{0, 0, 0, 0};
+        Array7D<std::complex<double>> u(1, 1, 1, 1, 1);
+        if (!input.empty()) {
+            u = read7d(grid, input, dataset_name, ghost, options);
+        } else {
+            const auto lattice = parse_lattice(find_option(argc, argv, "lattice", "8.8.8.8"));
+            const auto local = grid.local_extent(lattice);
+            const auto offset = grid.local_offset(local);
+            const size_t Nc = 3;
+            u = Array7D<std::complex<double>>(local[T_DIM], local[Z_DIM], local[Y_DIM], local[X_DIM], Nc, ghost);
+            for (size_t mu = 0; mu < Nd; ++mu)
+                for (size_t t = 0; t < local[T_DIM]; ++t)
+                    for (size_t z = 0; z < local[Z_DIM]; ++z)
+                        for (size_t y = 0; y < local[Y_DIM]; ++y)
+                            for (size_t x = 0; x < local[X_DIM]; ++x) {
+                                const double site = (((t + offset[T_DIM]) * 31 + z + offset[Z_DIM]) * 31
+                                                     + y + offset[Y_DIM]) * 31 + x + offset[X_DIM];
+                                for (size_t a = 0; a < Nc; ++a)
+                                    for (size_t b = 0; b < Nc; ++b)
+                                        u(mu, t, z, y, x, a, b) = std::polar(1.0, 0.01 * site + mu + a * Nc + b);
+                            }
+        }
+
+        ChunkStats best_write, best_read;
+        best_write.codec_seconds = best_read.codec_seconds = 1e30;
+        Array7D<std::complex<double>> direct(u.get_Lt(), u.get_Lz(), u.get_Ly(), u.get_Lx(), u.get_Nc(), ghost);
+        for (int r = 0; r < repeat; ++r) {
+            MPI_Barrier(grid.comm());
+            ChunkStats w = write7d_direct(grid, filename, dataset_name, u, codec, options);
+            if (w.codec_seconds + w.io_seconds < best_write.codec_seconds + best_write.io_seconds) best_write = w;
+
+            MPI_Barrier(grid.comm());
+            ChunkStats rd = read7d_direct(grid, filename, dataset_name, direct, codec, options);
+            if (rd.codec_seconds + rd.io_seconds < best_read.codec_seconds + best_read.io_seconds) best_read = rd;
+        }
+
+        // 通过HDF5过滤器管线读一遍, 无损时与直接读取的结果都应与原数据逐位相同;
+        // 有损时过滤器管线读出的是量化后的整数, 只比较直接读取的结果, 误差不应超过记录的上限
+        long long bad = 0;
+        double max_error = 0;
+        const size_t n = u.storage_size();
+        if (!lossy) {
+            Array7D<std::complex<double>> filtered(u.get_Lt(), u.get_Lz(), u.get_Ly(), u.get_Lx(), u.get_Nc());
+            read7d(grid, filename, dataset_name, filtered, options);
+            for (size_t i = 0; i < n; ++i) {
+                if (direct.data_ptr()[i] != u.data_ptr()[i] || filtered.data_ptr()[i] != u.data_ptr()[i]) ++bad;
+            }
+        } else {
+            for (size_t i = 0; i < n; ++i) {
+                const std::complex<double> d = direct.data_ptr()[i] - u.data_ptr()[i];
+                const double error = std::max(std::abs(d.real()), std::abs(d.imag()));
+                max_error = std::max(max_error, error);
+                if (error > best_read.tolerance * (1 + 1e-12)) ++bad;
+            }
+            MPI_Allreduce(MPI_IN_PLACE, &max_error, 1, MPI_DOUBLE, MPI_MAX, grid.comm());
+        }
+        MPI_Allreduce(MPI_IN_PLACE, &bad, 1, MPI_LONG_LONG, MPI_SUM, grid.comm());
+        GaugeSummary exact, approx;
+        if (lossy) {
+            exact = validate_gauge(grid, u);
+            approx = validate_gauge(grid, direct);
+        }
+
+        if (grid.rank() == 0) {
+            const double mb = best_write.raw_bytes / (1024.0 * 1024.0);
+            std::printf("%zu 个chunk, %.1f MB -> %.1f MB (压缩比 %.2f), 级别 %d, shuffle %s\n",
+                        best_write.chunks, mb, best_write.stored_bytes / (1024.0 * 1024.0),
+                        best_write.raw_bytes / best_write.stored_bytes, codec.level, codec.shuffle ? "开" : "关");
+            std::printf("写: 压缩 %.4f s (%.1f MB/s), 写入 %.4f s (rank 0: 等待接收 %.4f s, HDF5写入 %.4f s, %.1f MB/s)\n",
+                        best_write.codec_seconds, mb / best_write.codec_seconds, best_write.io_seconds,
+                        best_write.gather_seconds, best_write.write_seconds,
+                        best_write.stored_bytes / (1024.0 * 1024.0) / best_write.write_seconds);
+            std::printf("读: 读取 %.4f s, 解压 %.4f s (%.1f MB/s)\n", best_read.io_seconds,
+                        best_read.codec_seconds, mb / best_read.codec_seconds);
+            if (lossy) {
+                std::printf("误差上限 %.3g, 实际最大误差 %.3g, %lld 处超出\n", best_read.tolerance, max_error, bad);
+                std::printf("plaquette: 原始 %.12f, 有损 %.12f, 差 %.3g\n", exact.plaquette, approx.plaquette,
+                            approx.plaquette - exact.plaquette);
+            } else {
+                std::printf("%lld 处不一致\n", bad);
+            }
+        }
+
+        MPI_Finalize();
+        return bad == 0 ? 0 : 1;
+    } catch (const H5::Exception& e) {
+        if (rank == 0) {
+            std::cerr << "HDF5错误：" << e.getCDetailMsg() << '\n';
+        }
+        MPI_Finalize();
+        return 1;
+    } catch (const std::exception& e) {
+        if (rank == 0) {
+            std::cerr << "错误：" << e.what() << '\n';
+        }
+        MPI_Finalize();
+        return 1;
+    }
+}
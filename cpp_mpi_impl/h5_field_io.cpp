@@ -0,0 +1,184 @@
+#include <H5Cpp.h>
+#include <vector>
+#include <iostream>
+#include <array>
+#include <string>
+#include <stdexcept>
+#include <complex>
+
+#include "public.h"
+#include "grid.h"
+#include "lattice_io.h"
+#include "halo.h"
+
+// 旋量场和传播子的并行读写: 与规范场共用同一套集体I/O (write_field/read_field),
+// 数据集布局为 [源, Lt, Lz, Ly, Lx, 内部维度...], 最内层维度按实部虚部展开
+//   spinor:     [源, Lt, Lz, Ly, Lx, 4, 2*Nc]
+//   propagator: [源, Lt, Lz, Ly, Lx, 4, Nc, 4, 2*Nc]
+// 写入后读回 (带ghost区并做一次面交换), 校验内容并报告带宽
+namespace {
+
+// 按全局坐标和内部下标填充, 读回后可以逐元素比较
+template <typename... Inner>
+std::complex<double> site_value(const std::array<size_t, Nd>& offset, size_t o,
+                                size_t t, size_t z, size_t y, size_t x, Inner... i) {
+    const size_t idx[] = {static_cast<size_t>(i)...};
+    double inner = 0;
+    for (size_t v : idx) inner = inner * 8 + v;
+    return {static_cast<double>(((o * 64 + t + offset[T_DIM]) * 64 + z + offset[Z_DIM]) * 64 + y + offset[Y_DIM]),
+            (x + offset[X_DIM]) + inner / 4096.0};
+}
+
+// 写入, 读回并校验, 返回不一致的元素个数
+template <size_t InnerRank, typename Fill, typename Compare>
+long long round_trip(const ProcessGrid& grid, const std::string& filename, const std::string& name,
+                     LatticeField<std::complex<double>, InnerRank>& field,
+                     const std::array<size_t, Nd>& ghost, const IoOptions& options, int repeat,
+                     Fill&& fill, Compare&& compare) {
+    fill(field);
+    const double bytes = static_cast<double>(field.get_outer()) * field.get_Lt() * field.get_Lz()
+                       * field.get_Ly() * field.get_Lx() * field.get_inner_volume()
+                       * sizeof(std::complex<double>) * grid.size();
+
+    double write_time = 1e30, read_time = 1e30;
+    LatticeField<std::complex<double>, InnerRank> readback(1, 1, 1, 1, 1, field.get_inner_shape());
+    for (int r = 0; r < repeat; ++r) {
+        MPI_Barrier(grid.comm());
+        double t0 = MPI_Wtime();
+        write_field(grid, filename, name, field, options);
+        double elapsed = MPI_Wtime() - t0;
+        MPI_Allreduce(MPI_IN_PLACE, &elapsed, 1, MPI_DOUBLE, MPI_MAX, grid.comm());
+        write_time = std::min(write_time, elapsed);
+
+        MPI_Barrier(grid.comm());
+        t0 = MPI_Wtime();
+        readback = read_field<std::complex<double>, InnerRank>(grid, filename, name, field.get_inner_shape(),
+                                                               ghost, options);
+        elapsed = MPI_Wtime() - t0;
+        MPI_Allreduce(MPI_IN_PLACE, &elapsed, 1, MPI_DOUBLE, MPI_MAX, grid.comm());
+        read_time = std::min(read_time, elapsed);
+    }
+    HaloExchange<std::complex<double>, InnerRank> halo(grid, readback);
+    halo.exchange();
+
+    long long bad = compare(readback);
+    MPI_Allreduce(MPI_IN_PLACE, &bad, 1, MPI_LONG_LONG, MPI_SUM, grid.comm());
+    if (grid.rank() == 0) {
+        std::cout << name << ": " << bytes / (1024.0 * 1024.0) << " MB, 写 " << bytes / (1024.0 * 1024.0) / write_time
+                  << " MB/s, 读 " << bytes / (1024.0 * 1024.0) / read_time << " MB/s, " << bad << " 处不一致\n";
+    }
+    return bad;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    MPI_Init(&argc, &argv);
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    try {
+        if (argc < 2) {
+            if (rank == 0) {
+                std::cerr << "用法: mpirun -n <进程数> " << argv[0]
+                          << " Nx.Ny.Nz.Nt|auto [--kind=spinor|propagator|both] [--sources=12]"
+                          << " [--lattice=Lx.Ly.Lz.Lt] [--out=field_io.hdf5] [--repeat=2] [--max-transfer=1G]\n";
+            }
+            MPI_Finalize();
+            return 1;
+        }
+
+        ProcessGrid grid(MPI_COMM_WORLD, parse_grid(argv[1]),
+                         parse_mapping(find_option(argc, argv, "map", "cart")));
+        const auto lattice = parse_lattice(find_option(argc, argv, "lattice", "8.8.8.8"));
+        const std::string kind = find_option(argc, argv, "kind", "both");
+        const size_t sources = std::stoul(find_option(argc, argv, "sources", "12"));
+        const std::string filename = find_option(argc, argv, "out", "field_io.hdf5");
+        const int repeat = std::max(1, std::stoi(find_option(argc, argv, "repeat", "2")));
+        if (kind != "spinor" && kind != "propagator" && kind != "both") {
+            throw std::runtime_error("未知的场类型: " + kind);
+        }
+
+        IoOptions options;
+        options.max_transfer_bytes = parse_bytes(find_option(argc, argv, "max-transfer", "1G"));
+
+        const size_t Nc = 3, Ns = 4;
+        const auto local = grid.local_extent(lattice);
+        const auto offset = grid.local_offset(local);
+        const std::array<size_t, Nd> ghost = {1, 1, 1, 1};
+        long long bad = 0;
+
+        if (kind != "propagator") {
+            // 旋量场 psi[源][t][z][y][x][自旋][颜色]
+            LatticeField<std::complex<double>, 2> spinor(sources, local[T_DIM], local[Z_DIM], local[Y_DIM],
+                                                         local[X_DIM], {Ns, Nc});
+            auto each = [&](auto&& body) {
+                for (size_t s = 0; s < sources; ++s)
+                    for (size_t t = 0; t < local[T_DIM]; ++t)
+                        for (size_t z = 0; z < local[Z_DIM]; ++z)
+                            for (size_t y = 0; y < local[Y_DIM]; ++y)
+                                for (size_t x = 0; x < local[X_DIM]; ++x)
+                                    for (size_t a = 0; a < Ns; ++a)
+                                        for (size_t c = 0; c < Nc; ++c) body(s, t, z, y, x, a, c);
+            };
+            bad += round_trip(grid, filename, "Spinor", spinor, ghost, options, repeat,
+                [&](LatticeField<std::complex<double>, 2>& f) {
+                    each([&](size_t s, size_t t, size_t z, size_t y, size_t x, size_t a, size_t c) {
+                        f(s, t, z, y, x, a, c) = site_value(offset, s, t, z, y, x, a, c);
+                    });
+                },
+                [&](const LatticeField<std::complex<double>, 2>& f) {
+                    long long n = 0;
+                    each([&](size_t s, size_t t, size_t z, size_t y, size_t x, size_t a, size_t c) {
+                        if (f(s, t, z, y, x, a, c) != site_value(offset, s, t, z, y, x, a, c)) ++n;
+                    });
+                    return n;
+                });
+        }
+
+        if (kind != "spinor") {
+            // 点源传播子 S[源][t][z][y][x][汇自旋][汇颜色][源自旋][源颜色]
+            LatticeField<std::complex<double>, 4> propagator(sources, local[T_DIM], local[Z_DIM], local[Y_DIM],
+                                                             local[X_DIM], {Ns, Nc, Ns, Nc});
+            auto each = [&](auto&& body) {
+                for (size_t s = 0; s < sources; ++s)
+                    for (size_t t = 0; t < local[T_DIM]; ++t)
+                        for (size_t z = 0; z < local[Z_DIM]; ++z)
+                            for (size_t y = 0; y < local[Y_DIM]; ++y)
+                                for (size_t x = 0; x < local[X_DIM]; ++x)
+                                    for (size_t a = 0; a < Ns; ++a)
+                                        for (size_t c = 0; c < Nc; ++c)
+                                            for (size_t b = 0; b < Ns; ++b)
+                                                for (size_t d = 0; d < Nc; ++d) body(s, t, z, y, x, a, c, b, d);
+            };
+            bad += round_trip(grid, filename, "Propagator", propagator, ghost, options, repeat,
+                [&](LatticeField<std::complex<double>, 4>& f) {
+                    each([&](size_t s, size_t t, size_t z, size_t y, size_t x, size_t a, size_t c, size_t b, size_t d) {
+                        f(s, t, z, y, x, a, c, b, d) = site_value(offset, s, t, z, y, x, a, c, b, d);
+                    });
+                },
+                [&](const LatticeField<std::complex<double>, 4>& f) {
+                    long long n = 0;
+                    each([&](size_t s, size_t t, size_t z, size_t y, size_t x, size_t a, size_t c, size_t b, size_t d) {
+                        if (f(s, t, z, y, x, a, c, b, d) != site_value(offset, s, t, z, y, x, a, c, b, d)) ++n;
+                    });
+                    return n;
+                });
+        }
+
+        MPI_Finalize();
+        return bad == 0 ? 0 : 1;
+    } catch (const H5::Exception& e) {
+        if (rank == 0) {
+            std::cerr << "HDF5错误：" << e.getCDetailMsg() << '\n';
+        }
+        MPI_Finalize();
+        return 1;
+    } catch (const std::exception& e) {
+        if (rank == 0) {
+            std::cerr << "错误：" << e.what() << '\n';
+        }
+        MPI_Finalize();
+        return 1;
+    }
+}
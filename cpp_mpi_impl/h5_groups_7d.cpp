@@ -0,0 +1,153 @@
+#include <H5Cpp.h>
+#include <vector>
+#include <iostream>
+#include <array>
+#include <cstdio>
+#include <string>
+#include <stdexcept>
+#include <complex>
+#include <algorithm>
+#include <memory>
+
+#include "public.h"
+#include "grid.h"
+#include "lattice_io.h"
+#include "catalog.h"
+#include "groups.h"
+
+// 一个作业中同时读写多个独立系综: 把作业划分成--groups组, 每组在自己的通信子上建立进程网格,
+// 依次写出--configs个配置到自己的文件, 再全部读回按校验和核对
+// 各组的读写同时进行, 报告每组的带宽和全部组合计的带宽 (总数据量 / 所有组都完成的用时)
+int main(int argc, char** argv) {
+    MPI_Init(&argc, &argv);
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    try {
+        if (argc < 2) {
+            if (rank == 0) {
+                std::cerr << "用法: mpirun -n <进程数> " << argv[0]
+                          << " Nx.Ny.Nz.Nt|auto (每组的进程网格) [--groups=2] [--lattice=8.8.8.8] [--configs=2]"
+                          << " [--out=group_7d] [--map=plain|cart|node] [--max-transfer=1G] [--keep=0]\n";
+            }
+            MPI_Finalize();
+            return 1;
+        }
+
+        const int group_count = std::stoi(find_option(argc, argv, "groups", "2"));
+        const auto lattice = parse_lattice(find_option(argc, argv, "lattice", "8.8.8.8"));
+        const int configs = std::max(1, std::stoi(find_option(argc, argv, "configs", "2")));
+        const std::string prefix = find_option(argc, argv, "out", "group_7d");
+        const bool keep = find_option(argc, argv, "keep", "0") != "0";
+        const std::string dataset_name = "LatticeMatrix";
+        IoOptions options;
+        options.max_transfer_bytes = parse_bytes(find_option(argc, argv, "max-transfer", "1G"));
+
+        JobGroups groups(MPI_COMM_WORLD, group_count);
+        std::vector<std::string> files;
+        for (int c = 0; c < configs; ++c) {
+            files.push_back(group_filename(prefix + "_" + std::to_string(c) + ".hdf5", groups));
+        }
+
+        // 网格或格子尺寸只在某些组不合适时, 所有组一起退出, 不在后面的全局同步处等待
+        std::unique_ptr<ProcessGrid> grid_ptr;
+        std::array<size_t, Nd> local;
+        std::string error;
+        try {
+            grid_ptr.reset(new ProcessGrid(groups.comm(), parse_grid(argv[1]),
+                                           parse_mapping(find_option(argc, argv, "map", "cart"))));
+            local = grid_ptr->local_extent(lattice);
+        } catch (const std::exception& e) {
+            error = "组 " + std::to_string(groups.index()) + ": " + e.what();
+        }
+        int failed = !error.empty();
+        MPI_Allreduce(MPI_IN_PLACE, &failed, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+        if (failed) throw std::runtime_error(error.empty() ? "其他组的进程网格与组大小或格子尺寸不符" : error);
+        const ProcessGrid& grid = *grid_ptr;
+
+        const auto offset = grid.local_offset(local);
+        const size_t Nc = 3;
+        Array7D<std::complex<double>> u(local[T_DIM], local[Z_DIM], local[Y_DIM], local[X_DIM], Nc);
+        const double bytes = static_cast<double>(lattice[0] * lattice[1] * lattice[2] * lattice[3]) * Nd * Nc * Nc
+                           * sizeof(std::complex<double>) * configs;
+
+        // 写入: 每个组的配置按全局坐标、组号和配置编号生成, 各组内容不同
+        std::vector<uint64_t> checksums(configs);
+        MPI_Barrier(MPI_COMM_WORLD);
+        double start = MPI_Wtime();
+        for (int c = 0; c < configs; ++c) {
+            for (size_t mu = 0; mu < Nd; ++mu)
+                for (size_t t = 0; t < local[T_DIM]; ++t)
+                    for (size_t z = 0; z < local[Z_DIM]; ++z)
+                        for (size_t y = 0; y < local[Y_DIM]; ++y)
+                            for (size_t x = 0; x < local[X_DIM]; ++x) {
+                                const double site = (((t + offset[T_DIM]) * 31 + z + offset[Z_DIM]) * 31
+                                                     + y + offset[Y_DIM]) * 31 + x + offset[X_DIM];
+                                for (size_t a = 0; a < Nc * Nc; ++a) {
+                                    u.site_ptr(mu, t, z, y, x)[a] =
+                                        std::polar(1.0 + groups.index(), 0.01 * site + mu + a + c);
+                                }
+                            }
+            checksums[c] = global_checksum(grid, u);
+            write7d(grid, files[c], dataset_name, u, options);
+        }
+        double group_write = MPI_Wtime() - start;
+        MPI_Allreduce(MPI_IN_PLACE, &group_write, 1, MPI_DOUBLE, MPI_MAX, grid.comm());
+        MPI_Barrier(MPI_COMM_WORLD);
+        const double total_write = MPI_Wtime() - start;
+
+        // 读回: 各组读自己的文件
+        int bad = 0;
+        MPI_Barrier(MPI_COMM_WORLD);
+        start = MPI_Wtime();
+        for (int c = 0; c < configs; ++c) {
+            read7d(grid, files[c], dataset_name, u, options);
+            bad += global_checksum(grid, u) != checksums[c];
+        }
+        double group_read = MPI_Wtime() - start;
+        MPI_Allreduce(MPI_IN_PLACE, &group_read, 1, MPI_DOUBLE, MPI_MAX, grid.comm());
+        MPI_Barrier(MPI_COMM_WORLD);
+        const double total_read = MPI_Wtime() - start;
+        MPI_Allreduce(MPI_IN_PLACE, &bad, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+
+        const std::vector<GroupResult> writes = gather_group_results(groups, bytes, group_write);
+        const std::vector<GroupResult> reads = gather_group_results(groups, bytes, group_read);
+        if (rank == 0) {
+            const double mb = 1024.0 * 1024.0;
+            int size;
+            MPI_Comm_size(MPI_COMM_WORLD, &size);
+            std::printf("%d 个进程分成 %d 组, 每组 %d 个配置, 每个 %.1f MB\n", size, groups.count(), configs,
+                        bytes / configs / mb);
+            double total_bytes = 0;
+            for (size_t g = 0; g < writes.size(); ++g) {
+                total_bytes += writes[g].bytes;
+                std::printf("组 %zu: 写入 %.4f s (%.1f MB/s), 读取 %.4f s (%.1f MB/s)\n", g, writes[g].seconds,
+                            writes[g].bytes / mb / writes[g].seconds, reads[g].seconds,
+                            reads[g].bytes / mb / reads[g].seconds);
+            }
+            std::printf("合计: 写入 %.1f MB 用时 %.4f s (%.1f MB/s), 读取用时 %.4f s (%.1f MB/s)\n",
+                        total_bytes / mb, total_write, total_bytes / mb / total_write, total_read,
+                        total_bytes / mb / total_read);
+            std::printf("读回校验%s\n", bad == 0 ? "一致" : "不一致");
+        }
+
+        if (!keep && grid.rank() == 0) {
+            for (const std::string& file : files) std::remove(file.c_str());
+        }
+
+        MPI_Finalize();
+        return bad == 0 ? 0 : 1;
+    } catch (const H5::Exception& e) {
+        if (rank == 0) {
+            std::cerr << "HDF5错误：" << e.getCDetailMsg() << '\n';
+        }
+        MPI_Finalize();
+        return 1;
+    } catch (const std::exception& e) {
+        if (rank == 0) {
+            std::cerr << "错误：" << e.what() << '\n';
+        }
+        MPI_Finalize();
+        return 1;
+    }
+}
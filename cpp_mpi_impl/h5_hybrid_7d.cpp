@@ -0,0 +1,146 @@
+#include <H5Cpp.h>
+#include <vector>
+#include <iostream>
+#include <array>
+#include <cstdio>
+#include <future>
+#include <memory>
+#include <string>
+#include <stdexcept>
+#include <complex>
+
+#include "public.h"
+#include "grid.h"
+#include "lattice_io.h"
+#include "catalog.h"
+#include "hybrid.h"
+
+// 混合MPI+线程写入的基准: 每个进程用OpenMP线程生成配置并计算校验和, 同时由I/O线程写出上一个配置
+//   两个缓冲区轮换, 配置i的准备与配置i-1的写入重叠; MPI线程级别不足MULTIPLE时退回同步写入
+//   最后读回最后一个配置, 按与进程划分无关的校验和核对
+// 比较每节点N个单线程进程与N/k个k线程进程 (OMP_NUM_THREADS=k) 的总用时和带宽
+int main(int argc, char** argv) {
+    const int provided = init_mpi_threads(&argc, &argv,
+                                          parse_thread_level(find_option(argc, argv, "thread-level", "multiple")));
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    try {
+        if (argc < 2) {
+            if (rank == 0) {
+                std::cerr << "用法: [OMP_NUM_THREADS=k] mpirun -n <进程数> " << argv[0]
+                          << " Nx.Ny.Nz.Nt|auto [--lattice=8.8.8.8] [--configs=4] [--out=hybrid_7d]"
+                          << " [--thread-level=multiple|serialized|funneled|single] [--max-transfer=1G]\n";
+            }
+            MPI_Finalize();
+            return 1;
+        }
+
+        ProcessGrid grid(MPI_COMM_WORLD, parse_grid(argv[1]),
+                         parse_mapping(find_option(argc, argv, "map", "cart")));
+        const auto lattice = parse_lattice(find_option(argc, argv, "lattice", "8.8.8.8"));
+        const int configs = std::max(1, std::stoi(find_option(argc, argv, "configs", "4")));
+        const std::string prefix = find_option(argc, argv, "out", "hybrid_7d");
+        const std::string dataset_name = "LatticeMatrix";
+        IoOptions options;
+        options.max_transfer_bytes = parse_bytes(find_option(argc, argv, "max-transfer", "1G"));
+
+        const auto local = grid.local_extent(lattice);
+        const auto offset = grid.local_offset(local);
+        const size_t Nc = 3;
+        std::array<std::unique_ptr<Array7D<std::complex<double>>>, 2> buffers;
+        for (auto& b : buffers) {
+            b.reset(new Array7D<std::complex<double>>(local[T_DIM], local[Z_DIM], local[Y_DIM], local[X_DIM], Nc));
+        }
+        std::array<std::future<void>, 2> pending;
+        std::array<double, 2> io_seconds = {0, 0};
+        std::vector<uint64_t> checksums(configs);
+        double prep_total = 0, io_total = 0;
+
+        // 文件和I/O线程在MPI_Finalize之前关闭
+        double elapsed;
+        {
+            IoThread io(grid);
+            MPI_Barrier(grid.comm());
+            const double start = MPI_Wtime();
+            for (int c = 0; c < configs; ++c) {
+                const int slot = c % 2;
+                if (pending[slot].valid()) {
+                    pending[slot].get();
+                    io_total += io_seconds[slot];
+                }
+                Array7D<std::complex<double>>& u = *buffers[slot];
+
+                // 按全局坐标和配置编号生成数据, 各(mu, t, z)由OpenMP线程分担
+                const double prep_start = MPI_Wtime();
+                const long long outer = static_cast<long long>(Nd * local[T_DIM] * local[Z_DIM]);
+                #pragma omp parallel for schedule(static)
+                for (long long idx = 0; idx < outer; ++idx) {
+                    const size_t mu = idx / (local[T_DIM] * local[Z_DIM]);
+                    const size_t t = idx / local[Z_DIM] % local[T_DIM];
+                    const size_t z = idx % local[Z_DIM];
+                    for (size_t y = 0; y < local[Y_DIM]; ++y)
+                        for (size_t x = 0; x < local[X_DIM]; ++x) {
+                            const double site = (((t + offset[T_DIM]) * 31 + z + offset[Z_DIM]) * 31
+                                                 + y + offset[Y_DIM]) * 31 + x + offset[X_DIM];
+                            std::complex<double>* link = u.site_ptr(mu, t, z, y, x);
+                            for (size_t a = 0; a < Nc * Nc; ++a) link[a] = std::polar(1.0, 0.01 * site + mu + a + c);
+                        }
+                }
+                checksums[c] = global_checksum(grid, u);
+                prep_total += MPI_Wtime() - prep_start;
+
+                const std::string filename = prefix + "_" + std::to_string(c) + ".hdf5";
+                double* seconds = &io_seconds[slot];
+                pending[slot] = io.submit([&io, &u, &options, &dataset_name, filename, seconds] {
+                    const double t0 = MPI_Wtime();
+                    write7d(io.io_grid(), filename, dataset_name, u, options);
+                    *seconds = MPI_Wtime() - t0;
+                });
+            }
+            for (int slot = 0; slot < 2; ++slot) {
+                if (pending[slot].valid()) {
+                    pending[slot].get();
+                    io_total += io_seconds[slot];
+                }
+            }
+            elapsed = MPI_Wtime() - start;
+            if (grid.rank() == 0) {
+                std::printf("MPI线程级别 %s, %s写入\n", thread_level_name(provided), io.asynchronous() ? "后台" : "同步");
+            }
+        }
+
+        // 读回最后一个配置核对校验和
+        Array7D<std::complex<double>> check(local[T_DIM], local[Z_DIM], local[Y_DIM], local[X_DIM], Nc);
+        read7d(grid, prefix + "_" + std::to_string(configs - 1) + ".hdf5", dataset_name, check, options);
+        const bool ok = global_checksum(grid, check) == checksums[configs - 1];
+
+        MPI_Allreduce(MPI_IN_PLACE, &elapsed, 1, MPI_DOUBLE, MPI_MAX, grid.comm());
+        MPI_Allreduce(MPI_IN_PLACE, &prep_total, 1, MPI_DOUBLE, MPI_MAX, grid.comm());
+        MPI_Allreduce(MPI_IN_PLACE, &io_total, 1, MPI_DOUBLE, MPI_MAX, grid.comm());
+        if (grid.rank() == 0) {
+            const double mb = static_cast<double>(lattice[0] * lattice[1] * lattice[2] * lattice[3]) * Nd * Nc * Nc
+                            * sizeof(std::complex<double>) / (1024.0 * 1024.0);
+            std::printf("%d 个进程 x %d 个线程, %d 个配置, 每个 %.1f MB\n", grid.size(), compute_threads(), configs, mb);
+            std::printf("总用时 %.4f s (%.1f MB/s), 准备 %.4f s, 写入 %.4f s, 重叠 %.0f%%\n", elapsed,
+                        mb * configs / elapsed, prep_total, io_total,
+                        std::max(0.0, 100.0 * (prep_total + io_total - elapsed) / std::min(prep_total, io_total)));
+            std::printf("读回校验%s\n", ok ? "一致" : "不一致");
+        }
+
+        MPI_Finalize();
+        return ok ? 0 : 1;
+    } catch (const H5::Exception& e) {
+        if (rank == 0) {
+            std::cerr << "HDF5错误：" << e.getCDetailMsg() << '\n';
+        }
+        MPI_Finalize();
+        return 1;
+    } catch (const std::exception& e) {
+        if (rank == 0) {
+            std::cerr << "错误：" << e.what() << '\n';
+        }
+        MPI_Finalize();
+        return 1;
+    }
+}
@@ -0,0 +1,85 @@
+#include <H5Cpp.h>
+#include <iostream>
+#include <cstdio>
+#include <string>
+#include <stdexcept>
+#include <thread>
+#include <chrono>
+#include <memory>
+
+#include "public.h"
+#include "monitor.h"
+
+// 以SWMR读方式轮询索引文件 (由EnsembleIndex写入), 打印新追加的轨迹记录及其从写入到看到的延迟
+// 文件尚不存在或写入方尚未进入SWMR模式时重试; 写入方结束 (finished) 后读完剩余记录退出,
+// 或者超过--idle秒没有新记录时退出 (0表示一直等待)
+// 只需一个进程, 多进程启动时只有rank 0工作
+int main(int argc, char** argv) {
+    MPI_Init(&argc, &argv);
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    try {
+        const std::string index_file = find_option(argc, argv, "index", "ensemble_index.h5");
+        const double interval = std::stod(find_option(argc, argv, "interval", "0.2"));
+        const double idle = std::stod(find_option(argc, argv, "idle", "60"));
+        if (find_option(argc, argv, "help", "0") != "0") {
+            if (rank == 0) {
+                std::cerr << "用法: " << argv[0] << " [--index=ensemble_index.h5] [--interval=0.2] [--idle=60]\n";
+            }
+            MPI_Finalize();
+            return 1;
+        }
+
+        if (rank == 0) {
+            // 打开失败时不打印HDF5的错误栈, 由重试处理
+            H5::Exception::dontPrint();
+            std::unique_ptr<EnsembleIndexReader> reader;
+            double last = MPI_Wtime();
+            long long seen = 0;
+            bool done = false;
+            while (!done) {
+                if (!reader) {
+                    try {
+                        reader.reset(new EnsembleIndexReader(index_file));
+                    } catch (const H5::Exception&) {
+                    }
+                }
+                if (reader) {
+                    const bool finished = reader->finished();
+                    for (const TrajectoryRecord& r : reader->poll()) {
+                        std::printf("轨迹 %lld  plaquette %.12f  校验和 %016llx  延迟 %.3f s  %s\n", r.trajectory,
+                                    r.plaquette, static_cast<unsigned long long>(r.checksum),
+                                    unix_time() - r.wall_time, r.file.c_str());
+                        std::fflush(stdout);
+                        ++seen;
+                        last = MPI_Wtime();
+                    }
+                    // finished在poll之前读取, 此时看到的记录已经是全部
+                    done = finished;
+                }
+                if (!done && idle > 0 && MPI_Wtime() - last > idle) {
+                    std::fprintf(stderr, "%.0f 秒没有新记录, 退出\n", idle);
+                    break;
+                }
+                if (!done) std::this_thread::sleep_for(std::chrono::duration<double>(interval));
+            }
+            std::printf("共 %lld 条记录\n", seen);
+        }
+
+        MPI_Finalize();
+        return 0;
+    } catch (const H5::Exception& e) {
+        if (rank == 0) {
+            std::cerr << "HDF5错误：" << e.getCDetailMsg() << '\n';
+        }
+        MPI_Finalize();
+        return 1;
+    } catch (const std::exception& e) {
+        if (rank == 0) {
+            std::cerr << "错误：" << e.what() << '\n';
+        }
+        MPI_Finalize();
+        return 1;
+    }
+}
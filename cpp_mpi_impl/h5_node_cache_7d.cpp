@@ -0,0 +1,96 @@
+#include <H5Cpp.h>
+#include <vector>
+#include <iostream>
+#include <array>
+#include <cstdio>
+#include <string>
+#include <stdexcept>
+#include <complex>
+
+#include "public.h"
+#include "grid.h"
+#include "lattice_io.h"
+#include "catalog.h"
+#include "node_cache.h"
+#include "trace.h"
+
+// 节点共享读取与每进程各自读取的对比: 同一个配置先用read7d读一次作为参照,
+// 再用NodeSharedGauge读--repeat次 (--cache给出节点本地缓存目录时, 第二次起应当命中缓存),
+// 报告用时、每节点占用的内存, 并用与分解无关的全局校验和核对共享视图与参照逐字节一致
+int main(int argc, char** argv) {
+    MPI_Init(&argc, &argv);
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    try {
+        if (argc < 2) {
+            if (rank == 0) {
+                std::cerr << "用法: mpirun -n <进程数> " << argv[0]
+                          << " Nx.Ny.Nz.Nt|auto [--file=test_7d.hdf5] [--dataset=LatticeMatrix] [--cache=/dev/shm|none]"
+                          << " [--repeat=2] [--map=plain|cart|node] [--max-transfer=1G] [--trace=file.json]\n";
+            }
+            MPI_Finalize();
+            return 1;
+        }
+
+        ProcessGrid grid(MPI_COMM_WORLD, parse_grid(argv[1]),
+                         parse_mapping(find_option(argc, argv, "map", "node")));
+        const std::string filename = find_option(argc, argv, "file", "test_7d.hdf5");
+        const std::string dataset_name = find_option(argc, argv, "dataset", "LatticeMatrix");
+        const std::string cache = find_option(argc, argv, "cache", "/dev/shm");
+        const int repeat = std::max(1, std::stoi(find_option(argc, argv, "repeat", "2")));
+        const std::string trace_file = find_option(argc, argv, "trace", "");
+        IoOptions options;
+        options.max_transfer_bytes = parse_bytes(find_option(argc, argv, "max-transfer", "1G"));
+        trace_init(grid.comm(), trace_file);
+
+        uint64_t reference;
+        size_t rank_bytes;
+        {
+            MPI_Barrier(grid.comm());
+            const double t0 = MPI_Wtime();
+            Array7D<std::complex<double>> field = read7d(grid, filename, dataset_name, {0, 0, 0, 0}, options);
+            double elapsed = MPI_Wtime() - t0;
+            MPI_Allreduce(MPI_IN_PLACE, &elapsed, 1, MPI_DOUBLE, MPI_MAX, grid.comm());
+            reference = global_checksum(grid, field);
+            rank_bytes = field.storage_size() * sizeof(std::complex<double>);
+            if (grid.rank() == 0) {
+                std::printf("各进程读取: %.4f s, 每进程 %.2f MB\n", elapsed, rank_bytes / (1024.0 * 1024.0));
+            }
+        }
+
+        long long bad = 0;
+        for (int r = 0; r < repeat; ++r) {
+            MPI_Barrier(grid.comm());
+            const double t0 = MPI_Wtime();
+            NodeSharedGauge shared(grid, filename, dataset_name, options, cache == "none" ? "" : cache);
+            double elapsed = MPI_Wtime() - t0;
+            MPI_Allreduce(MPI_IN_PLACE, &elapsed, 1, MPI_DOUBLE, MPI_MAX, grid.comm());
+            int hits = shared.from_cache() ? 1 : 0;
+            MPI_Allreduce(MPI_IN_PLACE, &hits, 1, MPI_INT, MPI_MIN, grid.comm());
+            const bool same = global_checksum(grid, shared.field()) == reference;
+            if (!same) ++bad;
+            if (grid.rank() == 0) {
+                std::printf("节点共享 #%d: %.4f s, %s, 每节点 %d 个进程共用 %.2f MB, 校验和 %s\n", r, elapsed,
+                            hits ? "来自节点缓存" : "从文件读取", shared.ranks_per_node(),
+                            shared.node_bytes() / (1024.0 * 1024.0), same ? "一致" : "不一致");
+            }
+        }
+        trace_finish(grid.comm(), trace_file);
+
+        MPI_Finalize();
+        return bad == 0 ? 0 : 1;
+    } catch (const H5::Exception& e) {
+        if (rank == 0) {
+            std::cerr << "HDF5错误：" << e.getCDetailMsg() << '\n';
+        }
+        MPI_Finalize();
+        return 1;
+    } catch (const std::exception& e) {
+        if (rank == 0) {
+            std::cerr << "错误：" << e.what() << '\n';
+        }
+        MPI_Finalize();
+        return 1;
+    }
+}
@@ -0,0 +1,92 @@
+#include <H5Cpp.h>
+#include <vector>
+#include <iostream>
+#include <array>
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <stdexcept>
+
+#include "public.h"
+#include "preview.h"
+
+// 查看与格子写在同一文件中的块平均预览 (write7d --previews=...), 只读几MB的预览数据集:
+//   列出文件中的预览层; 打印指定层各方向的均值/最小值/最大值;
+//   --slice=mu.t.z 时打印该方向、该 (t, z) 块切片上的 y-x 图
+// 只需一个进程, 多进程启动时只有rank 0工作
+int main(int argc, char** argv) {
+    MPI_Init(&argc, &argv);
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    try {
+        const std::string filename = find_option(argc, argv, "file", "test_7d.hdf5");
+        const std::string dataset_name = find_option(argc, argv, "dataset", "LatticeMatrix");
+        const std::string block_text = find_option(argc, argv, "block", "0");
+        const std::string slice = find_option(argc, argv, "slice", "");
+        if (find_option(argc, argv, "help", "0") != "0") {
+            if (rank == 0) {
+                std::cerr << "用法: " << argv[0] << " [--file=test_7d.hdf5] [--dataset=LatticeMatrix]"
+                          << " [--block=最粗一层] [--slice=mu.t.z]\n";
+            }
+            MPI_Finalize();
+            return 1;
+        }
+
+        if (rank == 0) {
+            const std::vector<size_t> blocks = list_previews(filename, dataset_name);
+            if (blocks.empty()) throw std::runtime_error(filename + " 中没有 " + dataset_name + " 的预览");
+            std::cout << "预览层:";
+            for (size_t b : blocks) std::cout << ' ' << b << "^4";
+            std::cout << '\n';
+
+            const size_t block = std::stoul(block_text) == 0 ? blocks.back() : std::stoul(block_text);
+            std::array<hsize_t, 5> dims;
+            const double t0 = MPI_Wtime();
+            const std::vector<double> data = read_preview(filename, dataset_name, block, dims);
+            const double elapsed = MPI_Wtime() - t0;
+            const size_t volume = dims[1] * dims[2] * dims[3] * dims[4];
+            std::printf("块 %zu^4: [%llu, %llu, %llu, %llu, %llu], %.1f KB, 读取 %.4f s\n", block,
+                        static_cast<unsigned long long>(dims[0]), static_cast<unsigned long long>(dims[1]),
+                        static_cast<unsigned long long>(dims[2]), static_cast<unsigned long long>(dims[3]),
+                        static_cast<unsigned long long>(dims[4]), data.size() * sizeof(double) / 1024.0, elapsed);
+            for (size_t mu = 0; mu < dims[0]; ++mu) {
+                const auto first = data.begin() + mu * volume, last = first + volume;
+                double mean = 0;
+                for (auto it = first; it != last; ++it) mean += *it;
+                std::printf("  mu=%zu  Re tr U / Nc: 均值 %.8f  最小 %.8f  最大 %.8f\n", mu, mean / volume,
+                            *std::min_element(first, last), *std::max_element(first, last));
+            }
+
+            if (!slice.empty()) {
+                size_t mu = 0, t = 0, z = 0;
+                if (std::sscanf(slice.c_str(), "%zu.%zu.%zu", &mu, &t, &z) != 3 || mu >= dims[0] ||
+                    t >= dims[1] || z >= dims[2]) {
+                    throw std::runtime_error("切片超出范围: " + slice);
+                }
+                std::printf("mu=%zu, t块=%zu, z块=%zu (行为y, 列为x):\n", mu, t, z);
+                for (size_t y = 0; y < dims[3]; ++y) {
+                    for (size_t x = 0; x < dims[4]; ++x) {
+                        std::printf(" %8.4f", data[(((mu * dims[1] + t) * dims[2] + z) * dims[3] + y) * dims[4] + x]);
+                    }
+                    std::printf("\n");
+                }
+            }
+        }
+
+        MPI_Finalize();
+        return 0;
+    } catch (const H5::Exception& e) {
+        if (rank == 0) {
+            std::cerr << "HDF5错误：" << e.getCDetailMsg() << '\n';
+        }
+        MPI_Finalize();
+        return 1;
+    } catch (const std::exception& e) {
+        if (rank == 0) {
+            std::cerr << "错误：" << e.what() << '\n';
+        }
+        MPI_Finalize();
+        return 1;
+    }
+}
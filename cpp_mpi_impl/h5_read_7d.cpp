@@ -5,109 +5,77 @@
 #include <string>
 #include <stdexcept>
 #include <complex>
+#include <cstdio>
 
 #include "public.h"
+#include "grid.h"
+#include "lattice_io.h"
+#include "halo.h"
+#include "trace.h"
+#include "memory_probe.h"
+#include "io_profile.h"
+#include "subset_read.h"
+#include "catalog.h"
 
 int main(int argc, char** argv) {
     MPI_Init(&argc, &argv);
-    int rank, size;
+    int rank;
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
-    MPI_Comm_size(MPI_COMM_WORLD, &size);
 
     try {
         // 解析命令行参数
-        if (argc != 2) {
+        if (argc < 2) {
             if (rank == 0) {
-                std::cerr << "用法: mpirun -n <进程数> " << argv[0] << " Nx.Ny.Nz.Nt\n";
+                std::cerr << "用法: mpirun -n <进程数> " << argv[0]
+                          << " Nx.Ny.Nz.Nt|auto [--map=plain|cart|node] [--ghost=g|gx.gy.gz.gt] [--max-transfer=1G] [--profile=path|none] [--trace=file.json]"
+                          << " [--readers=all|node|N] [--memory=summary|file.csv] [--catalog=ensemble.cat]\n";
             }
             MPI_Finalize();
             return 1;
         }
 
-        // 解析进程网格
-        std::string grid_str(argv[1]);
-        int nx, ny, nz, nt;
-        size_t pos = 0;
-        nx = std::stoi(grid_str, &pos); grid_str = grid_str.substr(pos + 1);
-        ny = std::stoi(grid_str, &pos); grid_str = grid_str.substr(pos + 1);
-        nz = std::stoi(grid_str, &pos); grid_str = grid_str.substr(pos + 1);
-        nt = std::stoi(grid_str);
-
-        if (nx * ny * nz * nt != size) {
-            if (rank == 0) {
-                std::cerr << "错误：进程网格大小与总进程数不匹配\n";
-            }
-            MPI_Finalize();
-            return 1;
-        }
+        // 建立笛卡尔进程网格
+        const GridMapping mapping = parse_mapping(find_option(argc, argv, "map", "cart"));
+        ProcessGrid grid(MPI_COMM_WORLD, parse_grid(argv[1]), mapping);
 
         const std::string filename = "test_7d.hdf5";
         const std::string dataset_name = "LatticeMatrix";
-
+        const auto ghost = parse_ghost(find_option(argc, argv, "ghost", "0"));
+        const IoOptions options = tool_io_options(grid, argc, argv, filename);
+        const std::string trace_file = find_option(argc, argv, "trace", "");
+        const int readers = parse_readers(find_option(argc, argv, "readers", "all"));
+        const std::string memory = find_option(argc, argv, "memory", "");
+        const std::string catalog = find_option(argc, argv, "catalog", "");
+        trace_init(grid.comm(), trace_file);
+        memory_init(memory);
+
+        int status = 0;
         {
-            // 设置并行访问属性
-            H5::FileAccPropList plist;
-            plist.copy(H5::FileAccPropList::DEFAULT);
-            H5Pset_fapl_mpio(plist.getId(), MPI_COMM_WORLD, MPI_INFO_NULL);
-
-            // 打开HDF5文件
-            H5::H5File file(filename, H5F_ACC_RDONLY, H5::FileCreatPropList::DEFAULT, plist);
-            H5::DataSet dataset = file.openDataSet(dataset_name);
-
-            // 获取数据空间和维度信息
-            H5::DataSpace dataspace = dataset.getSpace();
-            const int ndims = dataspace.getSimpleExtentNdims();
-            std::vector<hsize_t> dims(ndims);
-            dataspace.getSimpleExtentDims(dims.data(), nullptr);
-
-            // 计算局部大小
-            const size_t local_lt = dims[1] / nt;
-            const size_t local_lz = dims[2] / nz;
-            const size_t local_ly = dims[3] / ny;
-            const size_t local_lx = dims[4] / nx;
-            const size_t Nc = dims[5];
-
-            // 计算当前进程在4D网格中的位置
-            Coords coords;
-            int remainder;
-            coords.data[T_DIM] = rank / (nx * ny * nz);  remainder = rank % (nx * ny * nz); // t
-            coords.data[Z_DIM] = remainder / (nx * ny);  remainder = remainder % (nx * ny); // z
-            coords.data[Y_DIM] = remainder / nx;         remainder = remainder % nx; // y
-            coords.data[X_DIM] = remainder;                 // x
-
-            // 计算偏移量
-            const size_t offset_t = coords.T() * local_lt;
-            const size_t offset_z = coords.Z() * local_lz;
-            const size_t offset_y = coords.Y() * local_ly;
-            const size_t offset_x = coords.X() * local_lx;
-
-            // 创建局部数组
-            Array7D<std::complex<double>> local_array(local_lt, local_lz, local_ly, local_lx, Nc);
-
-            // 设置局部数据空间
-            std::vector<hsize_t> local_dims = {
-                local_array.get_Ndim(), local_lt, local_lz, local_ly, local_lx, Nc, Nc * 2
-            };
-            std::vector<hsize_t> offset = {
-                0, offset_t, offset_z, offset_y, offset_x, 0, 0
-            };
-
-            H5::DataSpace memspace(local_dims.size(), local_dims.data());
-            dataspace.selectHyperslab(H5S_SELECT_SET, local_dims.data(), offset.data());
+            // 读取本进程的子格子, HDF5直接写入内部区域;
+            // 指定--readers时只由部分进程读文件, 再分发到各进程的内部区域
+            SubsetReadStats stats;
+            Array7D<std::complex<double>> local_array = readers < 0
+                ? read7d(grid, filename, dataset_name, ghost, options)
+                : read7d_subset(grid, filename, dataset_name, ghost, readers, options, &stats);
+            if (readers >= 0 && grid.rank() == 0) {
+                std::cout << stats.readers << " 个读进程: 读取 " << stats.read_seconds << " s, 分发 "
+                          << stats.scatter_seconds << " s\n";
+            }
 
-            // 设置集体读取属性
-            H5::DSetMemXferPropList xfer_plist;
-            xfer_plist.copy(H5::DSetMemXferPropList::DEFAULT);
-            H5Pset_dxpl_mpio(xfer_plist.getId(), H5FD_MPIO_COLLECTIVE);
+            // 发起ghost区的面交换, 与下面的输出重叠进行
+            HaloExchange<std::complex<double>> halo(grid, local_array);
+            halo.start();
 
-            // 读取数据
-            dataset.read(reinterpret_cast<double*>(local_array.data_ptr()), 
-                        H5::PredType::NATIVE_DOUBLE, memspace, dataspace, xfer_plist);
+            const size_t local_lt = local_array.get_Lt();
+            const size_t local_lz = local_array.get_Lz();
+            const size_t local_ly = local_array.get_Ly();
+            const size_t local_lx = local_array.get_Lx();
+            const size_t Nc = local_array.get_Nc();
 
             // 按进程顺序输出每个进程的两个Nc * Nc矩阵
-            for (int current_rank = 0; current_rank < size; ++current_rank) {
-                if (rank == current_rank) {
-                    std::cout << "\n进程 " << rank << " 的两个 Nc * Nc 矩阵:\n";
+            for (int current_rank = 0; current_rank < grid.size(); ++current_rank) {
+                if (grid.rank() == current_rank) {
+                    std::cout << "\n进程 " << grid.rank() << " 的两个 Nc * Nc 矩阵:\n";
                     // 固定其他维度,输出两个color矩阵
                     const size_t t = 0, z = 0, y = 0, x = 0;
                     // 输出前两个维度
@@ -134,12 +102,41 @@ int main(int argc, char** argv) {
                         std::cout << "\n";
                     }
                 }
-                MPI_Barrier(MPI_COMM_WORLD); // 确保按顺序输出
+                MPI_Barrier(grid.comm()); // 确保按顺序输出
+            }
+
+            {
+                TraceScope scope("halo.wait");
+                halo.wait();
+            }
+            if (grid.rank() == 0 && ghost[T_DIM] > 0) {
+                std::cout << "t方向ghost矩阵 (来自反方向邻居):\n";
+                for (size_t c1 = 0; c1 < Nc; ++c1) {
+                    for (size_t c2 = 0; c2 < Nc; ++c2) {
+                        std::cout << local_array.halo(3, -1, local_lz - 1, local_ly - 1, local_lx - 1, c1, c2) << "\t";
+                    }
+                    std::cout << "\n";
+                }
+                std::cout << std::flush;
+            }
+
+            // 可选的读回校验: 与写入时登记在目录中的校验和比较, 不一致时返回2
+            if (!catalog.empty()) {
+                const uint64_t expected = catalog_checksum(grid, catalog, filename, dataset_name);
+                if (expected == 0) throw std::runtime_error("目录 " + catalog + " 中没有 " + filename + " 的校验和");
+                const uint64_t checksum = global_checksum(grid, local_array);
+                if (grid.rank() == 0) {
+                    std::printf("校验和 %016llx, 目录中 %016llx, %s\n", static_cast<unsigned long long>(checksum),
+                                static_cast<unsigned long long>(expected), checksum == expected ? "一致" : "不一致");
+                }
+                status = checksum == expected ? 0 : 2;
             }
         }
+        memory_finish(grid.comm(), memory);
+        trace_finish(grid.comm(), trace_file);
 
         MPI_Finalize();
-        return 0;
+        return status;
     } catch (const H5::Exception& e) {
         if (rank == 0) {
             std::cerr << "HDF5错误：" << e.getCDetailMsg() << '\n';
@@ -0,0 +1,163 @@
+#include <H5Cpp.h>
+#include <vector>
+#include <iostream>
+#include <array>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <stdexcept>
+#include <complex>
+#include <algorithm>
+
+#include "public.h"
+#include "grid.h"
+#include "lattice_io.h"
+#include "halo.h"
+#include "subset_read.h"
+#include "memory_probe.h"
+
+// 重启读取的基准: 所有进程集体读 (read7d) 与只由部分进程读再分发 (read7d_subset) 的比较
+//   --readers=node,1,4  依次测试的读进程设置, node为每节点一个
+//   --lattice 给出时先生成并写出测试配置, 否则读已有的 --file
+// 每种方式取--repeat次中最快的一次, 并与read7d的结果逐位比较
+//   --memory=summary|file.csv  各读取方式每个阶段的内存增量 (read.*为全部进程集体读, subset.*为部分进程读)
+int main(int argc, char** argv) {
+    MPI_Init(&argc, &argv);
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    try {
+        if (argc < 2) {
+            if (rank == 0) {
+                std::cerr << "用法: mpirun -n <进程数> " << argv[0]
+                          << " Nx.Ny.Nz.Nt|auto [--file=test_7d.hdf5] [--dataset=LatticeMatrix] [--lattice=Lx.Ly.Lz.Lt]"
+                          << " [--readers=node,1] [--ghost=0] [--repeat=3] [--max-transfer=1G] [--memory=summary|file.csv]\n";
+            }
+            MPI_Finalize();
+            return 1;
+        }
+
+        ProcessGrid grid(MPI_COMM_WORLD, parse_grid(argv[1]),
+                         parse_mapping(find_option(argc, argv, "map", "cart")));
+        const std::string filename = find_option(argc, argv, "file", "test_7d.hdf5");
+        const std::string dataset_name = find_option(argc, argv, "dataset", "LatticeMatrix");
+        const std::string lattice_text = find_option(argc, argv, "lattice", "");
+        const auto ghost = parse_ghost(find_option(argc, argv, "ghost", "0"));
+        const int repeat = std::max(1, std::stoi(find_option(argc, argv, "repeat", "3")));
+        IoOptions options;
+        options.max_transfer_bytes = parse_bytes(find_option(argc, argv, "max-transfer", "1G"));
+        const std::string memory = find_option(argc, argv, "memory", "");
+
+        std::vector<std::string> settings;
+        {
+            std::stringstream ss(find_option(argc, argv, "readers", "node,1"));
+            std::string item;
+            while (std::getline(ss, item, ',')) {
+                if (!item.empty()) settings.push_back(item);
+            }
+        }
+
+        if (!lattice_text.empty()) {
+            const auto local = grid.local_extent(parse_lattice(lattice_text));
+            const auto offset = grid.local_offset(local);
+            const size_t Nc = 3;
+            Array7D<std::complex<double>> u(local[T_DIM], local[Z_DIM], local[Y_DIM], local[X_DIM], Nc);
+            for (size_t mu = 0; mu < Nd; ++mu)
+                for (size_t t = 0; t < local[T_DIM]; ++t)
+                    for (size_t z = 0; z < local[Z_DIM]; ++z)
+                        for (size_t y = 0; y < local[Y_DIM]; ++y)
+                            for (size_t x = 0; x < local[X_DIM]; ++x) {
+                                const double site = (((t + offset[T_DIM]) * 31 + z + offset[Z_DIM]) * 31
+                                                     + y + offset[Y_DIM]) * 31 + x + offset[X_DIM];
+                                for (size_t a = 0; a < Nc * Nc; ++a) {
+                                    u.site_ptr(mu, t, z, y, x)[a] = std::polar(1.0, 0.01 * site + mu + a);
+                                }
+                            }
+            write7d(grid, filename, dataset_name, u, options);
+        }
+
+        // 参照: 所有进程集体读; 两个数组都分配好以后才开始内存记样, 各阶段的增量只含读取本身
+        double best_all = 1e30;
+        Array7D<std::complex<double>> reference = read7d(grid, filename, dataset_name, ghost, options);
+        Array7D<std::complex<double>> subset(reference.get_Lt(), reference.get_Lz(), reference.get_Ly(),
+                                             reference.get_Lx(), reference.get_Nc(), ghost);
+        memory_init(memory);
+        for (int r = 0; r < repeat; ++r) {
+            MPI_Barrier(grid.comm());
+            const double t0 = MPI_Wtime();
+            read7d(grid, filename, dataset_name, reference, options);
+            double elapsed = MPI_Wtime() - t0;
+            MPI_Allreduce(MPI_IN_PLACE, &elapsed, 1, MPI_DOUBLE, MPI_MAX, grid.comm());
+            best_all = std::min(best_all, elapsed);
+        }
+        const double mb = static_cast<double>(reference.get_Lt() * reference.get_Lz() * reference.get_Ly()
+                                              * reference.get_Lx()) * Nd * reference.get_Nc() * reference.get_Nc()
+                        * sizeof(std::complex<double>) * grid.size() / (1024.0 * 1024.0);
+        if (grid.rank() == 0) {
+            std::printf("%d 个进程, %.1f MB\n", grid.size(), mb);
+            std::printf("全部进程集体读: %.4f s (%.1f MB/s)\n", best_all, mb / best_all);
+        }
+
+        bool ok = true;
+        for (const std::string& setting : settings) {
+            const int readers = parse_readers(setting);
+            if (readers < 0) continue;
+            SubsetReadStats best;
+            double best_total = 1e30;
+            size_t slab_max = 0;
+            for (int r = 0; r < repeat; ++r) {
+                // subset在各次重复和各设置间复用, 先清零, 否则漏写的区域会沿用上一次读入的正确值
+                std::fill(subset.data_ptr(), subset.data_ptr() + subset.storage_size(), std::complex<double>(0));
+                MPI_Barrier(grid.comm());
+                SubsetReadStats s = read7d_subset(grid, filename, dataset_name, subset, readers, options);
+                double times[2] = {s.read_seconds, s.scatter_seconds};
+                MPI_Allreduce(MPI_IN_PLACE, times, 2, MPI_DOUBLE, MPI_MAX, grid.comm());
+                s.read_seconds = times[0];
+                s.scatter_seconds = times[1];
+                if (s.read_seconds + s.scatter_seconds < best_total) {
+                    best_total = s.read_seconds + s.scatter_seconds;
+                    best = s;
+                }
+                slab_max = std::max(slab_max, s.slab_bytes);
+            }
+            unsigned long long slab = slab_max;
+            MPI_Allreduce(MPI_IN_PLACE, &slab, 1, MPI_UNSIGNED_LONG_LONG, MPI_MAX, grid.comm());
+
+            // 内部区域逐位比较, ghost区不由读取填充
+            long long bad = 0;
+            for (size_t mu = 0; mu < Nd; ++mu)
+                for (size_t t = 0; t < subset.get_Lt(); ++t)
+                    for (size_t z = 0; z < subset.get_Lz(); ++z)
+                        for (size_t y = 0; y < subset.get_Ly(); ++y)
+                            for (size_t x = 0; x < subset.get_Lx(); ++x) {
+                                const std::complex<double>* a = subset.site_ptr(mu, t, z, y, x);
+                                const std::complex<double>* b = reference.site_ptr(mu, t, z, y, x);
+                                for (size_t i = 0; i < subset.get_Nc() * subset.get_Nc(); ++i) bad += a[i] != b[i];
+                            }
+            MPI_Allreduce(MPI_IN_PLACE, &bad, 1, MPI_LONG_LONG, MPI_SUM, grid.comm());
+            ok = ok && bad == 0;
+            if (grid.rank() == 0) {
+                std::printf("%s: %d 个读进程, 读取 %.4f s + 分发 %.4f s = %.4f s (%.1f MB/s), "
+                            "最大切片 %.1f MB, %lld 处不一致\n", setting.c_str(), best.readers, best.read_seconds,
+                            best.scatter_seconds, best_total, mb / best_total, slab / (1024.0 * 1024.0), bad);
+            }
+        }
+
+        memory_finish(grid.comm(), memory);
+
+        MPI_Finalize();
+        return ok ? 0 : 1;
+    } catch (const H5::Exception& e) {
+        if (rank == 0) {
+            std::cerr << "HDF5错误：" << e.getCDetailMsg() << '\n';
+        }
+        MPI_Finalize();
+        return 1;
+    } catch (const std::exception& e) {
+        if (rank == 0) {
+            std::cerr << "错误：" << e.what() << '\n';
+        }
+        MPI_Finalize();
+        return 1;
+    }
+}
@@ -0,0 +1,124 @@
+#include <H5Cpp.h>
+#include <vector>
+#include <iostream>
+#include <array>
+#include <string>
+#include <stdexcept>
+#include <complex>
+#include <cstdio>
+
+#include "public.h"
+#include "grid.h"
+#include "lattice_io.h"
+#include "catalog.h"
+#include "staging.h"
+
+// 经节点本地存储写检查点: 先阻塞地暂存到--stage目录, 再在后台转存到--out
+// --work=秒 模拟转存期间继续进行的计算; --resume 只转存一个已暂存的检查点
+// 转存完成后用read7d读回最终文件, 与按相同规则生成的场比较global_checksum, 不一致时返回2
+int main(int argc, char** argv) {
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &provided);
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    try {
+        if (argc < 2) {
+            if (rank == 0) {
+                std::cerr << "用法: mpirun -n <进程数> " << argv[0]
+                          << " Nx.Ny.Nz.Nt|auto [--stage=/dev/shm] [--out=test_7d.hdf5] [--lattice=Lx.Ly.Lz.Lt]"
+                          << " [--thickness=1] [--work=0] [--keep=1] [--resume=1]\n";
+            }
+            MPI_Finalize();
+            return 1;
+        }
+
+        ProcessGrid grid(MPI_COMM_WORLD, parse_grid(argv[1]),
+                         parse_mapping(find_option(argc, argv, "map", "cart")));
+        const std::string stage_dir = find_option(argc, argv, "stage", "/dev/shm");
+        const std::string out_file = find_option(argc, argv, "out", "test_7d.hdf5");
+        const double work = std::stod(find_option(argc, argv, "work", "0"));
+        const bool keep = find_option(argc, argv, "keep", "0") != "0";
+        const bool resume = find_option(argc, argv, "resume", "0") != "0";
+        const std::string dataset_name = "LatticeMatrix";
+
+        IoOptions options;
+        options.max_transfer_bytes = parse_bytes(find_option(argc, argv, "max-transfer", "1G"));
+
+        // 转存线程在MPI_Finalize之前结束
+        int status = 0;
+        {
+            StagedCheckpoint checkpoint(grid, stage_dir, out_file, dataset_name,
+                                        std::stoul(find_option(argc, argv, "thickness", "1")), options);
+            checkpoint.keep_stage(keep);
+
+            // 各进程的数据只由rank和下标决定, 续转时按清单中的尺寸重新生成即可得到参照
+            auto make_field = [&](const std::array<size_t, Nd>& lattice) {
+                const auto local = grid.local_extent(lattice);
+                const size_t Nc = 3;
+                Array7D<std::complex<double>> local_array(local[T_DIM], local[Z_DIM], local[Y_DIM], local[X_DIM], Nc);
+                std::complex<double>* data = local_array.data_ptr();
+                const size_t n = local_array.get_Ndim() * local[T_DIM] * local[Z_DIM] * local[Y_DIM] * local[X_DIM] * Nc * Nc;
+                for (size_t i = 0; i < n; ++i) {
+                    const double temp = grid.rank() * 1000 + static_cast<double>(i % (9 * 32));
+                    data[i] = {temp, temp + 0.1};
+                }
+                return local_array;
+            };
+
+            double stage_time = 0;
+            if (resume) {
+                checkpoint.resume();
+            } else {
+                const Array7D<std::complex<double>> local_array =
+                    make_field(parse_lattice(find_option(argc, argv, "lattice", "4.4.4.4")));
+
+                MPI_Barrier(grid.comm());
+                const double t0 = MPI_Wtime();
+                checkpoint.stage(local_array);
+                stage_time = MPI_Wtime() - t0;
+            }
+
+            MPI_Barrier(grid.comm());
+            const double t0 = MPI_Wtime();
+            checkpoint.drain();
+            // 模拟转存期间的计算, 其间不调用MPI
+            while (MPI_Wtime() - t0 < work) {
+            }
+            const double compute_done = MPI_Wtime() - t0;
+            checkpoint.wait_durable();
+            const double durable_time = MPI_Wtime() - t0;
+
+            if (grid.rank() == 0) {
+                std::cout << "线程级别 " << provided << (provided >= MPI_THREAD_MULTIPLE ? ", 后台转存" : ", 同步转存")
+                          << "\n暂存用时 " << stage_time << " s (" << checkpoint_state_name(CheckpointState::LocalSafe)
+                          << "), 计算 " << compute_done << " s, 到持久化共 " << durable_time << " s ("
+                          << checkpoint_state_name(checkpoint.state()) << ")\n";
+            }
+
+            // 读回最终文件: 暂存块落在错误的网格坐标上时校验和不一致
+            const uint64_t expected = global_checksum(grid, make_field(checkpoint.lattice()));
+            const uint64_t actual = global_checksum(grid, read7d(grid, out_file, dataset_name, {0, 0, 0, 0}, options));
+            if (grid.rank() == 0) {
+                std::printf("读回校验和 %016llx, 参照 %016llx, %s\n", static_cast<unsigned long long>(actual),
+                            static_cast<unsigned long long>(expected), actual == expected ? "一致" : "不一致");
+            }
+            status = actual == expected ? 0 : 2;
+        }
+
+        MPI_Finalize();
+        return status;
+    } catch (const H5::Exception& e) {
+        if (rank == 0) {
+            std::cerr << "HDF5错误：" << e.getCDetailMsg() << '\n';
+        }
+        MPI_Finalize();
+        return 1;
+    } catch (const std::exception& e) {
+        if (rank == 0) {
+            std::cerr << "错误：" << e.what() << '\n';
+        }
+        MPI_Finalize();
+        return 1;
+    }
+}
@@ -0,0 +1,114 @@
+#include <H5Cpp.h>
+#include <vector>
+#include <iostream>
+#include <array>
+#include <string>
+#include <stdexcept>
+#include <complex>
+
+#include "public.h"
+#include "grid.h"
+#include "lattice_io.h"
+#include "stream.h"
+
+// 以有界内存流式处理LatticeMatrix:
+//   --in         逐片读取并统计各片的模方和 (分析过滤)
+//   --in --out   逐片读取, 乘以--scale后写到新文件 (转换)
+//   --out        不读文件, 逐片生成数据写出
+int main(int argc, char** argv) {
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_SERIALIZED, &provided);
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    try {
+        if (argc < 2) {
+            if (rank == 0) {
+                std::cerr << "用法: mpirun -n <进程数> " << argv[0]
+                          << " Nx.Ny.Nz.Nt|auto [--in=file] [--out=file] [--slab=t|dim] [--thickness=1]"
+                          << " [--scale=1] [--lattice=Lx.Ly.Lz.Lt]\n";
+            }
+            MPI_Finalize();
+            return 1;
+        }
+
+        ProcessGrid grid(MPI_COMM_WORLD, parse_grid(argv[1]),
+                         parse_mapping(find_option(argc, argv, "map", "cart")));
+        const std::string dataset_name = "LatticeMatrix";
+        const std::string in_file = find_option(argc, argv, "in", "");
+        const std::string out_file = find_option(argc, argv, "out", "");
+        const double scale = std::stod(find_option(argc, argv, "scale", "1"));
+
+        // 文件在MPI_Finalize之前关闭
+        {
+            IoOptions options;
+            options.max_transfer_bytes = parse_bytes(find_option(argc, argv, "max-transfer", "1G"));
+            SlabStream stream(grid, parse_slab_axis(find_option(argc, argv, "slab", "t")),
+                              std::stoul(find_option(argc, argv, "thickness", "1")), options);
+
+            if (!in_file.empty()) {
+                stream.open_input(in_file, dataset_name);
+            }
+            if (!out_file.empty()) {
+                stream.create_output(out_file, dataset_name,
+                                     parse_lattice(find_option(argc, argv, "lattice", "4.4.4.4")));
+            }
+
+            const auto& local = stream.local_dims();
+            std::vector<double> slab_norms;
+
+            MPI_Barrier(grid.comm());
+            const double start = MPI_Wtime();
+            stream.run([&](const SlabInfo& info, double* data) {
+                const size_t n = info.size();
+                if (in_file.empty()) {
+                    // 按全局下标生成数据
+                    for (size_t i = 0; i < n; ++i) {
+                        size_t rest = i;
+                        std::array<hsize_t, 7> idx;
+                        for (int k = 6; k >= 0; --k) {
+                            idx[k] = rest % info.count[k] + info.start[k];
+                            rest /= info.count[k];
+                        }
+                        data[i] = grid.rank() * 1000.0 + static_cast<double>(
+                            (((idx[0] * local[1] + idx[1]) * local[2] + idx[2]) * local[3] + idx[3]) * local[4] + idx[4]);
+                    }
+                } else if (scale != 1.0) {
+                    for (size_t i = 0; i < n; ++i) data[i] *= scale;
+                }
+
+                double norm = 0;
+                for (size_t i = 0; i < n; ++i) norm += data[i] * data[i];
+                slab_norms.push_back(norm);
+            });
+            const double elapsed = MPI_Wtime() - start;
+
+            // 回调中不调用MPI, 结束后统一归约
+            std::vector<double> total(slab_norms.size());
+            MPI_Reduce(slab_norms.data(), total.data(), static_cast<int>(slab_norms.size()),
+                       MPI_DOUBLE, MPI_SUM, 0, grid.comm());
+            if (grid.rank() == 0) {
+                std::cout << "线程级别 " << provided << ", 共 " << total.size() << " 片, 每片缓冲 "
+                          << stream.slab_bytes() / (1024.0 * 1024.0) << " MB, 用时 " << elapsed << " s\n";
+                for (size_t k = 0; k < total.size(); ++k) {
+                    std::cout << "片 " << k << " 模方和: " << total[k] << "\n";
+                }
+            }
+        }
+
+        MPI_Finalize();
+        return 0;
+    } catch (const H5::Exception& e) {
+        if (rank == 0) {
+            std::cerr << "HDF5错误：" << e.getCDetailMsg() << '\n';
+        }
+        MPI_Finalize();
+        return 1;
+    } catch (const std::exception& e) {
+        if (rank == 0) {
+            std::cerr << "错误：" << e.what() << '\n';
+        }
+        MPI_Finalize();
+        return 1;
+    }
+}
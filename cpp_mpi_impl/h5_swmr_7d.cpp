@@ -0,0 +1,153 @@
+#include <H5Cpp.h>
+#include <vector>
+#include <iostream>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <stdexcept>
+#include <complex>
+#include <algorithm>
+#include <thread>
+#include <chrono>
+
+#include "public.h"
+#include "grid.h"
+#include "lattice_io.h"
+#include "catalog.h"
+#include "monitor.h"
+
+// 监视开销的基准: 模拟一个逐条轨迹写出配置的长时间运行, 每条轨迹交替做两次写入
+//   off: 只用write7d并行写配置
+//   on:  write7d之后计算校验和, 由rank 0向SWMR索引文件追加一条记录
+// 两边都每条轨迹写一个新文件, 计时之外删除, 文件创建的开销相同;
+// on的写入, 校验和, 索引追加分别计时, 报告各自的平均/中位用时和总开销; 运行期间可以另开monitor7d --index=...观察记录
+// plaquette由调用方提供, 这里用平均链迹代替, 在计时之外计算
+int main(int argc, char** argv) {
+    MPI_Init(&argc, &argv);
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    try {
+        if (argc < 2) {
+            if (rank == 0) {
+                std::cerr << "用法: mpirun -n <进程数> " << argv[0]
+                          << " Nx.Ny.Nz.Nt|auto [--lattice=Lx.Ly.Lz.Lt] [--trajectories=8] [--prefix=swmr_cfg]"
+                          << " [--index=ensemble_index.h5] [--pause=0] [--keep=0] [--max-transfer=1G]\n";
+            }
+            MPI_Finalize();
+            return 1;
+        }
+
+        ProcessGrid grid(MPI_COMM_WORLD, parse_grid(argv[1]),
+                         parse_mapping(find_option(argc, argv, "map", "cart")));
+        const auto lattice = parse_lattice(find_option(argc, argv, "lattice", "8.8.8.8"));
+        const int trajectories = std::max(1, std::stoi(find_option(argc, argv, "trajectories", "8")));
+        const std::string prefix = find_option(argc, argv, "prefix", "swmr_cfg");
+        const std::string index_file = find_option(argc, argv, "index", "ensemble_index.h5");
+        const double pause = std::stod(find_option(argc, argv, "pause", "0"));
+        const bool keep = find_option(argc, argv, "keep", "0") != "0";
+        const std::string dataset_name = "LatticeMatrix";
+        const size_t Nc = 3;
+
+        IoOptions options;
+        options.max_transfer_bytes = parse_bytes(find_option(argc, argv, "max-transfer", "1G"));
+
+        const auto local = grid.local_extent(lattice);
+        const auto offset = grid.local_offset(local);
+        Array7D<std::complex<double>> u(local[T_DIM], local[Z_DIM], local[Y_DIM], local[X_DIM], Nc);
+
+        // 每条轨迹各阶段的用时 (各进程最大值)
+        std::vector<double> off_times, write_times, checksum_times, append_times, on_times;
+        auto timed = [&](std::vector<double>& times, auto&& step) {
+            MPI_Barrier(grid.comm());
+            const double t0 = MPI_Wtime();
+            step();
+            double elapsed = MPI_Wtime() - t0;
+            MPI_Allreduce(MPI_IN_PLACE, &elapsed, 1, MPI_DOUBLE, MPI_MAX, grid.comm());
+            times.push_back(elapsed);
+        };
+        {
+            EnsembleIndex index(grid, index_file);
+            for (int n = 0; n < trajectories; ++n) {
+                // 本条轨迹的配置和 "plaquette"
+                double trace = 0;
+                for (size_t t = 0; t < local[T_DIM]; ++t)
+                    for (size_t z = 0; z < local[Z_DIM]; ++z)
+                        for (size_t y = 0; y < local[Y_DIM]; ++y)
+                            for (size_t x = 0; x < local[X_DIM]; ++x) {
+                                const double site = (((t + offset[T_DIM]) * 31 + z + offset[Z_DIM]) * 31
+                                                     + y + offset[Y_DIM]) * 31 + x + offset[X_DIM];
+                                for (size_t mu = 0; mu < Nd; ++mu)
+                                    for (size_t a = 0; a < Nc; ++a)
+                                        for (size_t b = 0; b < Nc; ++b) {
+                                            u(mu, t, z, y, x, a, b) = std::polar(1.0, 0.01 * site * (n + 1) + mu + a - b);
+                                            if (a == b) trace += u(mu, t, z, y, x, a, b).real();
+                                        }
+                            }
+                MPI_Allreduce(MPI_IN_PLACE, &trace, 1, MPI_DOUBLE, MPI_SUM, grid.comm());
+                const double plaquette = trace / (Nd * Nc * static_cast<double>(lattice[0]) * lattice[1]
+                                                  * lattice[2] * lattice[3]);
+                const std::string off_cfg = prefix + "_off_" + std::to_string(n) + ".h5";
+                const std::string cfg = prefix + "_" + std::to_string(n) + ".h5";
+
+                timed(off_times, [&] { write7d(grid, off_cfg, dataset_name, u, options); });
+
+                TrajectoryRecord record;
+                record.trajectory = n;
+                record.plaquette = plaquette;
+                record.file = cfg;
+                timed(write_times, [&] { write7d(grid, cfg, dataset_name, u, options); });
+                timed(checksum_times, [&] { record.checksum = global_checksum(grid, u); });
+                timed(append_times, [&] {
+                    record.wall_time = unix_time();
+                    index.append(record);
+                });
+                on_times.push_back(write_times.back() + checksum_times.back() + append_times.back());
+
+                if (grid.rank() == 0) {
+                    std::remove(off_cfg.c_str());
+                    if (!keep) std::remove(cfg.c_str());
+                }
+                if (pause > 0) std::this_thread::sleep_for(std::chrono::duration<double>(pause));
+            }
+            index.finish();
+        }
+
+        if (grid.rank() == 0) {
+            auto summary = [](std::vector<double> v) {
+                double mean = 0;
+                for (double x : v) mean += x;
+                mean /= v.size();
+                std::sort(v.begin(), v.end());
+                return std::array<double, 2>{mean, v[v.size() / 2]};
+            };
+            const auto off = summary(off_times), on = summary(on_times);
+            const auto write = summary(write_times), checksum = summary(checksum_times), append = summary(append_times);
+            const double mb = static_cast<double>(Nd) * lattice[0] * lattice[1] * lattice[2] * lattice[3]
+                            * Nc * Nc * sizeof(std::complex<double>) / (1024.0 * 1024.0);
+            std::printf("%d 条轨迹, 每条 %.1f MB\n", trajectories, mb);
+            std::printf("off: 平均 %.4f s, 中位 %.4f s\n", off[0], off[1]);
+            std::printf("on:  平均 %.4f s, 中位 %.4f s\n", on[0], on[1]);
+            std::printf("  写入:     平均 %.4f s, 中位 %.4f s\n", write[0], write[1]);
+            std::printf("  校验和:   平均 %.4f s, 中位 %.4f s\n", checksum[0], checksum[1]);
+            std::printf("  索引追加: 平均 %.4f s, 中位 %.4f s\n", append[0], append[1]);
+            std::printf("监视开销 (中位): %+.4f s (%+.1f%%)\n", on[1] - off[1], 100 * (on[1] - off[1]) / off[1]);
+        }
+
+        MPI_Finalize();
+        return 0;
+    } catch (const H5::Exception& e) {
+        if (rank == 0) {
+            std::cerr << "HDF5错误：" << e.getCDetailMsg() << '\n';
+        }
+        MPI_Finalize();
+        return 1;
+    } catch (const std::exception& e) {
+        if (rank == 0) {
+            std::cerr << "错误：" << e.what() << '\n';
+        }
+        MPI_Finalize();
+        return 1;
+    }
+}
@@ -0,0 +1,135 @@
+#include <H5Cpp.h>
+#include <vector>
+#include <iostream>
+#include <array>
+#include <cstdio>
+#include <string>
+#include <stdexcept>
+#include <complex>
+#include <cmath>
+
+#include "public.h"
+#include "grid.h"
+#include "lattice_io.h"
+#include "halo.h"
+#include "trace.h"
+#include "io_profile.h"
+#include "validate.h"
+#include "hybrid.h"
+
+// 读入规范场并做物理检查: 平均plaquette、最大幺正性偏差和各方向范数, rank 0输出一行汇总
+// 幺正性偏差超过--tolerance时返回2, 可以在每次重启前检查配置
+// --selftest=1时不读文件, 在--lattice尺寸上构造纯规范场 U_mu(x) = g(x) g(x+mu)^dagger 做检查,
+// plaquette与1相差超过1e-12时返回2
+int main(int argc, char** argv) {
+    // OpenMP线程只做计算, 只有主线程调用MPI
+    init_mpi_threads(&argc, &argv, MPI_THREAD_FUNNELED);
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    try {
+        if (argc < 2) {
+            if (rank == 0) {
+                std::cerr << "用法: mpirun -n <进程数> " << argv[0]
+                          << " Nx.Ny.Nz.Nt|auto [--file=test_7d.hdf5] [--dataset=LatticeMatrix] [--tolerance=1e-10]"
+                          << " [--map=plain|cart|node] [--max-transfer=1G] [--profile=path|none] [--trace=file.json]"
+                          << " [--selftest=0|1] [--lattice=8.8.8.8]\n";
+            }
+            MPI_Finalize();
+            return 1;
+        }
+
+        ProcessGrid grid(MPI_COMM_WORLD, parse_grid(argv[1]),
+                         parse_mapping(find_option(argc, argv, "map", "cart")));
+        const std::string filename = find_option(argc, argv, "file", "test_7d.hdf5");
+        const std::string dataset_name = find_option(argc, argv, "dataset", "LatticeMatrix");
+        const double tolerance = std::stod(find_option(argc, argv, "tolerance", "1e-10"));
+        const bool selftest = find_option(argc, argv, "selftest", "0") != "0";
+        const std::string trace_file = find_option(argc, argv, "trace", "");
+        trace_init(grid.comm(), trace_file);
+
+        int status = 0;
+        if (selftest) {
+            const auto lattice = parse_lattice(find_option(argc, argv, "lattice", "8.8.8.8"));
+            const auto local = grid.local_extent(lattice);
+            const auto offset = grid.local_offset(local);
+            const size_t Nc = 3;
+            Array7D<std::complex<double>> u(local[T_DIM], local[Z_DIM], local[Y_DIM], local[X_DIM], Nc, {1, 1, 1, 1});
+
+            // g(x) = D1(x) F D2(x): D1、D2是随全局坐标变化的对角相位, F是3x3离散傅里叶矩阵,
+            // 得到的链接不是对角阵, 彼此也不对易, plaquette的乘法顺序错了就不等于1
+            auto gauge = [&](std::array<size_t, Nd> site, std::complex<double>* g) {
+                const double phase = 0.37 * site[X_DIM] + 0.23 * site[Y_DIM] + 0.19 * site[Z_DIM] + 0.11 * site[T_DIM];
+                for (size_t a = 0; a < Nc; ++a)
+                    for (size_t b = 0; b < Nc; ++b) {
+                        g[a * Nc + b] = std::polar(1.0 / std::sqrt(3.0),
+                                                   2 * M_PI * a * b / Nc + phase * (a + 1) - 0.7 * phase * b);
+                    }
+            };
+            const std::array<size_t, Nd> shift[Nd] = {{1, 0, 0, 0}, {0, 1, 0, 0}, {0, 0, 1, 0}, {0, 0, 0, 1}};
+            for (size_t mu = 0; mu < Nd; ++mu)
+                for (size_t t = 0; t < local[T_DIM]; ++t)
+                    for (size_t z = 0; z < local[Z_DIM]; ++z)
+                        for (size_t y = 0; y < local[Y_DIM]; ++y)
+                            for (size_t x = 0; x < local[X_DIM]; ++x) {
+                                std::array<size_t, Nd> site;
+                                site[X_DIM] = x + offset[X_DIM];
+                                site[Y_DIM] = y + offset[Y_DIM];
+                                site[Z_DIM] = z + offset[Z_DIM];
+                                site[T_DIM] = t + offset[T_DIM];
+                                std::array<size_t, Nd> next;
+                                for (int d = 0; d < Nd; ++d) next[d] = (site[d] + shift[mu][d]) % lattice[d];
+                                std::complex<double> g[9], h[9], h_dagger[9];
+                                gauge(site, g);
+                                gauge(next, h);
+                                for (size_t a = 0; a < Nc; ++a)
+                                    for (size_t b = 0; b < Nc; ++b) h_dagger[a * Nc + b] = std::conj(h[b * Nc + a]);
+                                detail::mat_mul(g, h_dagger, u.site_ptr(mu, t, z, y, x), Nc);
+                            }
+
+            const GaugeSummary summary = validate_gauge(grid, u);
+            if (grid.rank() == 0) {
+                const double deviation = std::abs(summary.plaquette - 1);
+                const bool ok = deviation <= 1e-12 && summary.max_unitarity <= tolerance;
+                std::printf("自检 (纯规范场 %zux%zux%zux%zu): plaquette %.15f (|P - 1| %.3e), max|U^dagger U - 1| %.3e %s\n",
+                            lattice[X_DIM], lattice[Y_DIM], lattice[Z_DIM], lattice[T_DIM], summary.plaquette,
+                            deviation, summary.max_unitarity, ok ? "通过" : "失败");
+                status = ok ? 0 : 2;
+            }
+        } else {
+            const IoOptions options = tool_io_options(grid, argc, argv, filename);
+            MPI_Barrier(grid.comm());
+            const double t0 = MPI_Wtime();
+            Array7D<std::complex<double>> u = read7d(grid, filename, dataset_name, {1, 1, 1, 1}, options);
+            const double t1 = MPI_Wtime();
+            const GaugeSummary summary = validate_gauge(grid, u);
+            const double t2 = MPI_Wtime();
+
+            if (grid.rank() == 0) {
+                const bool ok = summary.max_unitarity <= tolerance;
+                std::printf("%s: plaquette %.12f, max|U^dagger U - 1| %.3e, 范数 x %.6f y %.6f z %.6f t %.6f"
+                            " (读取 %.3f s, 检查 %.3f s) %s\n",
+                            filename.c_str(), summary.plaquette, summary.max_unitarity,
+                            summary.norm[X_DIM], summary.norm[Y_DIM], summary.norm[Z_DIM], summary.norm[T_DIM],
+                            t1 - t0, t2 - t1, ok ? "通过" : "失败");
+                status = ok ? 0 : 2;
+            }
+        }
+        trace_finish(grid.comm(), trace_file);
+
+        MPI_Finalize();
+        return status;
+    } catch (const H5::Exception& e) {
+        if (rank == 0) {
+            std::cerr << "HDF5错误：" << e.getCDetailMsg() << '\n';
+        }
+        MPI_Finalize();
+        return 1;
+    } catch (const std::exception& e) {
+        if (rank == 0) {
+            std::cerr << "错误：" << e.what() << '\n';
+        }
+        MPI_Finalize();
+        return 1;
+    }
+}
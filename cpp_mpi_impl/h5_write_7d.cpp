@@ -8,75 +8,51 @@
 #include <cassert>
 
 #include "public.h"
+#include "grid.h"
+#include "lattice_io.h"
+#include "trace.h"
+#include "memory_probe.h"
+#include "io_profile.h"
+#include "preview.h"
+#include "catalog.h"
 
 int main(int argc, char** argv) {
     MPI_Init(&argc, &argv);
-    int rank, size;
+    int rank;
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
-    MPI_Comm_size(MPI_COMM_WORLD, &size);
 
     try {
         // 设置全局和局部数组大小
-        const size_t Lt = 4, Lz = 4, Ly = 4, Lx = 4, Nc = 3;  // 全局大小
-
+        const auto lattice = parse_lattice(find_option(argc, argv, "lattice", "4.4.4.4"));
+        const size_t Lt = lattice[T_DIM], Lz = lattice[Z_DIM], Ly = lattice[Y_DIM], Lx = lattice[X_DIM];  // 全局大小
+        const size_t Nc = 3;
 
         // 解析命令行参数 (x,y,z,t顺序)
-        if (argc != 2) {
-            if (rank == 0) {
-                std::cerr << "用法: mpirun -n <进程数> " << argv[0] << " Nx.Ny.Nz.Nt\n";
-            }
-            MPI_Finalize();
-            return 1;
-        }
-
-        // 解析进程网格
-        std::string grid_str(argv[1]);
-        int nx, ny, nz, nt;
-        size_t pos = 0;
-        nx = std::stoi(grid_str, &pos); grid_str = grid_str.substr(pos + 1);
-        ny = std::stoi(grid_str, &pos); grid_str = grid_str.substr(pos + 1);
-        nz = std::stoi(grid_str, &pos); grid_str = grid_str.substr(pos + 1);
-        nt = std::stoi(grid_str);
-
-        if (nx * ny * nz * nt != size) {
-            if (rank == 0) {
-                std::cerr << "错误：进程网格大小 (" << nx << "," << ny << "," 
-                         << nz << "," << nt << ") 与总进程数 " << size << " 不匹配\n";
-            }
-            MPI_Finalize();
-            return 1;
-        }
-
-
-        
-        // 确保可以整除
-        if (Lt % nt != 0 || Lz % nz != 0 || Ly % ny != 0 || Lx % nx != 0) {
+        if (argc < 2) {
             if (rank == 0) {
-                std::cerr << "错误：网格维度必须能被进程数整除\n";
+                std::cerr << "用法: mpirun -n <进程数> " << argv[0]
+                          << " Nx.Ny.Nz.Nt|auto [--map=plain|cart|node] [--lattice=Lx.Ly.Lz.Lt] [--max-transfer=1G] [--profile=path|none] [--trace=file.json]"
+                          << " [--previews=2,4] [--catalog=ensemble.cat] [--memory=summary|file.csv]\n";
             }
             MPI_Finalize();
             return 1;
         }
 
-        // 计算局部大小
-        const size_t local_lt = Lt / nt;
-        const size_t local_lz = Lz / nz;
-        const size_t local_ly = Ly / ny;
-        const size_t local_lx = Lx / nx;
-
-        // 计算当前进程在4D网格中的位置
-        Coords coords;
-        int remainder;
-        coords.data[T_DIM] = rank / (nx * ny * nz);   remainder = rank % (nx * ny * nz); // t
-        coords.data[Z_DIM] = remainder / (nx * ny);   remainder = remainder % (nx * ny); // z
-        coords.data[Y_DIM] = remainder / nx;          remainder = remainder % nx; // y
-        coords.data[X_DIM] = remainder;          // x
-
-        // 计算局部数组在全局数组中的偏移
-        const size_t offset_t = coords.T() * local_lt;
-        const size_t offset_z = coords.Z() * local_lz;
-        const size_t offset_y = coords.Y() * local_ly;
-        const size_t offset_x = coords.X() * local_lx;
+        // 建立笛卡尔进程网格
+        const GridMapping mapping = parse_mapping(find_option(argc, argv, "map", "cart"));
+        ProcessGrid grid(MPI_COMM_WORLD, parse_grid(argv[1]), mapping);
+        const std::string trace_file = find_option(argc, argv, "trace", "");
+        const std::vector<size_t> previews = parse_blocks(find_option(argc, argv, "previews", ""));
+        const std::string catalog = find_option(argc, argv, "catalog", "");
+        const std::string memory = find_option(argc, argv, "memory", "");
+        trace_init(grid.comm(), trace_file);
+
+        // 确保可以整除, 并计算局部大小
+        const auto local = grid.local_extent({Lx, Ly, Lz, Lt});
+        const size_t local_lt = local[T_DIM];
+        const size_t local_lz = local[Z_DIM];
+        const size_t local_ly = local[Y_DIM];
+        const size_t local_lx = local[X_DIM];
 
         // 创建局部数组
         Array7D<std::complex<double>> local_array(local_lt, local_lz, local_ly, local_lx, Nc);
@@ -93,7 +69,7 @@ int main(int argc, char** argv) {
                         for (size_t x = 0; x < local_lx; ++x) {
                             for (size_t c1 = 0; c1 < Nc; ++c1) {
                                 for (size_t c2 = 0; c2 < Nc; ++c2) {
-                                    double temp = rank * 1000 + static_cast<double>(counter++);
+                                    double temp = grid.rank() * 1000 + static_cast<double>(counter++);
                                     counter = counter % MAX_ELEM;
                                     local_array(dim, t, z, y, x, c1, c2) = {temp, temp + 0.1};
                                 }
@@ -105,48 +81,50 @@ int main(int argc, char** argv) {
         }
 
         // HDF5并行写入
+        const std::string filename = "test_7d.hdf5";
+        const std::string dataset_name = "LatticeMatrix";
+        const IoOptions options = tool_io_options(grid, argc, argv, filename,
+            static_cast<double>(local_array.get_Ndim()) * local_lt * local_lz * local_ly * local_lx
+            * Nc * Nc * sizeof(std::complex<double>), local_lt);
+
+        // 数组准备好以后才开始内存记样, 各阶段的增量只含I/O本身
+        memory_init(memory);
         {
-            const std::string filename = "test_7d.hdf5";
-            const std::string dataset_name = "LatticeMatrix";
-
-            // 设置并行访问属性
-            H5::FileAccPropList plist;
-            plist.copy(H5::FileAccPropList::DEFAULT);
-            H5Pset_fapl_mpio(plist.getId(), MPI_COMM_WORLD, MPI_INFO_NULL);
-
-            // 创建文件
-            H5::H5File file(filename, H5F_ACC_TRUNC, H5::FileCreatPropList::DEFAULT, plist);
-
-            // 创建全局数据空间
-            std::vector<hsize_t> dims = {
-                local_array.get_Ndim(), Lt, Lz, Ly, Lx, Nc, Nc * 2
-            };
-            H5::DataSpace filespace(dims.size(), dims.data());
-
-            // 创建数据集
-            H5::DataSet dataset = file.createDataSet(dataset_name, 
-                H5::PredType::NATIVE_DOUBLE, filespace);
-
-            // 设置局部数据空间
-            std::vector<hsize_t> local_dims = {
-                local_array.get_Ndim(), local_lt, local_lz, local_ly, local_lx, Nc, Nc * 2
-            };
-            std::vector<hsize_t> offset = {
-                0, offset_t, offset_z, offset_y, offset_x, 0, 0
-            };
-            
-            H5::DataSpace memspace(local_dims.size(), local_dims.data());
-            filespace.selectHyperslab(H5S_SELECT_SET, local_dims.data(), offset.data());
-
-            // 设置集体写入属性
-            H5::DSetMemXferPropList xfer_plist;
-            xfer_plist.copy(H5::DSetMemXferPropList::DEFAULT);
-            H5Pset_dxpl_mpio(xfer_plist.getId(), H5FD_MPIO_COLLECTIVE);
-
-            // 写入数据
-            dataset.write(local_array.data_ptr(), H5::PredType::NATIVE_DOUBLE, 
-                         memspace, filespace, xfer_plist);
+            TraceScope scope("barrier");
+            MPI_Barrier(grid.comm());
+        }
+        const double start = MPI_Wtime();
+        write7d(grid, filename, dataset_name, local_array, options);
+        const double elapsed = MPI_Wtime() - start;
+
+        // 可选的块平均预览, 写在同一文件中
+        const double preview_start = MPI_Wtime();
+        write_previews(grid, filename, dataset_name, local_array, previews, options);
+        double preview_elapsed = MPI_Wtime() - preview_start;
+        MPI_Allreduce(MPI_IN_PLACE, &preview_elapsed, 1, MPI_DOUBLE, MPI_MAX, grid.comm());
+
+        // 可选的目录登记: 尺寸、校验和和数据偏移追加到目录文件
+        CatalogRecord record;
+        const double catalog_start = MPI_Wtime();
+        if (!catalog.empty()) record = catalog_config(grid, catalog, filename, dataset_name, local_array);
+        const double catalog_elapsed = MPI_Wtime() - catalog_start;
+
+        double max_elapsed;
+        MPI_Reduce(&elapsed, &max_elapsed, 1, MPI_DOUBLE, MPI_MAX, 0, grid.comm());
+        if (grid.rank() == 0) {
+            const double mbytes = static_cast<double>(Lt * Lz * Ly * Lx) * local_array.get_Ndim()
+                                * Nc * Nc * sizeof(std::complex<double>) / (1024.0 * 1024.0);
+            std::cout << "映射方式 " << mapping_name(grid.mapping()) << ": 写入 "
+                      << mbytes << " MB, 用时 " << max_elapsed << " s, 带宽 "
+                      << mbytes / max_elapsed << " MB/s\n";
+            if (!previews.empty()) std::cout << "预览: 用时 " << preview_elapsed << " s\n";
+            if (!catalog.empty()) {
+                std::cout << "目录: 登记到 " << catalog << ", 数据偏移 " << record.data_offset << ", 用时 "
+                          << catalog_elapsed << " s\n";
+            }
         }
+        memory_finish(grid.comm(), memory);
+        trace_finish(grid.comm(), trace_file);
 
         MPI_Finalize();
         return 0;
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <mpi.h>
+#include <array>
+#include <complex>
+#include <string>
+#include <stdexcept>
+#include <vector>
+
+#include "grid.h"
+#include "lattice_io.h"
+#include "public.h"
+
+// 填充格子场 (Array7D、旋量、传播子等) 四周ghost区的非阻塞面交换
+// 每个方向的正反两个面各用一个MPI子数组类型描述, 直接在存储上收发, 不做打包
+// 只交换面, 不填充棱和角 (ghost区中多个方向同时越界的格点)
+template <typename T, size_t InnerRank = 2>
+class HaloExchange {
+private:
+    const ProcessGrid& grid_;
+    LatticeField<T, InnerRank>& array_;
+    MPI_Datatype elem_type_ = MPI_DATATYPE_NULL;
+    // [方向][0: 低侧, 1: 高侧]
+    std::array<std::array<MPI_Datatype, 2>, Nd> send_type_;
+    std::array<std::array<MPI_Datatype, 2>, Nd> recv_type_;
+    std::vector<MPI_Request> requests_;
+
+    // 在含ghost区的存储上描述一个厚度为ghost[d]的面, 内部维度合并为一维
+    MPI_Datatype face_type(int d, size_t start_d) const {
+        const int outer = static_cast<int>(array_.get_outer());
+        const int inner = static_cast<int>(array_.get_inner_volume());
+        std::array<size_t, Nd> padded = {
+            array_.get_padded_Lx(), array_.get_padded_Ly(), array_.get_padded_Lz(), array_.get_padded_Lt()
+        };
+        std::array<size_t, Nd> extent = {
+            array_.get_Lx(), array_.get_Ly(), array_.get_Lz(), array_.get_Lt()
+        };
+        std::array<size_t, Nd> start;
+        for (int k = 0; k < Nd; ++k) start[k] = array_.get_ghost(k);
+        extent[d] = array_.get_ghost(d);
+        start[d] = start_d;
+
+        // 存储顺序 [outer, t, z, y, x, inner...]
+        const int sizes[6] = {
+            outer, static_cast<int>(padded[T_DIM]), static_cast<int>(padded[Z_DIM]),
+            static_cast<int>(padded[Y_DIM]), static_cast<int>(padded[X_DIM]), inner
+        };
+        const int subsizes[6] = {
+            outer, static_cast<int>(extent[T_DIM]), static_cast<int>(extent[Z_DIM]),
+            static_cast<int>(extent[Y_DIM]), static_cast<int>(extent[X_DIM]), inner
+        };
+        const int starts[6] = {
+            0, static_cast<int>(start[T_DIM]), static_cast<int>(start[Z_DIM]),
+            static_cast<int>(start[Y_DIM]), static_cast<int>(start[X_DIM]), 0
+        };
+
+        MPI_Datatype type;
+        MPI_Type_create_subarray(6, sizes, subsizes, starts, MPI_ORDER_C, elem_type_, &type);
+        MPI_Type_commit(&type);
+        return type;
+    }
+
+public:
+    HaloExchange(const ProcessGrid& grid, LatticeField<T, InnerRank>& array) : grid_(grid), array_(array) {
+        MPI_Type_contiguous(static_cast<int>(sizeof(T)), MPI_BYTE, &elem_type_);
+        MPI_Type_commit(&elem_type_);
+
+        const std::array<size_t, Nd> extent = {
+            array_.get_Lx(), array_.get_Ly(), array_.get_Lz(), array_.get_Lt()
+        };
+        for (int d = 0; d < Nd; ++d) {
+            const size_t g = array_.get_ghost(d);
+            if (g > extent[d]) {
+                throw std::runtime_error("ghost宽度不能超过本地格子尺寸");
+            }
+            if (g == 0) {
+                send_type_[d] = recv_type_[d] = {MPI_DATATYPE_NULL, MPI_DATATYPE_NULL};
+                continue;
+            }
+            // 低侧内部面发给反方向邻居, 高侧内部面发给正方向邻居
+            send_type_[d][0] = face_type(d, g);
+            send_type_[d][1] = face_type(d, extent[d]);
+            recv_type_[d][0] = face_type(d, 0);
+            recv_type_[d][1] = face_type(d, g + extent[d]);
+        }
+    }
+
+    ~HaloExchange() {
+        for (int d = 0; d < Nd; ++d) {
+            for (int side = 0; side < 2; ++side) {
+                if (send_type_[d][side] != MPI_DATATYPE_NULL) MPI_Type_free(&send_type_[d][side]);
+                if (recv_type_[d][side] != MPI_DATATYPE_NULL) MPI_Type_free(&recv_type_[d][side]);
+            }
+        }
+        MPI_Type_free(&elem_type_);
+    }
+
+    HaloExchange(const HaloExchange&) = delete;
+    HaloExchange& operator=(const HaloExchange&) = delete;
+
+    // 发起所有方向的面交换, 之后可以在内部区域上做其他工作;
+    // 发送直接引用数组存储, wait()返回之前不能修改各方向ghost宽度内的边界层, 只能读
+    void start() {
+        void* base = array_.data_ptr();
+        for (int d = 0; d < Nd; ++d) {
+            if (array_.get_ghost(d) == 0) continue;
+            const int forward = grid_.neighbor(d, 1);
+            const int backward = grid_.neighbor(d, -1);
+            // tag区分方向和侧, 邻居相同(进程数为1或2)时也不会混淆
+            requests_.resize(requests_.size() + 4);
+            MPI_Request* req = &requests_[requests_.size() - 4];
+            MPI_Irecv(base, 1, recv_type_[d][0], backward, 2 * d, grid_.comm(), &req[0]);
+            MPI_Irecv(base, 1, recv_type_[d][1], forward, 2 * d + 1, grid_.comm(), &req[1]);
+            MPI_Isend(base, 1, send_type_[d][1], forward, 2 * d, grid_.comm(), &req[2]);
+            MPI_Isend(base, 1, send_type_[d][0], backward, 2 * d + 1, grid_.comm(), &req[3]);
+        }
+    }
+
+    // 等待所有面交换完成
+    void wait() {
+        MPI_Waitall(static_cast<int>(requests_.size()), requests_.data(), MPI_STATUSES_IGNORE);
+        requests_.clear();
+    }
+
+    void exchange() {
+        start();
+        wait();
+    }
+};
+
+// 读取配置并填充ghost区, 返回后即可直接计算
+// post_process(local_array, t, z, y, x) 逐格点处理读入的内部区域 (该格点上的所有链接), ghost区收到的是处理后的值
+// 面交换直接从数组存储发送 (子数组类型, 不打包), 发送未完成时边界层不能修改, 所以分两步:
+// 先处理各方向ghost宽度内的边界层, 再发起面交换, 交换进行期间处理更深的内部格点
+template <typename PostProcess>
+inline Array7D<std::complex<double>> load7d(const ProcessGrid& grid, const std::string& filename,
+                                            const std::string& dataset_name,
+                                            const std::array<size_t, Nd>& ghost,
+                                            PostProcess&& post_process) {
+    Array7D<std::complex<double>> local_array = read7d(grid, filename, dataset_name, ghost);
+    const std::array<size_t, Nd> extent = {
+        local_array.get_Lx(), local_array.get_Ly(), local_array.get_Lz(), local_array.get_Lt()
+    };
+    // boundary为true时只处理边界层, 否则只处理其余的内部格点
+    auto process = [&](bool boundary) {
+        std::array<size_t, Nd> c;
+        for (c[T_DIM] = 0; c[T_DIM] < extent[T_DIM]; ++c[T_DIM])
+            for (c[Z_DIM] = 0; c[Z_DIM] < extent[Z_DIM]; ++c[Z_DIM])
+                for (c[Y_DIM] = 0; c[Y_DIM] < extent[Y_DIM]; ++c[Y_DIM])
+                    for (c[X_DIM] = 0; c[X_DIM] < extent[X_DIM]; ++c[X_DIM]) {
+                        bool edge = false;
+                        for (int d = 0; d < Nd; ++d) {
+                            edge = edge || c[d] < ghost[d] || c[d] + ghost[d] >= extent[d];
+                        }
+                        if (edge == boundary) post_process(local_array, c[T_DIM], c[Z_DIM], c[Y_DIM], c[X_DIM]);
+                    }
+    };
+
+    process(true);
+    HaloExchange<std::complex<double>> halo(grid, local_array);
+    halo.start();
+    process(false);
+    halo.wait();
+    return local_array;
+}
+
+inline Array7D<std::complex<double>> load7d(const ProcessGrid& grid, const std::string& filename,
+                                            const std::string& dataset_name,
+                                            const std::array<size_t, Nd>& ghost) {
+    Array7D<std::complex<double>> local_array = read7d(grid, filename, dataset_name, ghost);
+    HaloExchange<std::complex<double>> halo(grid, local_array);
+    halo.exchange();
+    return local_array;
+}
+
+// 解析 "gx.gy.gz.gt" 或单个数字形式的ghost宽度
+inline std::array<size_t, Nd> parse_ghost(const std::string& text) {
+    if (text.find('.') == std::string::npos) {
+        const size_t g = std::stoul(text);
+        return {g, g, g, g};
+    }
+    const auto g = parse_grid(text);
+    return {static_cast<size_t>(g[X_DIM]), static_cast<size_t>(g[Y_DIM]),
+            static_cast<size_t>(g[Z_DIM]), static_cast<size_t>(g[T_DIM])};
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <mpi.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "grid.h"
+#include "lattice_io.h"
+
+// 混合MPI+线程的运行方式: 每个NUMA域一个进程, 进程内多个线程
+//   数据准备 (初始化、打包、转换、校验和) 由OpenMP线程完成, 见lattice_io.h/transforms.h/catalog.h中的并行循环
+//   HDF5和MPI-IO的集体读写交给一个专门的I/O线程 (IoThread), 按提交顺序逐个执行,
+//   计算线程同时准备下一份数据; 各进程按相同顺序提交, 集体调用就不会因取锁顺序不同而互相等待
+// 每节点进程数减少后访问文件系统的MPI-IO客户端随之减少, 节点内的数据准备由线程补上
+
+// 按需要的线程级别初始化MPI, 返回实际得到的级别; 调用方据此选择异步或同步路径
+inline int init_mpi_threads(int* argc, char*** argv, int required = MPI_THREAD_MULTIPLE) {
+    int provided = MPI_THREAD_SINGLE;
+    MPI_Init_thread(argc, argv, required, &provided);
+    return provided;
+}
+
+inline int parse_thread_level(const std::string& name) {
+    if (name == "single") return MPI_THREAD_SINGLE;
+    if (name == "funneled") return MPI_THREAD_FUNNELED;
+    if (name == "serialized") return MPI_THREAD_SERIALIZED;
+    if (name == "multiple") return MPI_THREAD_MULTIPLE;
+    throw std::runtime_error("未知的线程级别: " + name);
+}
+
+inline const char* thread_level_name(int level) {
+    switch (level) {
+        case MPI_THREAD_SINGLE: return "single";
+        case MPI_THREAD_FUNNELED: return "funneled";
+        case MPI_THREAD_SERIALIZED: return "serialized";
+        case MPI_THREAD_MULTIPLE: return "multiple";
+    }
+    return "unknown";
+}
+
+// 本进程的计算线程数 (OMP_NUM_THREADS), 未以-fopenmp编译时为1
+inline int compute_threads() {
+#ifdef _OPENMP
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
+
+// 专门的通信/I/O线程: submit()的任务按提交顺序在后台线程中执行, 返回的future在任务完成时就绪,
+// 任务中的异常由future.get()重新抛出
+// 后台线程与主线程可能同时调用MPI, 需要MPI_THREAD_MULTIPLE, 否则submit()直接在调用线程中同步执行
+// 任务应在io_grid()上做集体调用: 异步时它是与原网格坐标相同的独立通信子, 与主线程的通信互不干扰;
+// 有任务未完成时主线程不能做集体的HDF5调用
+class IoThread {
+private:
+    const ProcessGrid& grid_;
+    std::unique_ptr<ProcessGrid> io_grid_;
+    bool async_ = false;
+
+    std::thread worker_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::packaged_task<void()>> queue_;
+    bool stop_ = false;
+
+    void worker_loop() {
+        for (;;) {
+            std::packaged_task<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [&] { return stop_ || !queue_.empty(); });
+                if (queue_.empty()) return;
+                task = std::move(queue_.front());
+                queue_.pop_front();
+            }
+            task();
+        }
+    }
+
+public:
+    explicit IoThread(const ProcessGrid& grid) : grid_(grid) {
+        int provided;
+        MPI_Query_thread(&provided);
+        async_ = provided >= MPI_THREAD_MULTIPLE;
+        if (async_) {
+            // 以原通信子为父通信子、不重排地建立网格, 得到rank和坐标都相同的复制品
+            io_grid_.reset(new ProcessGrid(grid_.comm(),
+                {grid_.dim(X_DIM), grid_.dim(Y_DIM), grid_.dim(Z_DIM), grid_.dim(T_DIM)},
+                GridMapping::Plain));
+            worker_ = std::thread(&IoThread::worker_loop, this);
+        }
+    }
+
+    // 执行完已提交的任务再退出
+    ~IoThread() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+            cv_.notify_all();
+        }
+        if (worker_.joinable()) worker_.join();
+    }
+
+    IoThread(const IoThread&) = delete;
+    IoThread& operator=(const IoThread&) = delete;
+
+    std::future<void> submit(std::function<void()> job) {
+        std::packaged_task<void()> task(std::move(job));
+        std::future<void> done = task.get_future();
+        if (!async_) {
+            task();
+            return done;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.push_back(std::move(task));
+        cv_.notify_all();
+        return done;
+    }
+
+    const ProcessGrid& io_grid() const { return async_ ? *io_grid_ : grid_; }
+    bool asynchronous() const { return async_; }
+};
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <sys/stat.h>
+#include <sys/statfs.h>
+#include <cmath>
+#include <cstdlib>
+#include <numeric>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <stdexcept>
+#include <vector>
+
+#include "grid.h"
+#include "lattice_io.h"
+
+// 按机器保存的I/O参数配置文件, 每行一条:
+//   <文件系统类型> <进程数> <本地数据量等级> key=value ... [# 注释]
+// 本地数据量等级为 floor(log2(每进程MiB数)), 相近大小的数据共用一组参数
+// 由autotune7d写入, write7d/read7d启动时自动按键查找并套用
+
+// 文件所在目录的文件系统类型
+inline std::string filesystem_type(const std::string& path) {
+    std::string dir = path;
+    const size_t slash = dir.find_last_of('/');
+    dir = slash == std::string::npos ? "." : (slash == 0 ? "/" : dir.substr(0, slash));
+
+    struct statfs info;
+    if (statfs(dir.c_str(), &info) != 0) return "unknown";
+    switch (static_cast<unsigned long>(info.f_type)) {
+        case 0x0BD00BD0: return "lustre";
+        case 0x47504653: return "gpfs";
+        case 0x19830326: return "beegfs";
+        case 0x6969:     return "nfs";
+        case 0x58465342: return "xfs";
+        case 0xEF53:     return "ext4";
+        case 0x01021994: return "tmpfs";
+        case 0x9123683E: return "btrfs";
+        case 0x794C7630: return "overlay";
+        default: {
+            std::ostringstream name;
+            name << "0x" << std::hex << static_cast<unsigned long>(info.f_type);
+            return name.str();
+        }
+    }
+}
+
+struct IoProfileKey {
+    std::string fstype;
+    int ranks;
+    int volume_class;
+
+    std::string str() const {
+        return fstype + " " + std::to_string(ranks) + " " + std::to_string(volume_class);
+    }
+};
+
+// 集体调用: 由rank 0判断文件系统类型, 保证各进程得到相同的键
+inline IoProfileKey io_profile_key(const ProcessGrid& grid, const std::string& data_file, double local_bytes) {
+    char fstype[32] = {0};
+    if (grid.rank() == 0) {
+        filesystem_type(data_file).copy(fstype, sizeof(fstype) - 1);
+    }
+    MPI_Bcast(fstype, sizeof(fstype), MPI_CHAR, 0, grid.comm());
+
+    IoProfileKey key;
+    key.fstype = fstype;
+    key.ranks = grid.size();
+    key.volume_class = local_bytes >= 1024.0 * 1024.0
+        ? static_cast<int>(std::floor(std::log2(local_bytes / (1024.0 * 1024.0)))) : -1;
+    return key;
+}
+
+// 环境变量LATTICE_IO_PROFILE, 否则为 ~/.lattice_io_profile
+inline std::string default_profile_path() {
+    if (const char* path = std::getenv("LATTICE_IO_PROFILE")) return path;
+    if (const char* home = std::getenv("HOME")) return std::string(home) + "/.lattice_io_profile";
+    return ".lattice_io_profile";
+}
+
+inline std::string format_io_options(const IoOptions& options) {
+    std::ostringstream out;
+    out << "max_transfer=" << options.max_transfer_bytes << " cb_nodes=" << options.cb_nodes
+        << " cb_buffer_size=" << options.cb_buffer_size << " alignment=" << options.alignment
+        << " chunk_t=" << options.chunk_t << " collective=" << (options.collective ? 1 : 0);
+    return out.str();
+}
+
+inline void parse_io_option(const std::string& item, IoOptions& options) {
+    const size_t eq = item.find('=');
+    if (eq == std::string::npos) throw std::runtime_error("无法解析的I/O参数: " + item);
+    const std::string name = item.substr(0, eq);
+    const std::string value = item.substr(eq + 1);
+    if (name == "max_transfer")        options.max_transfer_bytes = parse_bytes(value);
+    else if (name == "cb_nodes")       options.cb_nodes = std::stoi(value);
+    else if (name == "cb_buffer_size") options.cb_buffer_size = parse_bytes(value);
+    else if (name == "alignment")      options.alignment = parse_bytes(value);
+    else if (name == "chunk_t")        options.chunk_t = std::stoul(value);
+    else if (name == "collective")     options.collective = value != "0";
+    else throw std::runtime_error("未知的I/O参数: " + name);
+}
+
+// 集体调用: 查找与key匹配的条目并套用到options, 找不到时options不变
+inline bool load_io_profile(const ProcessGrid& grid, const std::string& path,
+                            const IoProfileKey& key, IoOptions& options) {
+    std::string entry;
+    if (grid.rank() == 0) {
+        std::ifstream in(path);
+        std::string line;
+        while (std::getline(in, line)) {
+            const std::string body = line.substr(0, line.find('#'));
+            std::istringstream fields(body);
+            IoProfileKey k;
+            if (!(fields >> k.fstype >> k.ranks >> k.volume_class)) continue;
+            if (k.str() == key.str()) std::getline(fields, entry);
+        }
+    }
+    int length = static_cast<int>(entry.size());
+    MPI_Bcast(&length, 1, MPI_INT, 0, grid.comm());
+    entry.resize(length);
+    MPI_Bcast(&entry[0], length, MPI_CHAR, 0, grid.comm());
+    if (length == 0) return false;
+
+    std::istringstream items(entry);
+    std::string item;
+    while (items >> item) parse_io_option(item, options);
+    return true;
+}
+
+// 由rank 0把key对应的条目替换为新的参数, 其他条目保留
+inline void save_io_profile(const ProcessGrid& grid, const std::string& path, const IoProfileKey& key,
+                            const IoOptions& options, const std::string& comment = "") {
+    if (grid.rank() != 0) return;
+    std::vector<std::string> lines;
+    {
+        std::ifstream in(path);
+        std::string line;
+        while (std::getline(in, line)) {
+            std::istringstream fields(line);
+            IoProfileKey k;
+            if (fields >> k.fstype >> k.ranks >> k.volume_class && k.str() == key.str()) continue;
+            lines.push_back(line);
+        }
+    }
+    lines.push_back(key.str() + " " + format_io_options(options) + (comment.empty() ? "" : " # " + comment));
+
+    std::ofstream out(path);
+    for (const std::string& line : lines) out << line << "\n";
+    if (!out) throw std::runtime_error("无法写I/O配置文件: " + path);
+}
+
+// 工具程序的I/O参数: 先按键套用配置文件 (--profile=路径, none表示不用), 再套用命令行的--max-transfer
+// local_bytes小于0时按已有数据文件的大小平均到各进程估计
+// 配置中的chunk_t只是调优建议: 给出local_lt (写入时本地t方向大小) 时取gcd(chunk_t, local_lt),
+// 同一数据量等级下本地Lt不能被整除的作业退回到能整除的chunk, 而不是在写入时报错
+inline IoOptions tool_io_options(const ProcessGrid& grid, int argc, char** argv,
+                                 const std::string& data_file, double local_bytes = -1, size_t local_lt = 0) {
+    IoOptions options;
+    const std::string profile = find_option(argc, argv, "profile", default_profile_path());
+    if (profile != "none") {
+        if (local_bytes < 0) {
+            double file_bytes = 0;
+            struct stat info;
+            if (grid.rank() == 0 && stat(data_file.c_str(), &info) == 0) file_bytes = info.st_size;
+            MPI_Bcast(&file_bytes, 1, MPI_DOUBLE, 0, grid.comm());
+            local_bytes = file_bytes / grid.size();
+        }
+        const IoProfileKey key = io_profile_key(grid, data_file, local_bytes);
+        if (load_io_profile(grid, profile, key, options) && grid.rank() == 0) {
+            std::cout << "使用I/O配置 [" << key.str() << "]: " << format_io_options(options) << "\n";
+        }
+        if (local_lt > 0 && options.chunk_t > 0 && local_lt % options.chunk_t != 0) {
+            const size_t chunk_t = std::gcd(options.chunk_t, local_lt);
+            if (grid.rank() == 0) {
+                std::cout << "配置的chunk_t=" << options.chunk_t << " 不能整除本地t方向大小 " << local_lt
+                          << ", 改用 " << chunk_t << "\n";
+            }
+            options.chunk_t = chunk_t;
+        }
+    }
+    const std::string max_transfer = find_option(argc, argv, "max-transfer", "");
+    if (!max_transfer.empty()) options.max_transfer_bytes = parse_bytes(max_transfer);
+    return options;
+}
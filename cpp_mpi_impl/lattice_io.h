@@ -0,0 +1,525 @@
+#pragma once
+
+#include <H5Cpp.h>
+#include <algorithm>
+#include <array>
+#include <complex>
+#include <mutex>
+#include <string>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "grid.h"
+#include "public.h"
+#include "trace.h"
+#include "memory_probe.h"
+
+// 内存中一块场的跨步视图, 以double为单位, 维度顺序 [outer, t, z, y, x, inner..., 2*最内层]
+// (规范场为 [dim, t, z, y, x, c1, 2*c2]); extent为整块存储的尺寸, offset为第一个元素的位置,
+// stride为各维相邻元素的间隔, count为各维元素个数 (即写入文件的本地尺寸)
+template <size_t Rank>
+struct StridedView {
+    const double* ptr;
+    std::array<hsize_t, Rank> extent;
+    std::array<hsize_t, Rank> offset;
+    std::array<hsize_t, Rank> stride;
+    std::array<hsize_t, Rank> count;
+};
+
+using StridedView7D = StridedView<7>;
+
+// 元素为double或std::complex<double>, 复数的实部虚部在最内层维度上展开
+template <typename T>
+constexpr hsize_t doubles_per_element() {
+    static_assert(std::is_same<T, double>::value || std::is_same<T, std::complex<double>>::value,
+                  "格子场的元素必须是double或std::complex<double>");
+    return sizeof(T) / sizeof(double);
+}
+
+// 场的内部区域: 存储范围包含ghost区, 各维步长为1
+template <typename T, size_t InnerRank>
+inline StridedView<5 + InnerRank> make_view(const LatticeField<T, InnerRank>& field) {
+    StridedView<5 + InnerRank> view;
+    view.ptr = reinterpret_cast<const double*>(field.data_ptr());
+    view.extent[0] = view.count[0] = field.get_outer();
+    view.extent[1] = field.get_padded_Lt();
+    view.extent[2] = field.get_padded_Lz();
+    view.extent[3] = field.get_padded_Ly();
+    view.extent[4] = field.get_padded_Lx();
+    view.count[1] = field.get_Lt();
+    view.count[2] = field.get_Lz();
+    view.count[3] = field.get_Ly();
+    view.count[4] = field.get_Lx();
+    for (size_t k = 0; k < InnerRank; ++k) {
+        view.extent[5 + k] = view.count[5 + k] = field.get_inner(k);
+    }
+    view.extent[4 + InnerRank] *= doubles_per_element<T>();
+    view.count[4 + InnerRank] *= doubles_per_element<T>();
+    view.offset.fill(0);
+    view.offset[1] = field.get_ghost(T_DIM);
+    view.offset[2] = field.get_ghost(Z_DIM);
+    view.offset[3] = field.get_ghost(Y_DIM);
+    view.offset[4] = field.get_ghost(X_DIM);
+    view.stride.fill(1);
+    return view;
+}
+
+// 视图在内存中的数据空间: 用hyperslab直接描述, HDF5在选择上迭代, 不需要打包拷贝
+template <size_t Rank>
+inline H5::DataSpace view_memspace(const StridedView<Rank>& view) {
+    bool dense = true;
+    for (size_t i = 0; i < Rank; ++i) {
+        if (view.stride[i] == 0 || view.count[i] == 0 ||
+            view.offset[i] + (view.count[i] - 1) * view.stride[i] >= view.extent[i]) {
+            throw std::runtime_error("跨步视图超出存储范围");
+        }
+        dense = dense && view.offset[i] == 0 && view.stride[i] == 1 && view.count[i] == view.extent[i];
+    }
+
+    H5::DataSpace memspace(view.extent.size(), view.extent.data());
+    if (!dense) {
+        memspace.selectHyperslab(H5S_SELECT_SET, view.count.data(), view.offset.data(), view.stride.data());
+    }
+    return memspace;
+}
+
+// 把视图打包成连续的本地数组 [count...], 用于与hyperslab路径做对比
+// threaded为false时不开OpenMP线程, 供已经在线程池中的调用者使用
+template <size_t Rank>
+inline std::vector<double> pack_view(const StridedView<Rank>& view, bool threaded = true) {
+    constexpr int last = static_cast<int>(Rank) - 1;
+    size_t total = 1;
+    for (hsize_t c : view.count) total *= c;
+    std::vector<double> packed(total);
+    std::array<hsize_t, Rank> pitch;
+    pitch[last] = 1;
+    for (int i = last - 1; i >= 0; --i) pitch[i] = pitch[i + 1] * view.extent[i + 1];
+
+    // 各行 (最内层一维) 互不相关, 以-fopenmp编译时由多个线程分担
+    const long long rows = static_cast<long long>(total / view.count[last]);
+    #pragma omp parallel for schedule(static) if (threaded)
+    for (long long row = 0; row < rows; ++row) {
+        size_t pos = 0;
+        hsize_t rest = static_cast<hsize_t>(row);
+        for (int i = last - 1; i >= 0; --i) {
+            const hsize_t idx = rest % view.count[i];
+            rest /= view.count[i];
+            pos += (view.offset[i] + idx * view.stride[i]) * pitch[i];
+        }
+        // 最内层一维连续拷贝或按步长拷贝
+        const double* src = view.ptr + pos + view.offset[last];
+        double* dst = packed.data() + row * view.count[last];
+        for (hsize_t k = 0; k < view.count[last]; ++k) dst[k] = src[k * view.stride[last]];
+    }
+    return packed;
+}
+
+// 并行I/O的可调参数, 可以由autotune7d测出并保存在I/O配置文件中 (见io_profile.h)
+struct IoOptions {
+    // 单次集体传输的最大字节数; 本地块超过它时拆成多次传输,
+    // 避免MPI-IO层的int计数在单进程超过2 GiB时溢出或退回慢路径
+    size_t max_transfer_bytes = size_t(1) << 30;
+    // ROMIO集体缓冲的聚合进程数和缓冲区大小, 0表示使用MPI实现的默认值
+    int cb_nodes = 0;
+    size_t cb_buffer_size = 0;
+    // 大于64 KiB的对象在文件中按此对齐 (通常取条带大小), 0表示不对齐
+    size_t alignment = 0;
+    // 写入时使用分块布局, 每个chunk为本地块一个方向上的chunk_t个t切片; 0表示连续布局
+    size_t chunk_t = 0;
+    // false时使用独立I/O
+    bool collective = true;
+};
+
+// HDF5的库锁: 非线程安全构建的HDF5 (包括并行HDF5) 同一时刻只允许一个线程调用,
+// 下面以文件名为参数的读写入口, 以及其他头文件中打开文件的公开入口 (read7d_fused、write7d_direct、
+// Checkpoint、write_previews、describe_config、NodeSharedGauge、DeltaCheckpoint、暂存的转存等)
+// 都在锁内执行, 线程池中的线程可以直接调用;
+// 线程安全的构建自带全局锁, 这里不再加锁. 递归锁, 入口之间互相调用时不会自锁
+// 锁只保证进程内不出现数据竞争; 多个线程同时做集体读写时, 各进程取得锁的顺序可能不同而互相等待,
+// 集体读写应交给一个线程按固定顺序执行 (见hybrid.h的IoThread)
+inline std::recursive_mutex& hdf5_mutex() {
+    static std::recursive_mutex mutex;
+    return mutex;
+}
+
+class Hdf5Lock {
+private:
+    std::unique_lock<std::recursive_mutex> lock_;
+
+public:
+    Hdf5Lock() {
+        static const bool threadsafe = [] {
+            hbool_t value = 0;
+            return H5is_library_threadsafe(&value) >= 0 && value;
+        }();
+        if (!threadsafe) lock_ = std::unique_lock<std::recursive_mutex>(hdf5_mutex());
+    }
+};
+
+// 按IoOptions设置的MPI-IO文件访问属性
+inline H5::FileAccPropList make_fapl(MPI_Comm comm, const IoOptions& options = IoOptions()) {
+    H5::FileAccPropList plist;
+    plist.copy(H5::FileAccPropList::DEFAULT);
+    MPI_Info info = MPI_INFO_NULL;
+    if (options.cb_nodes > 0 || options.cb_buffer_size > 0) {
+        MPI_Info_create(&info);
+        if (options.cb_nodes > 0) {
+            MPI_Info_set(info, "cb_nodes", std::to_string(options.cb_nodes).c_str());
+        }
+        if (options.cb_buffer_size > 0) {
+            MPI_Info_set(info, "cb_buffer_size", std::to_string(options.cb_buffer_size).c_str());
+        }
+    }
+    H5Pset_fapl_mpio(plist.getId(), comm, info);
+    if (info != MPI_INFO_NULL) MPI_Info_free(&info);
+    if (options.alignment > 0) {
+        plist.setAlignment(64 * 1024, options.alignment);
+    }
+    return plist;
+}
+
+// 按IoOptions设置的数据传输属性
+inline H5::DSetMemXferPropList make_dxpl(const IoOptions& options = IoOptions()) {
+    H5::DSetMemXferPropList xfer_plist;
+    xfer_plist.copy(H5::DSetMemXferPropList::DEFAULT);
+    H5Pset_dxpl_mpio(xfer_plist.getId(), options.collective ? H5FD_MPIO_COLLECTIVE : H5FD_MPIO_INDEPENDENT);
+    return xfer_plist;
+}
+
+// 把本地块按最外层的维度切片, 每片不超过max_transfer_bytes, 逐片调用transfer
+// 集体传输要求所有进程调用次数相同, 片数较少的进程用空选择补齐
+template <size_t Rank, typename Transfer>
+inline void transfer_pieces(MPI_Comm comm, const StridedView<Rank>& view,
+                            const std::array<hsize_t, Rank>& file_offset,
+                            H5::DataSpace& memspace, H5::DataSpace& filespace,
+                            const IoOptions& options, Transfer&& transfer) {
+    const size_t max_elems = std::max<size_t>(1, options.max_transfer_bytes / sizeof(double));
+
+    // 找到切分维度k: k之后的维度整块放进一片, k维每片取block个
+    constexpr int last = static_cast<int>(Rank) - 1;
+    int k = 0;
+    size_t inner = 1;
+    for (int i = 1; i <= last; ++i) inner *= view.count[i];
+    while (k < last && inner > max_elems) {
+        ++k;
+        inner /= view.count[k];
+    }
+    const hsize_t block = std::max<hsize_t>(1, std::min<hsize_t>(view.count[k], max_elems / inner));
+
+    long long pieces = (view.count[k] + block - 1) / block;
+    for (int i = 0; i < k; ++i) pieces *= view.count[i];
+    long long max_pieces = pieces;
+    {
+        TraceScope scope("transfer.sync");
+        MPI_Allreduce(&pieces, &max_pieces, 1, MPI_LONG_LONG, MPI_MAX, comm);
+    }
+
+    std::array<hsize_t, Rank> idx;
+    idx.fill(0);
+    for (long long p = 0; p < max_pieces; ++p) {
+        if (p >= pieces) {
+            memspace.selectNone();
+            filespace.selectNone();
+            TraceScope scope("transfer");
+            transfer(memspace, filespace);
+            continue;
+        }
+        std::array<hsize_t, Rank> count = view.count, mem_start, file_start;
+        for (int i = 0; i < k; ++i) count[i] = 1;
+        count[k] = std::min<hsize_t>(block, view.count[k] - idx[k]);
+        for (size_t i = 0; i < Rank; ++i) {
+            mem_start[i] = view.offset[i] + idx[i] * view.stride[i];
+            file_start[i] = file_offset[i] + idx[i];
+        }
+        {
+            TraceScope scope("select");
+            memspace.selectHyperslab(H5S_SELECT_SET, count.data(), mem_start.data(), view.stride.data());
+            filespace.selectHyperslab(H5S_SELECT_SET, count.data(), file_start.data());
+        }
+        {
+            TraceScope scope("transfer");
+            transfer(memspace, filespace);
+        }
+
+        // 前进到下一片
+        idx[k] += count[k];
+        for (int i = k; i > 0 && idx[i] >= view.count[i]; --i) {
+            idx[i] = 0;
+            ++idx[i - 1];
+        }
+    }
+}
+
+// 每个进程把本地视图集体写入全局数据集 [outer, Lt, Lz, Ly, Lx, inner...]
+// (规范场为 [4, Lt, Lz, Ly, Lx, Nc, 2*Nc])
+template <size_t Rank>
+inline void write_view(const ProcessGrid& grid, const std::string& filename,
+                       const std::string& dataset_name, const StridedView<Rank>& view,
+                       const IoOptions& options = IoOptions()) {
+    static_assert(Rank >= 6, "视图至少包含outer、4个时空方向和一个内部维度");
+    Hdf5Lock hdf5_lock;
+    const size_t local_lt = view.count[1];
+    const size_t local_lz = view.count[2];
+    const size_t local_ly = view.count[3];
+    const size_t local_lx = view.count[4];
+
+    // 计算局部数组在全局数组中的偏移
+    const auto offset_local = grid.local_offset({local_lx, local_ly, local_lz, local_lt});
+
+    // 设置并行访问属性
+    TraceScope fapl_scope("fapl");
+    H5::FileAccPropList plist = make_fapl(grid.comm(), options);
+    fapl_scope.finish();
+
+    // 创建文件
+    TraceScope create_scope("file.create");
+    H5::H5File file(filename, H5F_ACC_TRUNC, H5::FileCreatPropList::DEFAULT, plist);
+    create_scope.finish();
+    double array_bytes = sizeof(double);
+    for (size_t i = 0; i < Rank; ++i) array_bytes *= view.extent[i];
+
+    // 创建全局数据空间
+    std::array<hsize_t, Rank> dims = view.count;
+    dims[1] *= grid.dim(T_DIM);
+    dims[2] *= grid.dim(Z_DIM);
+    dims[3] *= grid.dim(Y_DIM);
+    dims[4] *= grid.dim(X_DIM);
+    H5::DataSpace filespace(dims.size(), dims.data());
+
+    // 创建数据集
+    TraceScope dataset_scope("dataset.create");
+    H5::DSetCreatPropList dcpl;
+    if (options.chunk_t > 0) {
+        if (local_lt % options.chunk_t != 0) {
+            throw std::runtime_error("chunk_t必须整除本地t方向大小");
+        }
+        std::array<hsize_t, Rank> chunk = view.count;
+        chunk[0] = 1;
+        chunk[1] = options.chunk_t;
+        dcpl.setChunk(chunk.size(), chunk.data());
+        dcpl.setFillTime(H5D_FILL_TIME_NEVER);
+    }
+    H5::DataSet dataset = file.createDataSet(dataset_name,
+        H5::PredType::NATIVE_DOUBLE, filespace, dcpl);
+    dataset_scope.finish();
+
+    // 设置局部数据空间
+    std::array<hsize_t, Rank> offset;
+    offset.fill(0);
+    offset[1] = offset_local[T_DIM];
+    offset[2] = offset_local[Z_DIM];
+    offset[3] = offset_local[Y_DIM];
+    offset[4] = offset_local[X_DIM];
+
+    TraceScope select_scope("select");
+    H5::DataSpace memspace = view_memspace(view);
+    select_scope.finish();
+
+    // 设置集体写入属性
+    H5::DSetMemXferPropList xfer_plist = make_dxpl(options);
+
+    // 写入数据
+    transfer_pieces(grid.comm(), view, offset, memspace, filespace, options,
+        [&](const H5::DataSpace& mem, const H5::DataSpace& file) {
+            dataset.write(view.ptr, H5::PredType::NATIVE_DOUBLE, mem, file, xfer_plist);
+            trace_mpio(xfer_plist, options.collective);
+        });
+    MemoryProbe::instance().sample("write.transfer", file.getId(), array_bytes);
+
+    TraceScope close_scope("file.close");
+    dataset.close();
+    file.close();
+    close_scope.finish();
+    MemoryProbe::instance().sample("write.close", H5I_INVALID_HID, array_bytes);
+}
+
+inline void write7d(const ProcessGrid& grid, const std::string& filename,
+                    const std::string& dataset_name, const StridedView7D& view,
+                    const IoOptions& options = IoOptions()) {
+    write_view(grid, filename, dataset_name, view, options);
+}
+
+// 任意格子场 (旋量、传播子等) 的集体写入
+template <typename T, size_t InnerRank>
+inline void write_field(const ProcessGrid& grid, const std::string& filename,
+                        const std::string& dataset_name, const LatticeField<T, InnerRank>& field,
+                        const IoOptions& options = IoOptions()) {
+    write_view(grid, filename, dataset_name, make_view(field), options);
+}
+
+inline void write7d(const ProcessGrid& grid, const std::string& filename,
+                    const std::string& dataset_name,
+                    const Array7D<std::complex<double>>& local_array,
+                    const IoOptions& options = IoOptions()) {
+    write_field(grid, filename, dataset_name, local_array, options);
+}
+
+// 数据集的全局尺寸, 维数必须为Rank
+template <size_t Rank>
+inline std::array<hsize_t, Rank> dataset_dims(const H5::DataSet& dataset) {
+    H5::DataSpace dataspace = dataset.getSpace();
+    if (dataspace.getSimpleExtentNdims() != static_cast<int>(Rank)) {
+        throw std::runtime_error("数据集维度不是" + std::to_string(Rank) + "维");
+    }
+    std::array<hsize_t, Rank> dims;
+    dataspace.getSimpleExtentDims(dims.data(), nullptr);
+    return dims;
+}
+
+// 数据集的全局尺寸 [4, Lt, Lz, Ly, Lx, Nc, 2*Nc]
+inline std::array<hsize_t, 7> dataset_dims7d(const H5::DataSet& dataset) {
+    return dataset_dims<7>(dataset);
+}
+
+// 在comm上集体读取全局偏移为offset_local (按QcuDims下标) 的子格子, 填入field的内部区域
+// 不要求子格子属于调用进程, 节点共享缓存由节点首进程代同节点的进程读取
+template <typename T, size_t InnerRank>
+inline void read_field_at(MPI_Comm comm, const H5::DataSet& dataset, LatticeField<T, InnerRank>& field,
+                          const std::array<size_t, Nd>& offset_local,
+                          const IoOptions& options = IoOptions()) {
+    constexpr size_t Rank = 5 + InnerRank;
+    const auto dims = dataset_dims<Rank>(dataset);
+    H5::DataSpace dataspace = dataset.getSpace();
+
+    // 检查数组的outer和内部维度与数据集一致, 子格子不越界
+    const StridedView<Rank> view = make_view(field);
+    bool fits = view.count[0] == dims[0] && std::equal(dims.begin() + 5, dims.end(), view.count.begin() + 5);
+    const int dim_of_axis[Nd] = {T_DIM, Z_DIM, Y_DIM, X_DIM};
+    for (int i = 0; i < Nd; ++i) {
+        fits = fits && offset_local[dim_of_axis[i]] + view.count[1 + i] <= dims[1 + i];
+    }
+    if (!fits) {
+        throw std::runtime_error("本地数组尺寸与数据集不一致");
+    }
+
+    // 设置局部数据空间
+    std::array<hsize_t, Rank> offset;
+    offset.fill(0);
+    offset[1] = offset_local[T_DIM];
+    offset[2] = offset_local[Z_DIM];
+    offset[3] = offset_local[Y_DIM];
+    offset[4] = offset_local[X_DIM];
+
+    TraceScope select_scope("select");
+    H5::DataSpace memspace = view_memspace(view);
+    select_scope.finish();
+
+    // 设置集体读取属性
+    H5::DSetMemXferPropList xfer_plist = make_dxpl(options);
+
+    // 读取数据
+    double* buffer = reinterpret_cast<double*>(field.data_ptr());
+    transfer_pieces(comm, view, offset, memspace, dataspace, options,
+        [&](const H5::DataSpace& mem, const H5::DataSpace& file) {
+            dataset.read(buffer, H5::PredType::NATIVE_DOUBLE, mem, file, xfer_plist);
+            trace_mpio(xfer_plist, options.collective);
+        });
+}
+
+// 本进程没有要读的数据时参与一次read_field_at: 同步片数并用空选择补齐集体调用
+inline void read_nothing(MPI_Comm comm, const H5::DataSet& dataset, const IoOptions& options = IoOptions()) {
+    long long pieces = 0;
+    {
+        TraceScope scope("transfer.sync");
+        MPI_Allreduce(MPI_IN_PLACE, &pieces, 1, MPI_LONG_LONG, MPI_MAX, comm);
+    }
+    const hsize_t one = 1;
+    double dummy;
+    H5::DataSpace memspace(1, &one);
+    memspace.selectNone();
+    H5::DataSpace filespace = dataset.getSpace();
+    filespace.selectNone();
+    H5::DSetMemXferPropList xfer_plist = make_dxpl(options);
+    for (long long p = 0; p < pieces; ++p) {
+        TraceScope scope("transfer");
+        dataset.read(&dummy, H5::PredType::NATIVE_DOUBLE, memspace, filespace, xfer_plist);
+    }
+}
+
+// 把已打开的数据集中属于本进程的子格子集体读入field的内部区域
+template <typename T, size_t InnerRank>
+inline void read_field(const ProcessGrid& grid, const H5::DataSet& dataset,
+                       LatticeField<T, InnerRank>& field,
+                       const IoOptions& options = IoOptions()) {
+    const auto dims = dataset_dims<5 + InnerRank>(dataset);
+    const auto local = grid.local_extent({dims[4], dims[3], dims[2], dims[1]});
+    if (field.get_Lt() != local[T_DIM] || field.get_Lz() != local[Z_DIM] ||
+        field.get_Ly() != local[Y_DIM] || field.get_Lx() != local[X_DIM]) {
+        throw std::runtime_error("本地数组尺寸与数据集不一致");
+    }
+    read_field_at(grid.comm(), dataset, field, grid.local_offset(local), options);
+
+    if (MemoryProbe::instance().enabled()) {
+        const hid_t file = H5Iget_file_id(dataset.getId());
+        MemoryProbe::instance().sample("read.transfer", file, static_cast<double>(field.storage_size()) * sizeof(T));
+        if (file >= 0) H5Fclose(file);
+    }
+}
+
+inline void read7d(const ProcessGrid& grid, const H5::DataSet& dataset,
+                   Array7D<std::complex<double>>& local_array,
+                   const IoOptions& options = IoOptions()) {
+    read_field(grid, dataset, local_array, options);
+}
+
+inline H5::H5File open7d(const ProcessGrid& grid, const std::string& filename,
+                         const IoOptions& options = IoOptions()) {
+    // 设置并行访问属性
+    TraceScope fapl_scope("fapl");
+    H5::FileAccPropList plist = make_fapl(grid.comm(), options);
+    fapl_scope.finish();
+
+    // 打开HDF5文件
+    TraceScope scope("file.open");
+    return H5::H5File(filename, H5F_ACC_RDONLY, H5::FileCreatPropList::DEFAULT, plist);
+}
+
+// 读入已分配好的数组, 不再分配内存; 尺寸必须与文件和进程网格一致
+inline void read7d(const ProcessGrid& grid, const std::string& filename,
+                   const std::string& dataset_name, Array7D<std::complex<double>>& local_array,
+                   const IoOptions& options = IoOptions()) {
+    Hdf5Lock hdf5_lock;
+    H5::H5File file = open7d(grid, filename, options);
+    read7d(grid, file.openDataSet(dataset_name), local_array, options);
+}
+
+// 按进程网格集体读取数据集中属于本进程的子格子
+// ghost不为0时数据直接落在内部区域, ghost区留给HaloExchange填充
+inline Array7D<std::complex<double>> read7d(const ProcessGrid& grid, const std::string& filename,
+                                            const std::string& dataset_name,
+                                            const std::array<size_t, Nd>& ghost = {0, 0, 0, 0},
+                                            const IoOptions& options = IoOptions()) {
+    Hdf5Lock hdf5_lock;
+    H5::H5File file = open7d(grid, filename, options);
+    H5::DataSet dataset = file.openDataSet(dataset_name);
+
+    // 计算局部大小并创建局部数组
+    const auto dims = dataset_dims7d(dataset);
+    const auto local = grid.local_extent({dims[4], dims[3], dims[2], dims[1]});
+    Array7D<std::complex<double>> local_array(local[T_DIM], local[Z_DIM], local[Y_DIM], local[X_DIM],
+                                              dims[5], ghost);
+
+    read7d(grid, dataset, local_array, options);
+    return local_array;
+}
+
+// 按进程网格集体读取任意格子场, inner_shape为内部维度 (以元素计, 与分配LatticeField时相同),
+// 必须与数据集一致; 数据集的outer维度和格子尺寸从文件中得到
+template <typename T, size_t InnerRank>
+inline LatticeField<T, InnerRank> read_field(const ProcessGrid& grid, const std::string& filename,
+                                             const std::string& dataset_name,
+                                             const std::array<size_t, InnerRank>& inner_shape,
+                                             const std::array<size_t, Nd>& ghost = {0, 0, 0, 0},
+                                             const IoOptions& options = IoOptions()) {
+    Hdf5Lock hdf5_lock;
+    H5::H5File file = open7d(grid, filename, options);
+    H5::DataSet dataset = file.openDataSet(dataset_name);
+
+    const auto dims = dataset_dims<5 + InnerRank>(dataset);
+    const auto local = grid.local_extent({dims[4], dims[3], dims[2], dims[1]});
+    LatticeField<T, InnerRank> field(dims[0], local[T_DIM], local[Z_DIM], local[Y_DIM], local[X_DIM],
+                                     inner_shape, ghost);
+    read_field(grid, dataset, field, options);
+    return field;
+}
@@ -0,0 +1,207 @@
+#pragma once
+
+#include <H5Cpp.h>
+#include <mpi.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// 各进程I/O阶段的内存占用: 读写路径在每个阶段结束时记一次样, 汇总后报告各阶段的最大值
+// 每次记样后把内核的峰值RSS (VmHWM) 复位到当前值, 于是下一次记样的峰值就是这一阶段内的峰值,
+// H5Dwrite/H5Dread内部临时分配的集体缓冲区 (cb_buffer_size、类型转换缓冲区) 也算在所在阶段上;
+// 内核不支持复位时峰值是进程启动以来的峰值
+// 与Tracer一样插桩总是编译进来, 未调用enable()时每个采样点只多一次原子读
+struct MemorySample {
+    const char* phase;   // 必须是字符串常量
+    double rss;          // 记样时的常驻内存 (字节)
+    double peak;         // 上一次记样以来的峰值常驻内存
+    double growth;       // 峰值超出上一次记样时常驻内存的部分, 即本阶段新增 (含临时) 的内存
+    double array;        // 本阶段读写的数组的存储大小 (含ghost区)
+    double free_lists;   // HDF5空闲链表占用的内存
+    double mdc;          // 文件元数据缓存的当前大小, 没有打开的文件时为0
+};
+
+class MemoryProbe {
+private:
+    std::vector<MemorySample> samples_;
+    std::mutex mutex_;
+    std::atomic<bool> enabled_{false};
+    bool peak_reset_ = false;
+    double last_rss_ = 0;
+
+    // 从 /proc/self/status 读VmRSS和VmHWM, 单位kB
+    static void read_status(double& rss, double& peak) {
+        std::ifstream status("/proc/self/status");
+        std::string key;
+        double value;
+        rss = peak = 0;
+        while (status >> key) {
+            if (key == "VmRSS:" && status >> value) rss = value * 1024;
+            else if (key == "VmHWM:" && status >> value) peak = value * 1024;
+            status.ignore(256, '\n');
+        }
+    }
+
+    // Linux 4.0起向clear_refs写5把VmHWM复位为当前RSS
+    static bool reset_peak() {
+        std::ofstream clear("/proc/self/clear_refs");
+        clear << "5";
+        clear.flush();
+        return static_cast<bool>(clear);
+    }
+
+    static double free_list_bytes() {
+#if H5_VERSION_GE(1, 10, 7)
+        size_t reg = 0, arr = 0, blk = 0, fac = 0;
+        if (H5get_free_list_sizes(&reg, &arr, &blk, &fac) >= 0) return static_cast<double>(reg + arr + blk + fac);
+#endif
+        return 0;
+    }
+
+    static double mdc_bytes(hid_t file) {
+        if (file < 0) return 0;
+        size_t max_size = 0, min_clean = 0, cur_size = 0;
+        int entries = 0;
+        if (H5Fget_mdc_size(file, &max_size, &min_clean, &cur_size, &entries) < 0) return 0;
+        return static_cast<double>(cur_size);
+    }
+
+    static double mb(double bytes) { return bytes / (1024.0 * 1024.0); }
+
+public:
+    static MemoryProbe& instance() {
+        static MemoryProbe probe;
+        return probe;
+    }
+
+    void enable() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        samples_.clear();
+        peak_reset_ = reset_peak();
+        double peak;
+        read_status(last_rss_, peak);
+        enabled_ = true;
+    }
+
+    bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+    // file为本阶段使用的文件 (H5I_INVALID_HID表示没有), array_bytes为本阶段读写的数组大小
+    void sample(const char* phase, hid_t file = H5I_INVALID_HID, double array_bytes = 0) {
+        if (!enabled()) return;
+        MemorySample s;
+        s.phase = phase;
+        s.array = array_bytes;
+        s.free_lists = free_list_bytes();
+        s.mdc = mdc_bytes(file);
+        std::lock_guard<std::mutex> lock(mutex_);
+        read_status(s.rss, s.peak);
+        s.growth = std::max(0.0, s.peak - last_rss_);
+        last_rss_ = s.rss;
+        samples_.push_back(s);
+        if (peak_reset_) reset_peak();
+    }
+
+    // 集体调用: 各进程按相同顺序记样, 按阶段名汇总各进程、各次记样中的最大值, 由rank 0输出;
+    // csv非空时rank 0还把每个进程的每次记样写成一行
+    void report(MPI_Comm comm, const std::string& csv = "") {
+        int rank, size;
+        MPI_Comm_rank(comm, &rank);
+        MPI_Comm_size(comm, &size);
+
+        std::vector<MemorySample> local;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            local = samples_;
+        }
+        int n = static_cast<int>(local.size());
+        MPI_Allreduce(MPI_IN_PLACE, &n, 1, MPI_INT, MPI_MIN, comm);
+        constexpr int fields = 6;
+        std::vector<double> packed(static_cast<size_t>(n) * fields);
+        for (int i = 0; i < n; ++i) {
+            const MemorySample& s = local[i];
+            const double values[fields] = {s.rss, s.peak, s.growth, s.array, s.free_lists, s.mdc};
+            std::copy(values, values + fields, packed.begin() + static_cast<size_t>(i) * fields);
+        }
+        std::vector<double> all(rank == 0 ? packed.size() * size : 0);
+        MPI_Gather(packed.data(), n * fields, MPI_DOUBLE, all.data(), n * fields, MPI_DOUBLE, 0, comm);
+        if (rank != 0) return;
+        if (n != static_cast<int>(local.size())) {
+            std::fprintf(stderr, "memory: 各进程记样次数不同, 只汇总前 %d 次\n", n);
+        }
+
+        struct Summary {
+            const char* phase;
+            int samples = 0;
+            double rss = 0, peak = 0, growth = 0, array = 0, extra = 0, free_lists = 0, mdc = 0;
+            int peak_rank = 0;
+        };
+        std::vector<Summary> summary;
+        double job_peak = 0;
+        int job_peak_rank = 0;
+        for (int i = 0; i < n; ++i) {
+            auto it = std::find_if(summary.begin(), summary.end(),
+                                   [&](const Summary& s) { return std::string(s.phase) == local[i].phase; });
+            if (it == summary.end()) {
+                summary.push_back(Summary());
+                summary.back().phase = local[i].phase;
+                it = summary.end() - 1;
+            }
+            ++it->samples;
+            for (int r = 0; r < size; ++r) {
+                const double* v = &all[(static_cast<size_t>(r) * n + i) * fields];
+                it->rss = std::max(it->rss, v[0]);
+                if (v[1] > it->peak) {
+                    it->peak = v[1];
+                    it->peak_rank = r;
+                }
+                it->growth = std::max(it->growth, v[2]);
+                it->array = std::max(it->array, v[3]);
+                it->extra = std::max(it->extra, v[1] - v[3]);
+                it->free_lists = std::max(it->free_lists, v[4]);
+                it->mdc = std::max(it->mdc, v[5]);
+                if (v[1] > job_peak) {
+                    job_peak = v[1];
+                    job_peak_rank = r;
+                }
+            }
+        }
+
+        std::printf("内存 (各进程最大值, MB)%s:\n", peak_reset_ ? "" : " [峰值无法按阶段复位, 为进程启动以来的峰值]");
+        std::printf("  %-18s %5s %9s %9s %9s %9s %9s %9s %9s\n", "阶段", "次数", "RSS", "峰值", "阶段增量",
+                    "数组", "峰值-数组", "空闲链表", "元数据缓存");
+        for (const Summary& s : summary) {
+            std::printf("  %-18s %5d %9.1f %9.1f %9.1f %9.1f %9.1f %9.2f %9.2f  (峰值在rank %d)\n", s.phase,
+                        s.samples, mb(s.rss), mb(s.peak), mb(s.growth), mb(s.array), mb(s.extra), mb(s.free_lists),
+                        mb(s.mdc), s.peak_rank);
+        }
+        std::printf("  全作业峰值 %.1f MB (rank %d)\n", mb(job_peak), job_peak_rank);
+
+        if (!csv.empty()) {
+            std::ofstream out(csv);
+            out << "rank,index,phase,rss,peak,growth,array,free_lists,mdc\n";
+            for (int r = 0; r < size; ++r) {
+                for (int i = 0; i < n; ++i) {
+                    const double* v = &all[(static_cast<size_t>(r) * n + i) * fields];
+                    out << r << ',' << i << ',' << local[i].phase;
+                    for (int f = 0; f < fields; ++f) out << ',' << static_cast<long long>(v[f]);
+                    out << '\n';
+                }
+            }
+            // 只有rank 0在写, 这里抛出会让其他进程停在后面的集体调用上; 记录文件只是附带输出, 报告后继续
+            if (!out) std::fprintf(stderr, "memory: 无法写内存记录文件 %s\n", csv.c_str());
+        }
+    }
+};
+
+// 工具程序的 --memory=summary|file.csv 选项: 给出时开启记样, 结束时输出汇总, 给出文件名时还写出每个进程的记录
+inline void memory_init(const std::string& option) {
+    if (!option.empty()) MemoryProbe::instance().enable();
+}
+
+inline void memory_finish(MPI_Comm comm, const std::string& option) {
+    if (!option.empty()) MemoryProbe::instance().report(comm, option == "summary" ? "" : option);
+}
@@ -0,0 +1,225 @@
+#pragma once
+
+#include <H5Cpp.h>
+#include <mpi.h>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <complex>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <stdexcept>
+#include <vector>
+
+#include "grid.h"
+#include "public.h"
+#include "trace.h"
+
+// 长时间运行中的系综监视: 配置仍由全部进程并行写入, 另由rank 0维护一个小的索引文件,
+// 以SWMR (单写多读) 方式逐条追加每条轨迹的编号、plaquette、校验和、写入时刻和配置文件名;
+// 监视进程以SWMR读方式打开索引文件轮询新记录, 不必等写入方关闭文件, 也不会读到不一致的状态
+// MPI-IO打开的文件不能使用SWMR, 所以索引与配置分开存放
+// 每条记录只有几百字节, 追加和flush只在rank 0上进行
+// 校验和用catalog.h的global_checksum计算, 与进程网格和映射无关, 可以和目录中登记的值直接比较
+//
+// 索引文件中的数据集都是一维可扩展的, 每列一个:
+//   trajectory (int64), plaquette (double), checksum (uint64), wall_time (double, Unix时间秒),
+//   file (定长字符串), 以及标量finished (写入方结束时置1)
+// 各列分别刷新, 读方以各列长度的最小值为准
+
+struct TrajectoryRecord {
+    long long trajectory = 0;
+    double plaquette = 0;
+    uint64_t checksum = 0;
+    double wall_time = 0;
+    std::string file;
+};
+
+inline double unix_time() {
+    return std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+namespace detail {
+
+constexpr size_t kIndexFileLength = 256;
+constexpr hsize_t kIndexChunkRows = 64;
+
+inline H5::StrType index_file_type() {
+    H5::StrType type(H5::PredType::C_S1, kIndexFileLength);
+    type.setStrpad(H5T_STR_NULLTERM);
+    return type;
+}
+
+}  // namespace detail
+
+// 写入方: 集体构造, 只有rank 0打开文件; append()在各进程上都可以调用, 非rank 0时什么都不做
+class EnsembleIndex {
+private:
+    bool writer_;
+    std::unique_ptr<H5::H5File> file_;
+    H5::DataSet trajectory_, plaquette_, checksum_, wall_time_, file_name_, finished_;
+    hsize_t rows_ = 0;
+    bool closed_ = false;
+
+    H5::DataSet create_column(const char* name, const H5::DataType& type) {
+        const hsize_t dims = 0, max_dims = H5S_UNLIMITED;
+        H5::DataSpace space(1, &dims, &max_dims);
+        H5::DSetCreatPropList dcpl;
+        dcpl.setChunk(1, &detail::kIndexChunkRows);
+        return file_->createDataSet(name, type, space, dcpl);
+    }
+
+    void append_value(H5::DataSet& dataset, const H5::DataType& type, const void* value) {
+        const hsize_t size = rows_ + 1, one = 1;
+        dataset.extend(&size);
+        H5::DataSpace filespace = dataset.getSpace();
+        filespace.selectHyperslab(H5S_SELECT_SET, &one, &rows_);
+        H5::DataSpace memspace(1, &one);
+        dataset.write(value, type, memspace, filespace);
+        if (H5Dflush(dataset.getId()) < 0) throw std::runtime_error("索引数据集flush失败");
+    }
+
+public:
+    EnsembleIndex(const ProcessGrid& grid, const std::string& filename) : writer_(grid.rank() == 0) {
+        int failed = 0;
+        std::string error;
+        if (writer_) {
+            try {
+                // SWMR要求最新的文件格式
+                H5::FileAccPropList fapl;
+                fapl.setLibverBounds(H5F_LIBVER_LATEST, H5F_LIBVER_LATEST);
+                file_.reset(new H5::H5File(filename, H5F_ACC_TRUNC, H5::FileCreatPropList::DEFAULT, fapl));
+                trajectory_ = create_column("trajectory", H5::PredType::NATIVE_INT64);
+                plaquette_ = create_column("plaquette", H5::PredType::NATIVE_DOUBLE);
+                checksum_ = create_column("checksum", H5::PredType::NATIVE_UINT64);
+                wall_time_ = create_column("wall_time", H5::PredType::NATIVE_DOUBLE);
+                file_name_ = create_column("file", detail::index_file_type());
+                const int zero = 0;
+                finished_ = file_->createDataSet("finished", H5::PredType::NATIVE_INT, H5::DataSpace());
+                finished_.write(&zero, H5::PredType::NATIVE_INT);
+                // 所有对象都已创建, 之后只追加数据
+                if (H5Fstart_swmr_write(file_->getId()) < 0) throw std::runtime_error("无法进入SWMR写模式");
+            } catch (const H5::Exception& e) {
+                failed = 1;
+                error = e.getCDetailMsg();
+            } catch (const std::exception& e) {
+                failed = 1;
+                error = e.what();
+            }
+        }
+        MPI_Bcast(&failed, 1, MPI_INT, 0, grid.comm());
+        if (failed) throw std::runtime_error(writer_ ? "无法创建索引文件 " + filename + ": " + error
+                                                     : "rank 0无法创建索引文件");
+    }
+
+    EnsembleIndex(const EnsembleIndex&) = delete;
+    EnsembleIndex& operator=(const EnsembleIndex&) = delete;
+
+    ~EnsembleIndex() {
+        try {
+            finish();
+        } catch (...) {
+        }
+    }
+
+    // 追加一条记录; 值列先写, trajectory列最后写
+    void append(const TrajectoryRecord& record) {
+        if (!writer_ || closed_) return;
+        TraceScope scope("index.append");
+        char name[detail::kIndexFileLength] = {0};
+        std::strncpy(name, record.file.c_str(), sizeof(name) - 1);
+        const int64_t trajectory = record.trajectory;
+        append_value(plaquette_, H5::PredType::NATIVE_DOUBLE, &record.plaquette);
+        append_value(checksum_, H5::PredType::NATIVE_UINT64, &record.checksum);
+        append_value(wall_time_, H5::PredType::NATIVE_DOUBLE, &record.wall_time);
+        append_value(file_name_, detail::index_file_type(), name);
+        append_value(trajectory_, H5::PredType::NATIVE_INT64, &trajectory);
+        ++rows_;
+    }
+
+    // 标记结束并关闭文件, 读方看到finished后读完剩余记录即可退出
+    void finish() {
+        if (!writer_ || closed_) return;
+        closed_ = true;
+        const int one = 1;
+        finished_.write(&one, H5::PredType::NATIVE_INT);
+        H5Dflush(finished_.getId());
+        file_->close();
+    }
+
+    hsize_t rows() const { return rows_; }
+};
+
+// 读方 (单进程): 以SWMR读方式打开, poll()返回上次以来新追加的记录
+class EnsembleIndexReader {
+private:
+    H5::H5File file_;
+    H5::DataSet trajectory_, plaquette_, checksum_, wall_time_, file_name_, finished_;
+    hsize_t rows_ = 0;
+
+    static hsize_t extent(const H5::DataSet& dataset) {
+        if (H5Drefresh(dataset.getId()) < 0) throw std::runtime_error("索引数据集刷新失败");
+        hsize_t n = 0;
+        dataset.getSpace().getSimpleExtentDims(&n);
+        return n;
+    }
+
+    static void read_rows(const H5::DataSet& dataset, const H5::DataType& type, hsize_t first, hsize_t count,
+                          void* out) {
+        H5::DataSpace filespace = dataset.getSpace();
+        filespace.selectHyperslab(H5S_SELECT_SET, &count, &first);
+        H5::DataSpace memspace(1, &count);
+        dataset.read(out, type, memspace, filespace);
+    }
+
+public:
+    explicit EnsembleIndexReader(const std::string& filename)
+        : file_(filename, H5F_ACC_RDONLY | H5F_ACC_SWMR_READ) {
+        trajectory_ = file_.openDataSet("trajectory");
+        plaquette_ = file_.openDataSet("plaquette");
+        checksum_ = file_.openDataSet("checksum");
+        wall_time_ = file_.openDataSet("wall_time");
+        file_name_ = file_.openDataSet("file");
+        finished_ = file_.openDataSet("finished");
+    }
+
+    std::vector<TrajectoryRecord> poll() {
+        hsize_t available = extent(trajectory_);
+        for (const H5::DataSet* d : {&plaquette_, &checksum_, &wall_time_, &file_name_}) {
+            available = std::min(available, extent(*d));
+        }
+        std::vector<TrajectoryRecord> records;
+        if (available <= rows_) return records;
+        const hsize_t count = available - rows_;
+        std::vector<int64_t> trajectory(count);
+        std::vector<double> plaquette(count), wall_time(count);
+        std::vector<uint64_t> checksum(count);
+        std::vector<char> names(count * detail::kIndexFileLength);
+        read_rows(trajectory_, H5::PredType::NATIVE_INT64, rows_, count, trajectory.data());
+        read_rows(plaquette_, H5::PredType::NATIVE_DOUBLE, rows_, count, plaquette.data());
+        read_rows(checksum_, H5::PredType::NATIVE_UINT64, rows_, count, checksum.data());
+        read_rows(wall_time_, H5::PredType::NATIVE_DOUBLE, rows_, count, wall_time.data());
+        read_rows(file_name_, detail::index_file_type(), rows_, count, names.data());
+        for (hsize_t i = 0; i < count; ++i) {
+            TrajectoryRecord r;
+            r.trajectory = trajectory[i];
+            r.plaquette = plaquette[i];
+            r.checksum = checksum[i];
+            r.wall_time = wall_time[i];
+            const char* name = names.data() + i * detail::kIndexFileLength;
+            r.file.assign(name, strnlen(name, detail::kIndexFileLength));
+            records.push_back(r);
+        }
+        rows_ = available;
+        return records;
+    }
+
+    bool finished() {
+        if (H5Drefresh(finished_.getId()) < 0) throw std::runtime_error("索引数据集刷新失败");
+        int value = 0;
+        finished_.read(&value, H5::PredType::NATIVE_INT);
+        return value != 0;
+    }
+};
@@ -0,0 +1,286 @@
+#pragma once
+
+#include <H5Cpp.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <array>
+#include <complex>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <stdexcept>
+#include <vector>
+
+#include "grid.h"
+#include "lattice_io.h"
+#include "public.h"
+#include "trace.h"
+
+// 节点内共享的只读规范场
+// 每个节点只有首进程读取: 同节点所有进程的子格子依次放进一块MPI_Win_allocate_shared窗口,
+// 其他进程得到指向窗口中自己那一段的Array7D视图, 不复制数据; 每节点的内存和文件系统读取量
+// 都按每节点进程数成倍减少
+//
+// cache_dir非空时首进程还把窗口内容存到节点本地的缓存文件 (如/dev/shm), 以后读同一个配置的
+// 作业 (相同的源文件、数据集、进程网格和节点内的进程坐标) 直接从缓存装入; 缓存以源文件路径、
+// 大小和修改时间为键, 文件头里另存内容按8字节字计算的校验和, 装入时校验, 不一致时重新从源文件读取
+// (文件头标记LATCACH2; 旧版逐字节校验的LATCACHE缓存不再识别, 会被重新写出)
+class NodeSharedGauge {
+private:
+    using Complex = std::complex<double>;
+
+    struct CacheHeader {
+        char magic[8];
+        uint64_t key;
+        uint64_t dims[7];
+        uint64_t bytes;
+        uint64_t checksum;
+    };
+
+    MPI_Comm node_comm_ = MPI_COMM_NULL;
+    MPI_Comm leader_comm_ = MPI_COMM_NULL;  // 各节点首进程, 其他进程为MPI_COMM_NULL
+    MPI_Win win_ = MPI_WIN_NULL;
+    int local_rank_ = 0;
+    int ppn_ = 1;
+    size_t window_bytes_ = 0;
+    bool from_cache_ = false;
+    int cache_fd_ = -1;
+    std::unique_ptr<Array7D<Complex>> view_;
+
+    static bool read_all(int fd, void* buffer, size_t bytes) {
+        size_t done = 0;
+        while (done < bytes) {
+            const ssize_t n = ::read(fd, static_cast<char*>(buffer) + done, bytes - done);
+            if (n <= 0) return false;
+            done += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    static bool write_all(int fd, const void* buffer, size_t bytes) {
+        size_t done = 0;
+        while (done < bytes) {
+            const ssize_t n = ::write(fd, static_cast<const char*>(buffer) + done, bytes - done);
+            if (n <= 0) return false;
+            done += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    // 缓存的键: 源文件的标识 (路径、大小、修改时间)、数据集名和同节点各进程的网格坐标
+    static uint64_t cache_key(const std::string& filename, const std::string& dataset_name,
+                              const ProcessGrid& grid, const std::vector<int>& node_coords) {
+        struct stat info{};
+        ::stat(filename.c_str(), &info);  // 失败时键仍然确定, 打开源文件时再报错
+        const int64_t stamp[3] = {static_cast<int64_t>(info.st_size), static_cast<int64_t>(info.st_mtim.tv_sec),
+                                  static_cast<int64_t>(info.st_mtim.tv_nsec)};
+        const int dims[Nd] = {grid.dim(X_DIM), grid.dim(Y_DIM), grid.dim(Z_DIM), grid.dim(T_DIM)};
+        uint64_t key = fnv1a64(filename.data(), filename.size());
+        key = fnv1a64(dataset_name.data(), dataset_name.size(), key);
+        key = fnv1a64(stamp, sizeof(stamp), key);
+        key = fnv1a64(dims, sizeof(dims), key);
+        return fnv1a64(node_coords.data(), node_coords.size() * sizeof(int), key);
+    }
+
+    static std::string cache_path(const std::string& cache_dir, uint64_t key) {
+        char name[40];
+        std::snprintf(name, sizeof(name), "/lattice_cache_%016llx.bin", static_cast<unsigned long long>(key));
+        return cache_dir + name;
+    }
+
+    // 读缓存文件头, 有效时返回true; 数据留在fd中接着读
+    static bool open_cache(const std::string& path, uint64_t key, CacheHeader& header, int& fd) {
+        fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat info;
+        if (read_all(fd, &header, sizeof(header)) && std::memcmp(header.magic, "LATCACH2", 8) == 0 &&
+            header.key == key && ::fstat(fd, &info) == 0 &&
+            static_cast<uint64_t>(info.st_size) == sizeof(header) + header.bytes) {
+            return true;
+        }
+        ::close(fd);
+        fd = -1;
+        return false;
+    }
+
+    // 先写临时文件再改名, 并发的作业不会读到写了一半的缓存
+    static void save_cache(const std::string& path, const CacheHeader& header, const void* data) {
+        const std::string tmp = path + ".tmp" + std::to_string(::getpid());
+        const int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) return;
+        const bool ok = write_all(fd, &header, sizeof(header)) && write_all(fd, data, header.bytes);
+        ::close(fd);
+        if (!ok || std::rename(tmp.c_str(), path.c_str()) != 0) std::remove(tmp.c_str());
+    }
+
+    void release() {
+        if (cache_fd_ >= 0) ::close(cache_fd_);
+        cache_fd_ = -1;
+        view_.reset();
+        if (win_ != MPI_WIN_NULL) MPI_Win_free(&win_);
+        if (leader_comm_ != MPI_COMM_NULL) MPI_Comm_free(&leader_comm_);
+        if (node_comm_ != MPI_COMM_NULL) MPI_Comm_free(&node_comm_);
+    }
+
+    // 首进程上的错误要让所有进程一起知道, 否则同节点的进程会停在后面的集体调用中
+    void check(const ProcessGrid& grid, const std::string& error) {
+        int ok = error.empty() ? 1 : 0;
+        MPI_Allreduce(MPI_IN_PLACE, &ok, 1, MPI_INT, MPI_MIN, grid.comm());
+        if (!ok) {
+            release();
+            throw std::runtime_error(error.empty() ? "其他节点读取配置失败" : error);
+        }
+    }
+
+public:
+    // 集体调用 (grid.comm()上的所有进程)
+    NodeSharedGauge(const ProcessGrid& grid, const std::string& filename, const std::string& dataset_name,
+                    const IoOptions& options = IoOptions(), const std::string& cache_dir = "") {
+        MPI_Comm_split_type(grid.comm(), MPI_COMM_TYPE_SHARED, grid.rank(), MPI_INFO_NULL, &node_comm_);
+        MPI_Comm_rank(node_comm_, &local_rank_);
+        MPI_Comm_size(node_comm_, &ppn_);
+        MPI_Comm_split(grid.comm(), local_rank_ == 0 ? 0 : MPI_UNDEFINED, grid.rank(), &leader_comm_);
+        const bool leader = local_rank_ == 0;
+
+        // 同节点各进程的网格坐标, 按节点内rank排列
+        std::vector<int> node_coords(ppn_ * Nd);
+        MPI_Gather(grid.coords().data, Nd, MPI_INT, node_coords.data(), Nd, MPI_INT, 0, node_comm_);
+
+        // 首进程查找缓存, 没有命中的首进程从源文件取得尺寸
+        CacheHeader header{};
+        uint64_t key = 0;
+        std::array<unsigned long long, 7> dims{};
+        std::string error;
+        if (leader) {
+            TraceScope scope("cache.lookup");
+            key = cache_key(filename, dataset_name, grid, node_coords);
+            from_cache_ = !cache_dir.empty() && open_cache(cache_path(cache_dir, key), key, header, cache_fd_);
+            if (from_cache_) {
+                std::copy(header.dims, header.dims + 7, dims.begin());
+            }
+            MPI_Comm miss_comm;
+            MPI_Comm_split(leader_comm_, from_cache_ ? MPI_UNDEFINED : 0, grid.rank(), &miss_comm);
+            if (miss_comm != MPI_COMM_NULL) {
+                Hdf5Lock hdf5_lock;
+                try {
+                    H5::H5File file(filename, H5F_ACC_RDONLY, H5::FileCreatPropList::DEFAULT,
+                                    make_fapl(miss_comm, options));
+                    const auto d = dataset_dims7d(file.openDataSet(dataset_name));
+                    std::copy(d.begin(), d.end(), dims.begin());
+                } catch (const H5::Exception& e) {
+                    error = "无法读取 " + filename + ": " + e.getDetailMsg();
+                } catch (const std::exception& e) {
+                    error = e.what();
+                }
+                MPI_Comm_free(&miss_comm);
+            }
+            if (error.empty() && (dims[0] != Nd || dims[6] != 2 * dims[5])) {
+                error = "数据集 " + dataset_name + " 不是规范场";
+            }
+        }
+        check(grid, error);
+        MPI_Bcast(dims.data(), 7, MPI_UNSIGNED_LONG_LONG, 0, node_comm_);
+
+        const auto local = grid.local_extent({dims[4], dims[3], dims[2], dims[1]});
+        const size_t Nc = dims[5];
+        const size_t segment = Nd * local[T_DIM] * local[Z_DIM] * local[Y_DIM] * local[X_DIM] * Nc * Nc;
+        window_bytes_ = segment * ppn_ * sizeof(Complex);
+
+        // 只有首进程分配内存, 其他进程通过shared_query得到首进程那块的地址
+        Complex* base = nullptr;
+        {
+            TraceScope scope("window.allocate");
+            void* mine;
+            MPI_Win_allocate_shared(leader ? static_cast<MPI_Aint>(window_bytes_) : 0, sizeof(Complex),
+                                    MPI_INFO_NULL, node_comm_, &mine, &win_);
+            MPI_Aint size;
+            int disp_unit;
+            void* shared;
+            MPI_Win_shared_query(win_, 0, &size, &disp_unit, &shared);
+            base = static_cast<Complex*>(shared);
+        }
+        MPI_Win_fence(0, win_);
+
+        if (leader) {
+            // 从缓存装入并校验
+            bool loaded = false;
+            if (from_cache_) {
+                TraceScope scope("cache.load");
+                loaded = header.bytes == window_bytes_ && read_all(cache_fd_, base, window_bytes_) &&
+                         fnv1a64_words(base, window_bytes_) == header.checksum;
+                ::close(cache_fd_);
+                cache_fd_ = -1;
+            }
+            from_cache_ = loaded;
+
+            // 缓存没有命中或校验失败的首进程一起集体读取, 每个首进程逐段读同节点各进程的子格子
+            MPI_Comm reader_comm;
+            MPI_Comm_split(leader_comm_, loaded ? MPI_UNDEFINED : 0, grid.rank(), &reader_comm);
+            if (reader_comm != MPI_COMM_NULL) {
+                Hdf5Lock hdf5_lock;
+                try {
+                    H5::H5File file(filename, H5F_ACC_RDONLY, H5::FileCreatPropList::DEFAULT,
+                                    make_fapl(reader_comm, options));
+                    H5::DataSet dataset = file.openDataSet(dataset_name);
+                    int segments = ppn_;
+                    MPI_Allreduce(MPI_IN_PLACE, &segments, 1, MPI_INT, MPI_MAX, reader_comm);
+                    for (int i = 0; i < segments; ++i) {
+                        if (i >= ppn_) {
+                            read_nothing(reader_comm, dataset, options);
+                            continue;
+                        }
+                        Array7D<Complex> part(local[T_DIM], local[Z_DIM], local[Y_DIM], local[X_DIM], Nc,
+                                              base + i * segment);
+                        std::array<size_t, Nd> offset;
+                        for (int d = 0; d < Nd; ++d) offset[d] = node_coords[i * Nd + d] * local[d];
+                        read_field_at(reader_comm, dataset, part, offset, options);
+                    }
+                } catch (const H5::Exception& e) {
+                    error = "无法读取 " + filename + ": " + e.getDetailMsg();
+                } catch (const std::exception& e) {
+                    error = e.what();
+                }
+                MPI_Comm_free(&reader_comm);
+
+                if (error.empty() && !cache_dir.empty()) {
+                    TraceScope scope("cache.save");
+                    std::memcpy(header.magic, "LATCACH2", 8);
+                    header.key = key;
+                    std::copy(dims.begin(), dims.end(), header.dims);
+                    header.bytes = window_bytes_;
+                    header.checksum = fnv1a64_words(base, window_bytes_);
+                    save_cache(cache_path(cache_dir, key), header, base);
+                }
+            }
+        }
+        check(grid, error);
+
+        // 首进程写入的数据对同节点的进程可见
+        MPI_Win_fence(0, win_);
+        int cached = from_cache_ ? 1 : 0;
+        MPI_Bcast(&cached, 1, MPI_INT, 0, node_comm_);
+        from_cache_ = cached != 0;
+
+        view_.reset(new Array7D<Complex>(local[T_DIM], local[Z_DIM], local[Y_DIM], local[X_DIM], Nc,
+                                         base + local_rank_ * segment));
+    }
+
+    // 集体调用, 需要在MPI_Finalize之前析构
+    ~NodeSharedGauge() { release(); }
+
+    NodeSharedGauge(const NodeSharedGauge&) = delete;
+    NodeSharedGauge& operator=(const NodeSharedGauge&) = delete;
+
+    // 本进程的子格子, 指向共享窗口, 只读
+    const Array7D<Complex>& field() const { return *view_; }
+
+    // 本节点的数据是否来自节点本地缓存
+    bool from_cache() const { return from_cache_; }
+    int ranks_per_node() const { return ppn_; }
+    // 本节点共享窗口的大小
+    size_t node_bytes() const { return window_bytes_; }
+};
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <H5Cpp.h>
+#include <algorithm>
+#include <array>
+#include <complex>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "grid.h"
+#include "lattice_io.h"
+#include "public.h"
+
+// 按顺序遍历多个配置文件的预取读取器
+// 后台I/O线程在复制出的通信子上提前打开并集体读取后续配置, 用户代码同时处理当前配置;
+// 数据放在预先分配的depth个Array7D组成的环中, 稳态下不再分配内存
+// 后台线程与主线程可能同时调用MPI, 因此需要MPI_THREAD_MULTIPLE, 否则在next()中同步读取;
+// 预取期间主线程不能调用HDF5
+class ConfigPrefetcher {
+private:
+    using Field = Array7D<std::complex<double>>;
+
+    const ProcessGrid& grid_;
+    std::unique_ptr<ProcessGrid> io_grid_;  // 与grid_坐标相同的独立通信子, 只供I/O线程使用
+    std::vector<std::string> files_;
+    std::string dataset_name_;
+    IoOptions options_;
+    std::vector<std::unique_ptr<Field>> ring_;
+    std::vector<long> slot_config_;   // 每个槽中已读好的配置编号, -1表示空闲
+    size_t next_ = 0;                 // 下一个交给用户的配置
+    long current_slot_ = -1;
+    bool async_ = false;
+
+    std::thread worker_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::exception_ptr error_;
+    size_t limit_;                    // I/O线程最多读到的配置编号(不含)
+
+    void worker_loop() {
+        for (size_t j = 0; j < files_.size(); ++j) {
+            const size_t slot = j % ring_.size();
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [&] { return j >= limit_ || slot_config_[slot] < 0; });
+                if (j >= limit_) return;
+            }
+            try {
+                read7d(*io_grid_, files_[j], dataset_name_, *ring_[slot], options_);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                error_ = std::current_exception();
+                cv_.notify_all();
+                return;
+            }
+            std::lock_guard<std::mutex> lock(mutex_);
+            slot_config_[slot] = static_cast<long>(j);
+            cv_.notify_all();
+        }
+    }
+
+    void release_current() {
+        if (current_slot_ < 0) return;
+        std::lock_guard<std::mutex> lock(mutex_);
+        slot_config_[current_slot_] = -1;
+        current_slot_ = -1;
+        cv_.notify_all();
+    }
+
+public:
+    ConfigPrefetcher(const ProcessGrid& grid, const std::vector<std::string>& files,
+                     const std::string& dataset_name, size_t depth = 2,
+                     const std::array<size_t, Nd>& ghost = {0, 0, 0, 0},
+                     const IoOptions& options = IoOptions())
+        : grid_(grid), files_(files), dataset_name_(dataset_name), options_(options), limit_(files.size()) {
+        if (files_.empty()) {
+            throw std::runtime_error("没有配置文件");
+        }
+
+        // 按第一个文件的尺寸分配缓冲区环, 后续文件必须同尺寸
+        std::array<hsize_t, 7> dims;
+        {
+            H5::H5File file = open7d(grid_, files_[0], options_);
+            dims = dataset_dims7d(file.openDataSet(dataset_name_));
+        }
+        const auto local = grid_.local_extent({dims[4], dims[3], dims[2], dims[1]});
+        for (size_t i = 0; i < std::max<size_t>(1, depth); ++i) {
+            ring_.emplace_back(new Field(local[T_DIM], local[Z_DIM], local[Y_DIM], local[X_DIM], dims[5], ghost));
+        }
+        slot_config_.assign(ring_.size(), -1);
+
+        int provided;
+        MPI_Query_thread(&provided);
+        async_ = provided >= MPI_THREAD_MULTIPLE;
+        if (async_) {
+            // 以原通信子为父通信子、不重排地建立网格, 得到rank和坐标都相同的复制品
+            io_grid_.reset(new ProcessGrid(grid_.comm(),
+                {grid_.dim(X_DIM), grid_.dim(Y_DIM), grid_.dim(Z_DIM), grid_.dim(T_DIM)},
+                GridMapping::Plain));
+            worker_ = std::thread(&ConfigPrefetcher::worker_loop, this);
+        }
+    }
+
+    // 各进程的I/O线程必须读同样多个配置才能完成集体调用, 提前结束时
+    // 统一让它读完已消费配置之后的depth个(即稳态下本来就会预取的部分)再退出
+    ~ConfigPrefetcher() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            limit_ = std::min(files_.size(), next_ + ring_.size());
+            slot_config_.assign(ring_.size(), -1);
+            cv_.notify_all();
+        }
+        if (worker_.joinable()) worker_.join();
+    }
+
+    ConfigPrefetcher(const ConfigPrefetcher&) = delete;
+    ConfigPrefetcher& operator=(const ConfigPrefetcher&) = delete;
+
+    // 释放上一个配置并返回下一个, 遍历结束时返回nullptr
+    // 返回的数组在下一次调用next()之前有效
+    const Field* next() {
+        release_current();
+        if (next_ >= files_.size()) return nullptr;
+
+        const size_t slot = next_ % ring_.size();
+        if (async_) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [&] { return error_ || slot_config_[slot] == static_cast<long>(next_); });
+            if (error_) std::rethrow_exception(error_);
+        } else {
+            read7d(grid_, files_[next_], dataset_name_, *ring_[slot], options_);
+            slot_config_[slot] = static_cast<long>(next_);
+        }
+        current_slot_ = static_cast<long>(slot);
+        ++next_;
+        return ring_[slot].get();
+    }
+
+    // 最近一次next()返回的配置文件名
+    const std::string& current_file() const { return files_[next_ - 1]; }
+    bool asynchronous() const { return async_; }
+};
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <H5Cpp.h>
+#include <mpi.h>
+#include <algorithm>
+#include <array>
+#include <complex>
+#include <sstream>
+#include <string>
+#include <stdexcept>
+#include <vector>
+
+#include "grid.h"
+#include "lattice_io.h"
+#include "public.h"
+#include "trace.h"
+
+// 与完整格子写在同一文件中的多分辨率预览: 每个块大小b一个小数据集
+//   /preview/<数据集名>_b<b>, 尺寸 [Nd, Lt/b, Lz/b, Ly/b, Lx/b], double
+// 值为b^4个格点的块内 Re tr U_mu / Nc 的平均, 属性block记录b
+// 各进程由本地Array7D归约自己的块, 不需要通信; 较粗的层在块大小是上一层整数倍时由上一层再归约
+// b需要整除各方向的本地尺寸, 预览工具只读几MB而不是整个格子
+
+// "2,4" -> {2, 4}, 空串表示不写预览
+inline std::vector<size_t> parse_blocks(const std::string& text) {
+    std::vector<size_t> blocks;
+    std::stringstream ss(text);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (item.empty()) continue;
+        const size_t b = std::stoul(item);
+        if (b < 2) throw std::runtime_error("预览的块大小至少为2: " + item);
+        blocks.push_back(b);
+    }
+    std::sort(blocks.begin(), blocks.end());
+    blocks.erase(std::unique(blocks.begin(), blocks.end()), blocks.end());
+    return blocks;
+}
+
+inline std::string preview_name(const std::string& dataset_name, size_t block) {
+    return "/preview/" + dataset_name + "_b" + std::to_string(block);
+}
+
+// 本进程的一层预览, 按 [mu][t][z][y][x] 存放
+struct PreviewLevel {
+    size_t block;
+    std::array<size_t, Nd> extent;   // 本地块数, QcuDims顺序
+    std::vector<double> data;
+
+    size_t index(size_t mu, size_t t, size_t z, size_t y, size_t x) const {
+        return (((mu * extent[T_DIM] + t) * extent[Z_DIM] + z) * extent[Y_DIM] + y) * extent[X_DIM] + x;
+    }
+};
+
+namespace detail {
+
+inline PreviewLevel make_level(size_t block, const std::array<size_t, Nd>& local) {
+    PreviewLevel level;
+    level.block = block;
+    for (int d = 0; d < Nd; ++d) {
+        if (local[d] % block != 0) {
+            throw std::runtime_error("预览的块大小 " + std::to_string(block) + " 不能整除本地尺寸");
+        }
+        level.extent[d] = local[d] / block;
+    }
+    level.data.assign(Nd * level.extent[T_DIM] * level.extent[Z_DIM] * level.extent[Y_DIM] * level.extent[X_DIM], 0);
+    return level;
+}
+
+}  // namespace detail
+
+// 本地数组的各层预览, blocks从小到大
+inline std::vector<PreviewLevel> compute_previews(const Array7D<std::complex<double>>& u,
+                                                  const std::vector<size_t>& blocks) {
+    const std::array<size_t, Nd> local = {u.get_Lx(), u.get_Ly(), u.get_Lz(), u.get_Lt()};
+    const size_t Nc = u.get_Nc();
+    std::vector<PreviewLevel> levels;
+    for (size_t block : blocks) {
+        PreviewLevel level = detail::make_level(block, local);
+        const PreviewLevel* finer = nullptr;
+        for (const PreviewLevel& l : levels) {
+            if (block % l.block == 0) finer = &l;
+        }
+        if (finer != nullptr) {
+            // 由上一层归约: 每块包含 (block / finer->block)^4 个等大的子块
+            const size_t r = block / finer->block;
+            const double scale = 1.0 / (r * r * r * r);
+            for (size_t mu = 0; mu < Nd; ++mu)
+                for (size_t t = 0; t < finer->extent[T_DIM]; ++t)
+                    for (size_t z = 0; z < finer->extent[Z_DIM]; ++z)
+                        for (size_t y = 0; y < finer->extent[Y_DIM]; ++y)
+                            for (size_t x = 0; x < finer->extent[X_DIM]; ++x) {
+                                level.data[level.index(mu, t / r, z / r, y / r, x / r)]
+                                    += finer->data[finer->index(mu, t, z, y, x)] * scale;
+                            }
+        } else {
+            const double scale = 1.0 / (Nc * block * block * block * block);
+            for (size_t mu = 0; mu < Nd; ++mu)
+                for (size_t t = 0; t < local[T_DIM]; ++t)
+                    for (size_t z = 0; z < local[Z_DIM]; ++z)
+                        for (size_t y = 0; y < local[Y_DIM]; ++y)
+                            for (size_t x = 0; x < local[X_DIM]; ++x) {
+                                const std::complex<double>* link = u.site_ptr(mu, t, z, y, x);
+                                double trace = 0;
+                                for (size_t a = 0; a < Nc; ++a) trace += link[a * Nc + a].real();
+                                level.data[level.index(mu, t / block, z / block, y / block, x / block)]
+                                    += trace * scale;
+                            }
+        }
+        levels.push_back(std::move(level));
+    }
+    return levels;
+}
+
+// 集体调用: 在已写好完整格子的文件中追加各层预览, 已存在的同名预览被替换
+inline void write_previews(const ProcessGrid& grid, const std::string& filename, const std::string& dataset_name,
+                           const Array7D<std::complex<double>>& u, const std::vector<size_t>& blocks,
+                           const IoOptions& options = IoOptions()) {
+    if (blocks.empty()) return;
+    std::vector<PreviewLevel> levels;
+    {
+        TraceScope scope("preview.compute");
+        levels = compute_previews(u, blocks);
+    }
+
+    TraceScope scope("preview.write");
+    Hdf5Lock hdf5_lock;
+    H5::H5File file(filename, H5F_ACC_RDWR, H5::FileCreatPropList::DEFAULT, make_fapl(grid.comm(), options));
+    if (!file.nameExists("preview")) file.createGroup("preview");
+    H5::DSetMemXferPropList xfer_plist = make_dxpl(options);
+    const auto offset = grid.local_offset({u.get_Lx(), u.get_Ly(), u.get_Lz(), u.get_Lt()});
+
+    for (const PreviewLevel& level : levels) {
+        const std::string name = preview_name(dataset_name, level.block);
+        if (file.nameExists(name)) file.unlink(name);
+        const std::array<hsize_t, 5> count = {
+            Nd, level.extent[T_DIM], level.extent[Z_DIM], level.extent[Y_DIM], level.extent[X_DIM]
+        };
+        const std::array<hsize_t, 5> dims = {
+            Nd, count[1] * grid.dim(T_DIM), count[2] * grid.dim(Z_DIM), count[3] * grid.dim(Y_DIM),
+            count[4] * grid.dim(X_DIM)
+        };
+        const std::array<hsize_t, 5> start = {
+            0, offset[T_DIM] / level.block, offset[Z_DIM] / level.block, offset[Y_DIM] / level.block,
+            offset[X_DIM] / level.block
+        };
+        H5::DataSpace filespace(dims.size(), dims.data());
+        H5::DataSet dataset = file.createDataSet(name, H5::PredType::NATIVE_DOUBLE, filespace);
+        const unsigned long long block = level.block;
+        dataset.createAttribute("block", H5::PredType::NATIVE_ULLONG, H5::DataSpace())
+            .write(H5::PredType::NATIVE_ULLONG, &block);
+
+        filespace.selectHyperslab(H5S_SELECT_SET, count.data(), start.data());
+        H5::DataSpace memspace(count.size(), count.data());
+        dataset.write(level.data.data(), H5::PredType::NATIVE_DOUBLE, memspace, filespace, xfer_plist);
+        trace_mpio(xfer_plist, options.collective);
+    }
+}
+
+// 单进程读取一层预览, dims返回 [Nd, Lt/b, Lz/b, Ly/b, Lx/b]
+inline std::vector<double> read_preview(const std::string& filename, const std::string& dataset_name,
+                                        size_t block, std::array<hsize_t, 5>& dims) {
+    Hdf5Lock hdf5_lock;
+    H5::H5File file(filename, H5F_ACC_RDONLY);
+    const std::string name = preview_name(dataset_name, block);
+    if (!file.nameExists("preview") || !file.nameExists(name)) {
+        throw std::runtime_error(filename + " 中没有预览 " + name);
+    }
+    H5::DataSet dataset = file.openDataSet(name);
+    dims = dataset_dims<5>(dataset);
+    std::vector<double> data(dims[0] * dims[1] * dims[2] * dims[3] * dims[4]);
+    dataset.read(data.data(), H5::PredType::NATIVE_DOUBLE);
+    return data;
+}
+
+// 文件中已有的预览块大小
+inline std::vector<size_t> list_previews(const std::string& filename, const std::string& dataset_name) {
+    Hdf5Lock hdf5_lock;
+    H5::H5File file(filename, H5F_ACC_RDONLY);
+    std::vector<size_t> blocks;
+    if (!file.nameExists("preview")) return blocks;
+    H5::Group group = file.openGroup("preview");
+    const std::string prefix = dataset_name + "_b";
+    for (hsize_t i = 0; i < group.getNumObjs(); ++i) {
+        const std::string name = group.getObjnameByIdx(i);
+        if (name.compare(0, prefix.size(), prefix) == 0) blocks.push_back(std::stoul(name.substr(prefix.size())));
+    }
+    std::sort(blocks.begin(), blocks.end());
+    return blocks;
+}
@@ -1,5 +1,14 @@
 #pragma once
 
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
 enum QcuDims {
     X_DIM = 0,
     Y_DIM = 1,
@@ -8,46 +17,178 @@ enum QcuDims {
     Nd
 };
 
+// 格子场的存储: 自己拥有的数组, 或借用外部内存 (如节点共享窗口) 的不拥有视图
+// 复制拥有存储的对象会复制数据, 复制视图只复制指针
 template <typename T>
-class Array7D {
+class FieldStorage {
 private:
-    constexpr static int Ndim = 4;  
-    std::vector<T> data;
-    size_t Lt, Lz, Ly, Lx, Nc;
-    
-    // 私有的索引计算方法
-    size_t index(size_t dim, size_t t, size_t z, size_t y, 
-                 size_t x, size_t c1, size_t c2) const {
-        return ((((((dim * Lt + t) * Lz + z) * Ly + y) * Lx + x) * Nc + c1) * Nc + c2);
-    }
-    
+    std::vector<T> owned_;
+    T* ptr_ = nullptr;
+
+public:
+    FieldStorage() = default;
+    FieldStorage(const FieldStorage& other) : owned_(other.owned_), ptr_(other.borrowed() ? other.ptr_ : owned_.data()) {}
+    FieldStorage(FieldStorage&& other) noexcept : ptr_(other.ptr_) {
+        if (!other.borrowed()) owned_.swap(other.owned_);  // swap不改变缓冲区地址, ptr_仍然有效
+        other.ptr_ = nullptr;
+    }
+    FieldStorage& operator=(FieldStorage other) noexcept {
+        const bool other_borrowed = other.borrowed();
+        owned_.swap(other.owned_);
+        ptr_ = other_borrowed ? other.ptr_ : owned_.data();
+        return *this;
+    }
+
+    void resize(size_t n) {
+        owned_.resize(n);
+        ptr_ = owned_.data();
+    }
+    void borrow(T* external) {
+        std::vector<T>().swap(owned_);
+        ptr_ = external;
+    }
+    bool borrowed() const { return ptr_ != owned_.data(); }
+
+    T& operator[](size_t i) { return ptr_[i]; }
+    const T& operator[](size_t i) const { return ptr_[i]; }
+    T* data() { return ptr_; }
+    const T* data() const { return ptr_; }
+};
+
+// 按4D格点分解的格子场, 存储顺序 [outer][t][z][y][x][inner_0]...[inner_{R-1}]
+// outer是格点之外的批维度(链方向、源的个数等), inner是每个格点上的内部形状:
+//   规范场  outer=4     inner={Nc, Nc}        即Array7D
+//   旋量    outer=源数  inner={4, Nc}         LatticeField<T, 2>
+//   传播子  outer=源数  inner={4, Nc, 4, Nc}  LatticeField<T, 4>
+// 可选的ghost区只加在4个时空方向上, operator()的坐标相对于内部区域的起点
+template <typename T, size_t InnerRank>
+class LatticeField {
+protected:
+    FieldStorage<T> data;
+    size_t outer;
+    size_t Lt, Lz, Ly, Lx;
+    std::array<size_t, InnerRank> inner;
+    size_t inner_volume;
+    // 各方向两侧的ghost宽度 (按QcuDims下标), 存储尺寸为 L + 2 * ghost
+    std::array<size_t, Nd> ghost;
+    size_t Pt, Pz, Py, Px;
+
+    size_t padded_site(size_t o, size_t t, size_t z, size_t y, size_t x) const {
+        return (((o * Pt + t) * Pz + z) * Py + y) * Px + x;
+    }
+
+    template <typename... Inner>
+    size_t inner_index(Inner... i) const {
+        static_assert(sizeof...(Inner) == InnerRank, "内部下标个数与InnerRank不一致");
+        const size_t idx[] = {static_cast<size_t>(i)...};
+        size_t n = 0;
+        for (size_t k = 0; k < InnerRank; ++k) n = n * inner[k] + idx[k];
+        return n;
+    }
+
 public:
-    Array7D(size_t t_size, size_t z_size, size_t y_size, 
-            size_t x_size, size_t color_size) 
-        : Lt(t_size), Lz(z_size), Ly(y_size), Lx(x_size), Nc(color_size) {
-        data.resize(Ndim * Lt * Lz * Ly * Lx * Nc * Nc);
+    LatticeField(size_t outer_size, size_t t_size, size_t z_size, size_t y_size, size_t x_size,
+                 const std::array<size_t, InnerRank>& inner_shape,
+                 const std::array<size_t, Nd>& ghost_width = {0, 0, 0, 0})
+        : outer(outer_size), Lt(t_size), Lz(z_size), Ly(y_size), Lx(x_size), inner(inner_shape),
+          inner_volume(1), ghost(ghost_width),
+          Pt(Lt + 2 * ghost[T_DIM]), Pz(Lz + 2 * ghost[Z_DIM]),
+          Py(Ly + 2 * ghost[Y_DIM]), Px(Lx + 2 * ghost[X_DIM]) {
+        for (size_t n : inner) inner_volume *= n;
+        data.resize(outer * Pt * Pz * Py * Px * inner_volume);
+    }
+
+    // 不拥有存储的视图, external指向与上面构造相同布局的外部内存, 生存期由调用者保证
+    LatticeField(size_t outer_size, size_t t_size, size_t z_size, size_t y_size, size_t x_size,
+                 const std::array<size_t, InnerRank>& inner_shape,
+                 const std::array<size_t, Nd>& ghost_width, T* external)
+        : outer(outer_size), Lt(t_size), Lz(z_size), Ly(y_size), Lx(x_size), inner(inner_shape),
+          inner_volume(1), ghost(ghost_width),
+          Pt(Lt + 2 * ghost[T_DIM]), Pz(Lz + 2 * ghost[Z_DIM]),
+          Py(Ly + 2 * ghost[Y_DIM]), Px(Lx + 2 * ghost[X_DIM]) {
+        for (size_t n : inner) inner_volume *= n;
+        data.borrow(external);
+    }
+
+    // 存储的元素个数 (含ghost区)
+    size_t storage_size() const { return outer * Pt * Pz * Py * Px * inner_volume; }
+    bool is_view() const { return data.borrowed(); }
+
+    template <typename... Inner>
+    T& operator()(size_t o, size_t t, size_t z, size_t y, size_t x, Inner... i) {
+        return data[padded_site(o, t + ghost[T_DIM], z + ghost[Z_DIM], y + ghost[Y_DIM], x + ghost[X_DIM])
+                    * inner_volume + inner_index(i...)];
+    }
+
+    template <typename... Inner>
+    const T& operator()(size_t o, size_t t, size_t z, size_t y, size_t x, Inner... i) const {
+        return data[padded_site(o, t + ghost[T_DIM], z + ghost[Z_DIM], y + ghost[Y_DIM], x + ghost[X_DIM])
+                    * inner_volume + inner_index(i...)];
+    }
+
+    // 访问含ghost区的格点, 坐标取值范围为 [-ghost, L + ghost)
+    template <typename... Inner>
+    T& halo(size_t o, std::ptrdiff_t t, std::ptrdiff_t z, std::ptrdiff_t y, std::ptrdiff_t x, Inner... i) {
+        return data[padded_site(o, t + ghost[T_DIM], z + ghost[Z_DIM], y + ghost[Y_DIM], x + ghost[X_DIM])
+                    * inner_volume + inner_index(i...)];
     }
 
-    T& operator()(size_t dim, size_t t, size_t z, size_t y, 
-                  size_t x, size_t c1, size_t c2) {
-        return data[index(dim, t, z, y, x, c1, c2)];
+    template <typename... Inner>
+    const T& halo(size_t o, std::ptrdiff_t t, std::ptrdiff_t z, std::ptrdiff_t y, std::ptrdiff_t x,
+                  Inner... i) const {
+        return data[padded_site(o, t + ghost[T_DIM], z + ghost[Z_DIM], y + ghost[Y_DIM], x + ghost[X_DIM])
+                    * inner_volume + inner_index(i...)];
     }
 
-    const T& operator()(size_t dim, size_t t, size_t z, size_t y, 
-                       size_t x, size_t c1, size_t c2) const {
-        return data[index(dim, t, z, y, x, c1, c2)];
+    // 一个内部格点上连续存放的inner_volume个元素
+    T* site_ptr(size_t o, size_t t, size_t z, size_t y, size_t x) {
+        return &data[padded_site(o, t + ghost[T_DIM], z + ghost[Z_DIM], y + ghost[Y_DIM], x + ghost[X_DIM])
+                     * inner_volume];
     }
 
-    // 移到public部分的方法
+    const T* site_ptr(size_t o, size_t t, size_t z, size_t y, size_t x) const {
+        return &data[padded_site(o, t + ghost[T_DIM], z + ghost[Z_DIM], y + ghost[Y_DIM], x + ghost[X_DIM])
+                     * inner_volume];
+    }
+
+    // 指向含ghost区的整块存储
     T* data_ptr() { return data.data(); }
     const T* data_ptr() const { return data.data(); }
-    
+
+    size_t get_outer() const { return outer; }
     size_t get_Lt() const { return Lt; }
     size_t get_Lz() const { return Lz; }
     size_t get_Ly() const { return Ly; }
     size_t get_Lx() const { return Lx; }
-    size_t get_Nc() const { return Nc; }
-    static constexpr size_t get_Ndim() { return Ndim; }
+    size_t get_inner(size_t k) const { return inner[k]; }
+    const std::array<size_t, InnerRank>& get_inner_shape() const { return inner; }
+    size_t get_inner_volume() const { return inner_volume; }
+    static constexpr size_t get_inner_rank() { return InnerRank; }
+
+    size_t get_ghost(int d) const { return ghost[d]; }
+    bool has_ghost() const { return ghost[X_DIM] + ghost[Y_DIM] + ghost[Z_DIM] + ghost[T_DIM] > 0; }
+    size_t get_padded_Lt() const { return Pt; }
+    size_t get_padded_Lz() const { return Pz; }
+    size_t get_padded_Ly() const { return Py; }
+    size_t get_padded_Lx() const { return Px; }
+};
+
+// 规范场: 4个链方向, 每个格点一个Nc * Nc矩阵, 存储顺序 [dim][t][z][y][x][c1][c2]
+template <typename T>
+class Array7D : public LatticeField<T, 2> {
+public:
+    Array7D(size_t t_size, size_t z_size, size_t y_size,
+            size_t x_size, size_t color_size,
+            const std::array<size_t, Nd>& ghost_width = {0, 0, 0, 0})
+        : LatticeField<T, 2>(Nd, t_size, z_size, y_size, x_size, {color_size, color_size}, ghost_width) {}
+
+    // 外部内存上的视图, 不带ghost区
+    Array7D(size_t t_size, size_t z_size, size_t y_size, size_t x_size, size_t color_size, T* external)
+        : LatticeField<T, 2>(Nd, t_size, z_size, y_size, x_size, {color_size, color_size}, {0, 0, 0, 0},
+                             external) {}
+
+    size_t get_Nc() const { return this->inner[0]; }
+    static constexpr size_t get_Ndim() { return Nd; }
 };
 
 
@@ -58,4 +199,55 @@ struct Coords {
     int Y() const { return data[Y_DIM]; }
     int Z() const { return data[Z_DIM]; }
     int T() const { return data[T_DIM]; }
-};
\ No newline at end of file
+};
+
+// 查找形如 --name=value 的命令行选项, 找不到时返回默认值
+inline std::string find_option(int argc, char** argv, const std::string& name,
+                               const std::string& default_value) {
+    const std::string prefix = "--" + name + "=";
+    for (int i = 1; i < argc; ++i) {
+        if (std::strncmp(argv[i], prefix.c_str(), prefix.size()) == 0) {
+            return argv[i] + prefix.size();
+        }
+    }
+    return default_value;
+}
+
+// 解析带可选K/M/G后缀的字节数, 如 "512M"
+inline size_t parse_bytes(const std::string& text) {
+    size_t pos = 0;
+    size_t value = std::stoull(text, &pos);
+    if (pos < text.size()) {
+        switch (text[pos]) {
+            case 'G': case 'g': value <<= 10; [[fallthrough]];
+            case 'M': case 'm': value <<= 10; [[fallthrough]];
+            case 'K': case 'k': value <<= 10; break;
+            default: throw std::runtime_error("无法解析的字节数: " + text);
+        }
+    }
+    return value;
+}
+
+// 64位FNV-1a散列, seed用于把多段数据串起来计算
+inline uint64_t fnv1a64(const void* data, size_t bytes, uint64_t seed = 14695981039346656037ULL) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    uint64_t hash = seed;
+    for (size_t i = 0; i < bytes; ++i) {
+        hash ^= p[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// 按8字节字做的FNV-1a, 大块数据上比逐字节快得多; 只处理bytes中8的整数倍部分
+inline uint64_t fnv1a64_words(const void* data, size_t bytes, uint64_t seed = 14695981039346656037ULL) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    uint64_t hash = seed;
+    for (size_t i = 0; i + sizeof(uint64_t) <= bytes; i += sizeof(uint64_t)) {
+        uint64_t word;
+        std::memcpy(&word, p + i, sizeof(word));
+        hash ^= word;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
@@ -0,0 +1,350 @@
+#pragma once
+
+#include <H5Cpp.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <complex>
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "grid.h"
+#include "lattice_io.h"
+#include "public.h"
+
+// 检查点所处的阶段
+enum class CheckpointState {
+    None,       // 尚未写出
+    LocalSafe,  // 所有进程的本地块已落到节点本地存储
+    Durable     // 已合并写入并行文件系统上的最终文件
+};
+
+inline const char* checkpoint_state_name(CheckpointState state) {
+    switch (state) {
+        case CheckpointState::None:      return "none";
+        case CheckpointState::LocalSafe: return "local";
+        case CheckpointState::Durable:   return "durable";
+    }
+    return "unknown";
+}
+
+// 经由节点本地存储(/dev/shm、本地NVMe)的两级检查点
+// stage()是阻塞部分: 每个进程把本地块原样写到stage_dir并fsync, 以内存速度返回;
+// drain()由后台线程把暂存块逐片集体写入最终的LatticeMatrix文件
+// 清单文件 <stage_dir>/<文件名>.manifest 记录尺寸和阶段, 作业中断后可以用resume()继续转存
+// 后台转存与主线程可能同时调用MPI, 需要MPI_THREAD_MULTIPLE, 否则在wait_durable()中同步转存;
+// 转存在Hdf5Lock内进行, 转存期间主线程不能发起HDF5的集体读写
+class StagedCheckpoint {
+private:
+    const ProcessGrid& grid_;
+    std::string stage_dir_;
+    std::string final_file_;
+    std::string dataset_name_;
+    IoOptions options_;
+    size_t slab_t_;                          // 每次转存的t切片数
+    std::array<hsize_t, 7> global_ = {0, 0, 0, 0, 0, 0, 0};
+    std::atomic<CheckpointState> state_{CheckpointState::None};
+    std::unique_ptr<ProcessGrid> io_grid_;
+    std::thread drainer_;
+    std::exception_ptr error_;
+    bool keep_stage_ = false;
+    std::vector<int> coords_;                // 各rank的网格坐标 (x, y, z, t), 只在rank 0上有
+
+    // 暂存块按rank命名, 续转时各rank必须对应相同的网格坐标, 所以清单里记下每个rank的坐标
+    void gather_coords() {
+        std::array<int, Nd> mine;
+        for (int d = 0; d < Nd; ++d) mine[d] = grid_.coords().data[d];
+        coords_.assign(grid_.rank() == 0 ? Nd * grid_.size() : 0, 0);
+        MPI_Gather(mine.data(), Nd, MPI_INT, coords_.data(), Nd, MPI_INT, 0, grid_.comm());
+    }
+
+    std::string base_name() const {
+        const size_t slash = final_file_.find_last_of('/');
+        return slash == std::string::npos ? final_file_ : final_file_.substr(slash + 1);
+    }
+
+    std::string piece_path(int rank) const {
+        return stage_dir_ + "/" + base_name() + ".r" + std::to_string(rank) + ".bin";
+    }
+
+    std::string manifest_path() const {
+        return stage_dir_ + "/" + base_name() + ".manifest";
+    }
+
+    // 集体调用: 由rank 0写清单, 先写临时文件再改名, 保证清单总是完整的; 失败时所有进程一起抛出异常
+    // comm为调用方所用网格的通信子 (转存线程用的是rank相同的复制品)
+    void write_manifest(CheckpointState state, MPI_Comm comm) const {
+        int ok = 1;
+        if (grid_.rank() == 0) {
+            const std::string tmp = manifest_path() + ".tmp";
+            {
+                std::ofstream out(tmp);
+                out << "file " << final_file_ << "\n"
+                    << "dataset " << dataset_name_ << "\n"
+                    << "ranks " << grid_.size() << "\n"
+                    << "grid " << grid_.dim(X_DIM) << " " << grid_.dim(Y_DIM) << " "
+                    << grid_.dim(Z_DIM) << " " << grid_.dim(T_DIM) << "\n"
+                    << "map " << mapping_name(grid_.mapping()) << "\n"
+                    << "dims";
+                for (hsize_t d : global_) out << " " << d;
+                out << "\n";
+                for (int r = 0; r < grid_.size(); ++r) {
+                    out << "rank " << r;
+                    for (int d = 0; d < Nd; ++d) out << " " << coords_[Nd * r + d];
+                    out << "\n";
+                }
+                out << "state " << checkpoint_state_name(state) << "\n";
+                if (!out) ok = 0;
+            }
+            if (ok && std::rename(tmp.c_str(), manifest_path().c_str()) != 0) ok = 0;
+        }
+        MPI_Bcast(&ok, 1, MPI_INT, 0, comm);
+        if (!ok) throw std::runtime_error("无法更新清单文件: " + manifest_path());
+    }
+
+    std::array<hsize_t, 7> local_dims() const {
+        const auto local = grid_.local_extent({global_[4], global_[3], global_[2], global_[1]});
+        return {global_[0], local[T_DIM], local[Z_DIM], local[Y_DIM], local[X_DIM], global_[5], global_[6]};
+    }
+
+    // 把暂存块按 (方向, slab_t_个t切片) 逐片读回并集体写入最终文件
+    void drain_now(const ProcessGrid& grid) {
+        // 整个转存持有HDF5的库锁, 主线程的HDF5调用要等转存结束
+        Hdf5Lock hdf5_lock;
+        const auto local = local_dims();
+        const auto offset_local = grid.local_offset({local[4], local[3], local[2], local[1]});
+        const size_t t_elems = local[2] * local[3] * local[4] * local[5] * local[6];
+
+        // 打开或读取暂存文件失败时各进程一起退出, 不让其余进程停在集体写入中
+        const int fd = ::open(piece_path(grid.rank()).c_str(), O_RDONLY);
+        int ok = fd >= 0;
+        MPI_Allreduce(MPI_IN_PLACE, &ok, 1, MPI_INT, MPI_MIN, grid.comm());
+        if (!ok) {
+            if (fd >= 0) ::close(fd);
+            throw std::runtime_error("无法打开暂存文件: " + piece_path(grid.rank()));
+        }
+        std::vector<double> buffer(slab_t_ * t_elems);
+
+        try {
+            H5::H5File file(final_file_, H5F_ACC_TRUNC, H5::FileCreatPropList::DEFAULT,
+                            make_fapl(grid.comm(), options_));
+            H5::DataSpace filespace(global_.size(), global_.data());
+            H5::DataSet dataset = file.createDataSet(dataset_name_, H5::PredType::NATIVE_DOUBLE, filespace);
+
+            H5::DSetMemXferPropList xfer_plist = make_dxpl(options_);
+
+            for (hsize_t dim = 0; dim < local[0]; ++dim) {
+                for (hsize_t t = 0; t < local[1]; t += slab_t_) {
+                    const hsize_t nt = std::min<hsize_t>(slab_t_, local[1] - t);
+                    // 暂存文件按 [dim, t, ...] 稠密存放, 一片在文件中是连续的
+                    const size_t bytes = nt * t_elems * sizeof(double);
+                    const off_t pos = static_cast<off_t>((dim * local[1] + t) * t_elems * sizeof(double));
+                    size_t done = 0;
+                    int read_ok = 1;
+                    while (read_ok && done < bytes) {
+                        const ssize_t n = ::pread(fd, reinterpret_cast<char*>(buffer.data()) + done,
+                                                  bytes - done, pos + static_cast<off_t>(done));
+                        if (n <= 0) read_ok = 0; else done += static_cast<size_t>(n);
+                    }
+                    MPI_Allreduce(MPI_IN_PLACE, &read_ok, 1, MPI_INT, MPI_MIN, grid.comm());
+                    if (!read_ok) throw std::runtime_error("读取暂存文件失败");
+
+                    StridedView7D view;
+                    view.ptr = buffer.data();
+                    view.count = {1, nt, local[2], local[3], local[4], local[5], local[6]};
+                    view.extent = view.count;
+                    view.offset = {0, 0, 0, 0, 0, 0, 0};
+                    view.stride = {1, 1, 1, 1, 1, 1, 1};
+                    const std::array<hsize_t, 7> file_offset = {
+                        dim, offset_local[T_DIM] + t, offset_local[Z_DIM], offset_local[Y_DIM],
+                        offset_local[X_DIM], 0, 0
+                    };
+                    H5::DataSpace memspace = view_memspace(view);
+                    transfer_pieces(grid.comm(), view, file_offset, memspace, filespace, options_,
+                        [&](const H5::DataSpace& mem, const H5::DataSpace& fspace) {
+                            dataset.write(buffer.data(), H5::PredType::NATIVE_DOUBLE, mem, fspace, xfer_plist);
+                        });
+                }
+            }
+            file.flush(H5F_SCOPE_GLOBAL);
+        } catch (...) {
+            ::close(fd);
+            throw;
+        }
+        ::close(fd);
+
+        write_manifest(CheckpointState::Durable, grid.comm());
+        if (!keep_stage_) std::remove(piece_path(grid.rank()).c_str());
+        state_ = CheckpointState::Durable;
+    }
+
+public:
+    StagedCheckpoint(const ProcessGrid& grid, const std::string& stage_dir,
+                     const std::string& final_file, const std::string& dataset_name,
+                     size_t slab_t = 1, const IoOptions& options = IoOptions())
+        : grid_(grid), stage_dir_(stage_dir), final_file_(final_file), dataset_name_(dataset_name),
+          options_(options), slab_t_(std::max<size_t>(1, slab_t)) {}
+
+    ~StagedCheckpoint() {
+        if (drainer_.joinable()) drainer_.join();
+    }
+
+    StagedCheckpoint(const StagedCheckpoint&) = delete;
+    StagedCheckpoint& operator=(const StagedCheckpoint&) = delete;
+
+    // 转存完成后保留暂存块
+    void keep_stage(bool keep) { keep_stage_ = keep; }
+
+    // 阻塞地把本地块写到节点本地存储, 所有进程完成后返回, 此时检查点为"本地安全"
+    void stage(const Array7D<std::complex<double>>& local_array) {
+        const StridedView7D view = make_view(local_array);
+        global_ = {
+            view.count[0], view.count[1] * grid_.dim(T_DIM), view.count[2] * grid_.dim(Z_DIM),
+            view.count[3] * grid_.dim(Y_DIM), view.count[4] * grid_.dim(X_DIM), view.count[5], view.count[6]
+        };
+
+        // 带ghost区时先打包内部区域
+        std::vector<double> packed;
+        const double* data = view.ptr;
+        if (local_array.has_ghost()) {
+            packed = pack_view(view);
+            data = packed.data();
+        }
+        size_t bytes = sizeof(double);
+        for (hsize_t c : view.count) bytes *= c;
+
+        int ok = 1;
+        const int fd = ::open(piece_path(grid_.rank()).c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            ok = 0;
+        } else {
+            size_t done = 0;
+            while (ok && done < bytes) {
+                const ssize_t n = ::write(fd, reinterpret_cast<const char*>(data) + done, bytes - done);
+                if (n <= 0) ok = 0; else done += static_cast<size_t>(n);
+            }
+            if (::fsync(fd) != 0) ok = 0;
+            ::close(fd);
+        }
+        MPI_Allreduce(MPI_IN_PLACE, &ok, 1, MPI_INT, MPI_MIN, grid_.comm());
+        if (!ok) throw std::runtime_error("暂存到 " + stage_dir_ + " 失败");
+
+        gather_coords();
+        write_manifest(CheckpointState::LocalSafe, grid_.comm());
+        state_ = CheckpointState::LocalSafe;
+    }
+
+    // 从清单恢复一个已暂存但尚未转存完成的检查点, 之后可以调用drain()
+    // 进程数、进程网格、映射方式和每个rank的网格坐标都必须与暂存时相同, 否则暂存块会被转存到错误的位置
+    void resume() {
+        int status = 0;  // 1: 一致, 0: 清单不存在或不完整, -1: 进程数不同, -2: 网格或映射方式不同
+        std::vector<int> recorded(grid_.rank() == 0 ? Nd * grid_.size() : 0, -1);
+        if (grid_.rank() == 0) {
+            std::ifstream in(manifest_path());
+            std::string line;
+            bool has_dims = false, has_grid = false, has_map = false;
+            int rank_lines = 0;
+            while (std::getline(in, line)) {
+                std::istringstream fields(line);
+                std::string key;
+                fields >> key;
+                if (key == "dims") {
+                    for (hsize_t& d : global_) fields >> d;
+                    has_dims = true;
+                } else if (key == "ranks") {
+                    int ranks;
+                    fields >> ranks;
+                    if (ranks != grid_.size()) status = -1;
+                } else if (key == "grid") {
+                    std::array<int, Nd> dims;
+                    fields >> dims[X_DIM] >> dims[Y_DIM] >> dims[Z_DIM] >> dims[T_DIM];
+                    for (int d = 0; d < Nd; ++d) {
+                        if (dims[d] != grid_.dim(d) && status == 0) status = -2;
+                    }
+                    has_grid = true;
+                } else if (key == "map") {
+                    std::string name;
+                    fields >> name;
+                    if (name != mapping_name(grid_.mapping()) && status == 0) status = -2;
+                    has_map = true;
+                } else if (key == "rank") {
+                    int r;
+                    fields >> r;
+                    if (r >= 0 && r < grid_.size()) {
+                        for (int d = 0; d < Nd; ++d) fields >> recorded[Nd * r + d];
+                        ++rank_lines;
+                    }
+                }
+            }
+            if (status == 0 && has_dims && has_grid && has_map && rank_lines == grid_.size()) status = 1;
+        }
+        MPI_Bcast(&status, 1, MPI_INT, 0, grid_.comm());
+        if (status == 0) throw std::runtime_error("清单 " + manifest_path() + " 不存在或不完整");
+        if (status == -1) throw std::runtime_error("清单 " + manifest_path() + " 的进程数与当前作业不一致");
+        if (status == -2) throw std::runtime_error("清单 " + manifest_path() + " 的进程网格或映射方式与当前作业不一致");
+
+        // 映射方式相同时rank的重排仍可能不同 (如cart由MPI实现决定), 逐个核对坐标
+        std::array<int, Nd> mine;
+        MPI_Scatter(recorded.data(), Nd, MPI_INT, mine.data(), Nd, MPI_INT, 0, grid_.comm());
+        int same = 1;
+        for (int d = 0; d < Nd; ++d) same = same && mine[d] == grid_.coords().data[d];
+        MPI_Allreduce(MPI_IN_PLACE, &same, 1, MPI_INT, MPI_MIN, grid_.comm());
+        if (!same) throw std::runtime_error("清单 " + manifest_path() + " 中rank的网格坐标与当前作业不一致");
+
+        MPI_Bcast(global_.data(), 7, MPI_UNSIGNED_LONG_LONG, 0, grid_.comm());
+        gather_coords();
+        state_ = CheckpointState::LocalSafe;
+    }
+
+    // 开始转存到最终文件; 线程级别足够时在后台进行
+    // 后台转存持有Hdf5Lock并在自己的通信子上做集体写入: wait_durable()返回之前主线程不能发起HDF5的
+    // 集体调用, 否则等锁的主线程和其他进程上的转存线程互相等待; 不经过HDF5的计算和MPI通信不受影响
+    void drain() {
+        if (state_ != CheckpointState::LocalSafe) {
+            throw std::runtime_error("检查点尚未暂存");
+        }
+        int provided;
+        MPI_Query_thread(&provided);
+        if (provided < MPI_THREAD_MULTIPLE) return;  // 在wait_durable()中同步转存
+
+        // 以原通信子为父通信子、不重排地建立网格, 转存线程独占该通信子
+        io_grid_.reset(new ProcessGrid(grid_.comm(),
+            {grid_.dim(X_DIM), grid_.dim(Y_DIM), grid_.dim(Z_DIM), grid_.dim(T_DIM)},
+            GridMapping::Plain));
+        drainer_ = std::thread([this] {
+            try {
+                drain_now(*io_grid_);
+            } catch (...) {
+                error_ = std::current_exception();
+            }
+        });
+    }
+
+    // 等待检查点写入并行文件系统
+    void wait_durable() {
+        if (drainer_.joinable()) {
+            drainer_.join();
+            io_grid_.reset();
+            if (error_) std::rethrow_exception(error_);
+        } else if (state_ == CheckpointState::LocalSafe) {
+            drain_now(grid_);
+        }
+    }
+
+    CheckpointState state() const { return state_; }
+
+    // 全局格子尺寸 (QcuDims顺序), stage()或resume()之后有效
+    std::array<size_t, Nd> lattice() const {
+        return {static_cast<size_t>(global_[4]), static_cast<size_t>(global_[3]), static_cast<size_t>(global_[2]),
+                static_cast<size_t>(global_[1])};
+    }
+};
@@ -0,0 +1,197 @@
+#pragma once
+
+#include <H5Cpp.h>
+#include <algorithm>
+#include <array>
+#include <future>
+#include <memory>
+#include <string>
+#include <stdexcept>
+#include <vector>
+
+#include "grid.h"
+#include "lattice_io.h"
+#include "public.h"
+
+// 流式读写时切片的方向
+enum class SlabAxis {
+    Dim,  // 每片为一个(或thickness个)链方向
+    T     // 每片为thickness个t切片, 包含全部4个方向
+};
+
+inline SlabAxis parse_slab_axis(const std::string& name) {
+    if (name == "dim") return SlabAxis::Dim;
+    if (name == "t")   return SlabAxis::T;
+    throw std::runtime_error("未知的切片方式: " + name);
+}
+
+// 一片在本地块中的位置, 维度顺序 [dim, t, z, y, x, c1, 2*c2], 数据在缓冲区中稠密存放
+struct SlabInfo {
+    size_t index;
+    std::array<hsize_t, 7> start;
+    std::array<hsize_t, 7> count;
+
+    size_t size() const {
+        size_t n = 1;
+        for (hsize_t c : count) n *= c;
+        return n;
+    }
+};
+
+// 以有界内存按片搬运本地块: 只分配2到3个片大小的缓冲区, 与格子大小无关
+// 第k片交给回调处理时, 后台线程同时写出第k-1片、读入第k+1片
+// 后台线程负责全部HDF5/MPI调用, 因此要求MPI_THREAD_SERIALIZED以上,
+// 且重叠期间回调中不能调用MPI; 线程级别不足时退化为顺序执行
+class SlabStream {
+private:
+    const ProcessGrid& grid_;
+    SlabAxis axis_;
+    size_t thickness_;
+    IoOptions options_;
+    std::array<hsize_t, 7> local_ = {0, 0, 0, 0, 0, 0, 0};
+    std::array<hsize_t, 7> offset_ = {0, 0, 0, 0, 0, 0, 0};
+    std::unique_ptr<H5::H5File> in_file_, out_file_;
+    H5::DataSet in_dataset_, out_dataset_;
+    H5::DSetMemXferPropList xfer_plist_;
+    bool has_input_ = false;
+    bool has_output_ = false;
+
+    void set_local(const std::array<hsize_t, 7>& global) {
+        const auto local = grid_.local_extent({global[4], global[3], global[2], global[1]});
+        const auto offset = grid_.local_offset(local);
+        local_ = {global[0], local[T_DIM], local[Z_DIM], local[Y_DIM], local[X_DIM], global[5], global[6]};
+        offset_ = {0, offset[T_DIM], offset[Z_DIM], offset[Y_DIM], offset[X_DIM], 0, 0};
+    }
+
+    size_t slab_count() const {
+        const hsize_t extent = axis_ == SlabAxis::Dim ? local_[0] : local_[1];
+        return (extent + thickness_ - 1) / thickness_;
+    }
+
+    SlabInfo slab(size_t k) const {
+        SlabInfo info;
+        info.index = k;
+        info.start = {0, 0, 0, 0, 0, 0, 0};
+        info.count = local_;
+        const int axis = axis_ == SlabAxis::Dim ? 0 : 1;
+        info.start[axis] = k * thickness_;
+        info.count[axis] = std::min<hsize_t>(thickness_, local_[axis] - info.start[axis]);
+        return info;
+    }
+
+    // 缓冲区中一片的稠密视图
+    static StridedView7D slab_view(const SlabInfo& info, const double* buffer) {
+        StridedView7D view;
+        view.ptr = buffer;
+        view.extent = info.count;
+        view.offset = {0, 0, 0, 0, 0, 0, 0};
+        view.stride = {1, 1, 1, 1, 1, 1, 1};
+        view.count = info.count;
+        return view;
+    }
+
+    std::array<hsize_t, 7> file_offset(const SlabInfo& info) const {
+        std::array<hsize_t, 7> offset;
+        for (int i = 0; i < 7; ++i) offset[i] = offset_[i] + info.start[i];
+        return offset;
+    }
+
+    void read_slab(const SlabInfo& info, double* buffer) {
+        const StridedView7D view = slab_view(info, buffer);
+        H5::DataSpace memspace = view_memspace(view);
+        H5::DataSpace filespace = in_dataset_.getSpace();
+        transfer_pieces(grid_.comm(), view, file_offset(info), memspace, filespace, options_,
+            [&](const H5::DataSpace& mem, const H5::DataSpace& file) {
+                in_dataset_.read(buffer, H5::PredType::NATIVE_DOUBLE, mem, file, xfer_plist_);
+            });
+    }
+
+    void write_slab(const SlabInfo& info, const double* buffer) {
+        const StridedView7D view = slab_view(info, buffer);
+        H5::DataSpace memspace = view_memspace(view);
+        H5::DataSpace filespace = out_dataset_.getSpace();
+        transfer_pieces(grid_.comm(), view, file_offset(info), memspace, filespace, options_,
+            [&](const H5::DataSpace& mem, const H5::DataSpace& file) {
+                out_dataset_.write(buffer, H5::PredType::NATIVE_DOUBLE, mem, file, xfer_plist_);
+            });
+    }
+
+public:
+    SlabStream(const ProcessGrid& grid, SlabAxis axis, size_t thickness = 1,
+               const IoOptions& options = IoOptions())
+        : grid_(grid), axis_(axis), thickness_(std::max<size_t>(1, thickness)), options_(options) {
+        xfer_plist_.copy(make_dxpl(options_));
+    }
+
+    // 打开输入数据集, 本地块尺寸由文件和进程网格决定
+    void open_input(const std::string& filename, const std::string& dataset_name) {
+        in_file_.reset(new H5::H5File(filename, H5F_ACC_RDONLY, H5::FileCreatPropList::DEFAULT,
+                                      make_fapl(grid_.comm(), options_)));
+        in_dataset_ = in_file_->openDataSet(dataset_name);
+        H5::DataSpace space = in_dataset_.getSpace();
+        if (space.getSimpleExtentNdims() != 7) {
+            throw std::runtime_error("数据集维度不是7维");
+        }
+        std::array<hsize_t, 7> dims;
+        space.getSimpleExtentDims(dims.data(), nullptr);
+        set_local(dims);
+        has_input_ = true;
+    }
+
+    // 创建输出数据集; 有输入时沿用输入的尺寸, 否则使用给定的全局格子和Nc
+    void create_output(const std::string& filename, const std::string& dataset_name,
+                       const std::array<size_t, Nd>& lattice = {0, 0, 0, 0}, size_t Nc = 3) {
+        if (!has_input_) {
+            set_local({Array7D<double>::get_Ndim(), lattice[T_DIM], lattice[Z_DIM],
+                       lattice[Y_DIM], lattice[X_DIM], Nc, Nc * 2});
+        }
+        const std::array<hsize_t, 7> dims = {
+            local_[0], local_[1] * grid_.dim(T_DIM), local_[2] * grid_.dim(Z_DIM),
+            local_[3] * grid_.dim(Y_DIM), local_[4] * grid_.dim(X_DIM), local_[5], local_[6]
+        };
+        out_file_.reset(new H5::H5File(filename, H5F_ACC_TRUNC, H5::FileCreatPropList::DEFAULT,
+                                       make_fapl(grid_.comm(), options_)));
+        H5::DataSpace filespace(dims.size(), dims.data());
+        out_dataset_ = out_file_->createDataSet(dataset_name, H5::PredType::NATIVE_DOUBLE, filespace);
+        has_output_ = true;
+    }
+
+    // 本地块的尺寸 [dim, t, z, y, x, c1, 2*c2]
+    const std::array<hsize_t, 7>& local_dims() const { return local_; }
+
+    // 单片缓冲区的最大字节数
+    size_t slab_bytes() const { return slab(0).size() * sizeof(double); }
+
+    // 依次把每一片交给callback(const SlabInfo&, double* data)
+    // 有输入时data为读入的数据; 有输出时callback写入data的内容随后被写出
+    template <typename Callback>
+    void run(Callback&& callback) {
+        if (!has_input_ && !has_output_) {
+            throw std::runtime_error("流式传输没有输入也没有输出");
+        }
+        int provided;
+        MPI_Query_thread(&provided);
+        const bool overlap = provided >= MPI_THREAD_SERIALIZED;
+
+        const size_t n = slab_count();
+        const size_t nbuf = has_input_ && has_output_ ? 3 : 2;
+        std::vector<std::vector<double>> buffers(nbuf, std::vector<double>(slab(0).size()));
+
+        if (has_input_) read_slab(slab(0), buffers[0].data());
+        for (size_t k = 0; k < n; ++k) {
+            auto io = [&, k]() {
+                if (has_output_ && k > 0) write_slab(slab(k - 1), buffers[(k - 1) % nbuf].data());
+                if (has_input_ && k + 1 < n) read_slab(slab(k + 1), buffers[(k + 1) % nbuf].data());
+            };
+            std::future<void> pending;
+            if (overlap) {
+                pending = std::async(std::launch::async, io);
+            } else {
+                io();
+            }
+            callback(slab(k), buffers[k % nbuf].data());
+            if (pending.valid()) pending.get();
+        }
+        if (has_output_) write_slab(slab(n - 1), buffers[(n - 1) % nbuf].data());
+    }
+};
@@ -0,0 +1,315 @@
+#pragma once
+
+#include <H5Cpp.h>
+#include <mpi.h>
+#include <algorithm>
+#include <array>
+#include <climits>
+#include <complex>
+#include <memory>
+#include <string>
+#include <stdexcept>
+#include <vector>
+
+#include "grid.h"
+#include "lattice_io.h"
+#include "public.h"
+#include "trace.h"
+#include "memory_probe.h"
+
+// 读进程子集的重启读取: 只有少数进程 (默认每节点一个) 在子通信子上打开文件, 读进程在 t×z 上分块,
+// 各读一块 [4, t0:t1, z0:z1, Ly, Lx, Nc, 2*Nc], 每个 (mu, t) 是一段连续数据; 再按各进程的子格子拆开发送
+// 发送和接收都用MPI派生数据类型描述: 读进程从切片缓冲区中按子数组取出, 接收方直接落在Array7D的内部区域
+// (可以带ghost区), 不经过中间拷贝
+// 只在块有交集的读进程和接收进程之间收发, 每个进程只收到几条消息;
+// 用点对点消息而不是MPI_Alltoallw, 避免在大规模下每个进程都准备与进程数等长的参数数组
+// 与所有进程集体读相比: 打开文件的客户端数和元数据请求按每节点进程数成倍减少, 每次文件请求也更大;
+// 代价是读进程临时持有自己的块 (全局格子的1/读进程数), 以及一次节点间的数据重分布
+
+struct SubsetReadStats {
+    int readers = 0;            // 实际读文件的进程数
+    double read_seconds = 0;    // 打开文件并读切片
+    double scatter_seconds = 0; // 重分布
+    size_t slab_bytes = 0;      // 本进程读入的切片字节数
+};
+
+// 读进程在comm中的rank: readers为0时每个节点一个 (节点内rank最小的进程), 否则在comm中均匀取readers个
+inline std::vector<int> choose_readers(MPI_Comm comm, int readers) {
+    int rank, size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+    std::vector<int> result;
+    if (readers <= 0) {
+        MPI_Comm node_comm;
+        MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &node_comm);
+        int local_rank;
+        MPI_Comm_rank(node_comm, &local_rank);
+        MPI_Comm_free(&node_comm);
+        const int leader = local_rank == 0;
+        std::vector<int> flags(size);
+        MPI_Allgather(&leader, 1, MPI_INT, flags.data(), 1, MPI_INT, comm);
+        for (int r = 0; r < size; ++r) {
+            if (flags[r]) result.push_back(r);
+        }
+    } else {
+        readers = std::min(readers, size);
+        for (int k = 0; k < readers; ++k) result.push_back(static_cast<int>(static_cast<long long>(k) * size / readers));
+    }
+    return result;
+}
+
+// 命令行的读进程设置: "all"为所有进程集体读 (返回-1), "node"为每节点一个 (返回0), 否则为读进程数
+inline int parse_readers(const std::string& text) {
+    if (text == "all") return -1;
+    if (text == "node") return 0;
+    const int readers = std::stoi(text);
+    if (readers <= 0) throw std::runtime_error("读进程数必须为正: " + text);
+    return readers;
+}
+
+namespace detail {
+
+constexpr int kSubsetTag = 4807;
+
+// 读进程在 t×z 上的分块: 取 nt*nz <= readers 中块数最多的分法, 同样多时t方向分得多的优先
+// (只按t分时读进程多于Lt的部分会闲置, 每个读进程也要持有更大的块)
+struct ReaderBlocks {
+    hsize_t Lt, Lz;
+    size_t nt = 1, nz = 1;
+
+    ReaderBlocks(hsize_t lt, hsize_t lz, size_t readers) : Lt(lt), Lz(lz) {
+        for (size_t t = std::min<size_t>(readers, Lt); t >= 1; --t) {
+            const size_t z = std::min<size_t>(readers / t, Lz);
+            if (t * z > nt * nz) {
+                nt = t;
+                nz = z;
+            }
+        }
+    }
+    size_t used() const { return nt * nz; }
+    // 第k个读进程的块 [t0, t1) × [z0, z1)
+    std::array<hsize_t, 4> block(size_t k) const {
+        const size_t kt = k / nz, kz = k % nz;
+        return {Lt * kt / nt, Lt * (kt + 1) / nt, Lz * kz / nz, Lz * (kz + 1) / nz};
+    }
+};
+
+// 7维double数组 (最内两维合并) 中的子数组类型
+inline MPI_Datatype subset_type(const std::array<hsize_t, 6>& sizes, const std::array<hsize_t, 6>& subsizes,
+                                const std::array<hsize_t, 6>& starts) {
+    std::array<int, 6> s, sub, st;
+    for (int i = 0; i < 6; ++i) {
+        if (sizes[i] > INT_MAX) throw std::runtime_error("子数组尺寸超出MPI的int范围");
+        s[i] = static_cast<int>(sizes[i]);
+        sub[i] = static_cast<int>(subsizes[i]);
+        st[i] = static_cast<int>(starts[i]);
+    }
+    MPI_Datatype type;
+    MPI_Type_create_subarray(6, s.data(), sub.data(), st.data(), MPI_ORDER_C, MPI_DOUBLE, &type);
+    MPI_Type_commit(&type);
+    return type;
+}
+
+// 读进程打开文件得到全局尺寸后, 由prepare(dims)给出要填充的本地数组; 其余步骤见文件开头
+template <typename Prepare>
+inline SubsetReadStats subset_read(const ProcessGrid& grid, const std::string& filename,
+                                   const std::string& dataset_name, int readers, const IoOptions& options,
+                                   Prepare&& prepare) {
+    Hdf5Lock hdf5_lock;
+    SubsetReadStats stats;
+    const double read_start = MPI_Wtime();
+    const std::vector<int> reader_ranks = choose_readers(grid.comm(), readers);
+    const auto me = std::find(reader_ranks.begin(), reader_ranks.end(), grid.rank());
+    const bool is_reader = me != reader_ranks.end();
+    stats.readers = static_cast<int>(reader_ranks.size());
+    MPI_Comm reader_comm;
+    MPI_Comm_split(grid.comm(), is_reader ? 0 : MPI_UNDEFINED, grid.rank(), &reader_comm);
+
+    // 读进程报告错误后各进程一起抛出, 避免其余进程卡在后面的集体调用中
+    int failed = 0;
+    std::string error;
+    auto guarded = [&](auto&& step) {
+        try {
+            step();
+        } catch (const H5::Exception& e) {
+            failed = 1;
+            error = e.getCDetailMsg();
+        } catch (const std::exception& e) {
+            failed = 1;
+            error = e.what();
+        }
+    };
+    auto check = [&] {
+        MPI_Allreduce(MPI_IN_PLACE, &failed, 1, MPI_INT, MPI_MAX, grid.comm());
+        if (failed) {
+            if (reader_comm != MPI_COMM_NULL) MPI_Comm_free(&reader_comm);
+            throw std::runtime_error(error.empty() ? "读进程读取失败" : error);
+        }
+    };
+
+    // 只有读进程打开文件, 全局尺寸由第一个读进程广播
+    std::array<hsize_t, 7> dims = {0, 0, 0, 0, 0, 0, 0};
+    std::unique_ptr<H5::H5File> file;
+    H5::DataSet dataset;
+    if (is_reader) {
+        TraceScope scope("subset.open");
+        guarded([&] {
+            file.reset(new H5::H5File(filename, H5F_ACC_RDONLY, H5::FileCreatPropList::DEFAULT,
+                                      make_fapl(reader_comm, options)));
+            dataset = file->openDataSet(dataset_name);
+            dims = dataset_dims7d(dataset);
+        });
+    }
+    check();
+    MPI_Bcast(dims.data(), 7, MPI_UNSIGNED_LONG_LONG, reader_ranks.front(), grid.comm());
+
+    const auto local = grid.local_extent({dims[4], dims[3], dims[2], dims[1]});
+    Array7D<std::complex<double>>* target = nullptr;
+    guarded([&] {
+        target = &prepare(dims);
+        if (target->get_Lt() != local[T_DIM] || target->get_Lz() != local[Z_DIM] ||
+            target->get_Ly() != local[Y_DIM] || target->get_Lx() != local[X_DIM] ||
+            target->get_Nc() != dims[5] || dims[6] != 2 * dims[5]) {
+            throw std::runtime_error("本地数组尺寸与数据集不一致");
+        }
+    });
+    check();
+    const double target_bytes = static_cast<double>(target->storage_size()) * sizeof(std::complex<double>);
+
+    // 读进程按 t×z 均分全局格子; 分不到块的读进程只参与集体调用
+    const ReaderBlocks blocks(dims[1], dims[2], reader_ranks.size());
+    const size_t used = blocks.used();
+    std::vector<double> slab;
+    hsize_t my_t0 = 0, my_t1 = 0, my_z0 = 0, my_z1 = 0;
+    if (is_reader) {
+        TraceScope scope("subset.read");
+        guarded([&] {
+            const size_t k = me - reader_ranks.begin();
+            if (k < used) {
+                const auto b = blocks.block(k);
+                my_t0 = b[0];
+                my_t1 = b[1];
+                my_z0 = b[2];
+                my_z1 = b[3];
+                StridedView7D view;
+                view.count = dims;
+                view.count[1] = my_t1 - my_t0;
+                view.count[2] = my_z1 - my_z0;
+                view.extent = view.count;
+                view.offset.fill(0);
+                view.stride.fill(1);
+                size_t total = 1;
+                for (hsize_t c : view.count) total *= c;
+                slab.resize(total);
+                view.ptr = slab.data();
+                stats.slab_bytes = total * sizeof(double);
+
+                const std::array<hsize_t, 7> file_offset = {0, my_t0, my_z0, 0, 0, 0, 0};
+                H5::DataSpace memspace = view_memspace(view);
+                H5::DataSpace filespace = dataset.getSpace();
+                H5::DSetMemXferPropList xfer_plist = make_dxpl(options);
+                transfer_pieces(reader_comm, view, file_offset, memspace, filespace, options,
+                    [&](const H5::DataSpace& mem, const H5::DataSpace& space) {
+                        dataset.read(slab.data(), H5::PredType::NATIVE_DOUBLE, mem, space, xfer_plist);
+                        trace_mpio(xfer_plist, options.collective);
+                    });
+            } else {
+                read_nothing(reader_comm, dataset, options);
+            }
+            MemoryProbe::instance().sample("subset.read", file->getId(), target_bytes);
+            dataset.close();
+            file->close();
+        });
+    }
+    check();
+    // 非读进程也记一次样, 各进程的记样顺序保持一致
+    if (!is_reader) MemoryProbe::instance().sample("subset.read", H5I_INVALID_HID, target_bytes);
+    if (reader_comm != MPI_COMM_NULL) MPI_Comm_free(&reader_comm);
+    stats.read_seconds = MPI_Wtime() - read_start;
+
+    // 各进程子格子的全局偏移, 读进程据此切出要发送的部分
+    const double scatter_start = MPI_Wtime();
+    TraceScope scope("subset.scatter");
+    const auto offset = grid.local_offset(local);
+    const std::array<long long, Nd> my_offset = {
+        static_cast<long long>(offset[X_DIM]), static_cast<long long>(offset[Y_DIM]),
+        static_cast<long long>(offset[Z_DIM]), static_cast<long long>(offset[T_DIM])
+    };
+    std::vector<long long> offsets(Nd * grid.size());
+    MPI_Allgather(my_offset.data(), Nd, MPI_LONG_LONG, offsets.data(), Nd, MPI_LONG_LONG, grid.comm());
+
+    const hsize_t inner = dims[5] * dims[6];
+    const hsize_t lt = local[T_DIM], lz = local[Z_DIM];
+    std::vector<MPI_Request> requests;
+    std::vector<MPI_Datatype> types;
+
+    // 接收: 与本进程 t×z 范围有交集的读进程, 数据直接落进内部区域
+    const StridedView7D mine = make_view(*target);
+    for (size_t k = 0; k < used; ++k) {
+        const auto b = blocks.block(k);
+        const hsize_t lo = std::max<hsize_t>(b[0], offset[T_DIM]), hi = std::min<hsize_t>(b[1], offset[T_DIM] + lt);
+        const hsize_t zlo = std::max<hsize_t>(b[2], offset[Z_DIM]), zhi = std::min<hsize_t>(b[3], offset[Z_DIM] + lz);
+        if (lo >= hi || zlo >= zhi) continue;
+        const std::array<hsize_t, 6> sizes = {mine.extent[0], mine.extent[1], mine.extent[2], mine.extent[3],
+                                              mine.extent[4], inner};
+        const std::array<hsize_t, 6> subsizes = {dims[0], hi - lo, zhi - zlo, local[Y_DIM], local[X_DIM], inner};
+        const std::array<hsize_t, 6> starts = {0, mine.offset[1] + lo - offset[T_DIM],
+                                               mine.offset[2] + zlo - offset[Z_DIM], mine.offset[3],
+                                               mine.offset[4], 0};
+        types.push_back(subset_type(sizes, subsizes, starts));
+        requests.emplace_back();
+        MPI_Irecv(target->data_ptr(), 1, types.back(), reader_ranks[k], kSubsetTag, grid.comm(), &requests.back());
+    }
+
+    // 发送: 读进程把块中属于各进程的子数组发出
+    if (my_t1 > my_t0) {
+        const std::array<hsize_t, 6> sizes = {dims[0], my_t1 - my_t0, my_z1 - my_z0, dims[3], dims[4], inner};
+        for (int p = 0; p < grid.size(); ++p) {
+            const long long* o = &offsets[Nd * p];
+            const hsize_t lo = std::max<hsize_t>(my_t0, o[T_DIM]), hi = std::min<hsize_t>(my_t1, o[T_DIM] + lt);
+            const hsize_t zlo = std::max<hsize_t>(my_z0, o[Z_DIM]), zhi = std::min<hsize_t>(my_z1, o[Z_DIM] + lz);
+            if (lo >= hi || zlo >= zhi) continue;
+            const std::array<hsize_t, 6> subsizes = {dims[0], hi - lo, zhi - zlo, local[Y_DIM], local[X_DIM], inner};
+            const std::array<hsize_t, 6> starts = {0, lo - my_t0, zlo - my_z0,
+                                                   static_cast<hsize_t>(o[Y_DIM]), static_cast<hsize_t>(o[X_DIM]), 0};
+            types.push_back(subset_type(sizes, subsizes, starts));
+            requests.emplace_back();
+            MPI_Isend(slab.data(), 1, types.back(), p, kSubsetTag, grid.comm(), &requests.back());
+        }
+    }
+    MPI_Waitall(static_cast<int>(requests.size()), requests.data(), MPI_STATUSES_IGNORE);
+    for (MPI_Datatype& type : types) MPI_Type_free(&type);
+    stats.scatter_seconds = MPI_Wtime() - scatter_start;
+    MemoryProbe::instance().sample("subset.scatter", H5I_INVALID_HID, target_bytes);
+    return stats;
+}
+
+}  // namespace detail
+
+// 集体调用: 由readers个读进程读取数据集并分发到各进程已分配好的local_array, 尺寸必须与文件和进程网格一致
+inline SubsetReadStats read7d_subset(const ProcessGrid& grid, const std::string& filename,
+                                     const std::string& dataset_name, Array7D<std::complex<double>>& local_array,
+                                     int readers = 0, const IoOptions& options = IoOptions()) {
+    return detail::subset_read(grid, filename, dataset_name, readers, options,
+                               [&](const std::array<hsize_t, 7>&) -> Array7D<std::complex<double>>& {
+                                   return local_array;
+                               });
+}
+
+// 集体调用: 同上, 按文件中的尺寸分配本地数组; 只有读进程打开文件
+inline Array7D<std::complex<double>> read7d_subset(const ProcessGrid& grid, const std::string& filename,
+                                                   const std::string& dataset_name,
+                                                   const std::array<size_t, Nd>& ghost = {0, 0, 0, 0},
+                                                   int readers = 0, const IoOptions& options = IoOptions(),
+                                                   SubsetReadStats* stats = nullptr) {
+    Array7D<std::complex<double>> local_array(1, 1, 1, 1, 1);
+    const SubsetReadStats s = detail::subset_read(grid, filename, dataset_name, readers, options,
+        [&](const std::array<hsize_t, 7>& dims) -> Array7D<std::complex<double>>& {
+            const auto local = grid.local_extent({dims[4], dims[3], dims[2], dims[1]});
+            local_array = Array7D<std::complex<double>>(local[T_DIM], local[Z_DIM], local[Y_DIM], local[X_DIM],
+                                                        dims[5], ghost);
+            return local_array;
+        });
+    if (stats != nullptr) *stats = s;
+    return local_array;
+}
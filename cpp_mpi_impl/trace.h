@@ -0,0 +1,196 @@
+#pragma once
+
+#include <H5Cpp.h>
+#include <mpi.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <stdexcept>
+#include <vector>
+
+// 各进程I/O阶段的时间线, 合并后输出为Chrome trace JSON (chrome://tracing 或 Perfetto 打开)
+// 事件记录在预先分配的环中, 写入位置由原子计数器分配, 不加锁; 环满后覆盖最早的事件
+// 插桩总是编译进来, 未调用enable()时每个TraceScope只多一次原子读
+struct TraceEvent {
+    const char* name;     // 必须是字符串常量
+    double begin;         // 相对起点的秒数
+    double end;
+    unsigned tid;
+    char detail[80];
+};
+
+class Tracer {
+private:
+    std::vector<TraceEvent> ring_;
+    std::atomic<size_t> next_{0};
+    std::atomic<bool> enabled_{false};
+    double origin_ = 0;
+
+    static std::string escape(const char* text) {
+        std::string out;
+        for (const char* p = text; *p; ++p) {
+            if (*p == '"' || *p == '\\') out += '\\';
+            out += *p;
+        }
+        return out;
+    }
+
+public:
+    static Tracer& instance() {
+        static Tracer tracer;
+        return tracer;
+    }
+
+    // 每个线程的编号, 对应trace中的一条轨道
+    static unsigned thread_index() {
+        static std::atomic<unsigned> counter{0};
+        thread_local unsigned index = counter++;
+        return index;
+    }
+
+    // 集体调用: 各进程在同步点取时间起点, 使各轨道大致对齐
+    void enable(MPI_Comm comm, size_t capacity = size_t(1) << 16) {
+        ring_.assign(std::max<size_t>(1, capacity), TraceEvent());
+        next_ = 0;
+        MPI_Barrier(comm);
+        origin_ = MPI_Wtime();
+        enabled_ = true;
+    }
+
+    bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+    double now() const { return MPI_Wtime() - origin_; }
+
+    void record(const char* name, double begin, double end, const char* detail = nullptr) {
+        if (!enabled()) return;
+        TraceEvent& event = ring_[next_.fetch_add(1, std::memory_order_relaxed) % ring_.size()];
+        event.name = name;
+        event.begin = begin;
+        event.end = end;
+        event.tid = thread_index();
+        event.detail[0] = '\0';
+        if (detail != nullptr) {
+            std::strncpy(event.detail, detail, sizeof(event.detail) - 1);
+            event.detail[sizeof(event.detail) - 1] = '\0';
+        }
+    }
+
+    // 集体调用: 把各进程的事件汇总到rank 0并写成一个文件, 每个进程一个pid
+    // 调用时不能有其他线程仍在记录
+    void write(MPI_Comm comm, const std::string& filename) {
+        int rank, size;
+        MPI_Comm_rank(comm, &rank);
+        MPI_Comm_size(comm, &size);
+
+        std::string local;
+        char line[512];
+        std::snprintf(line, sizeof(line),
+                      "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"rank %d\"}},\n",
+                      rank, rank);
+        local += line;
+        const size_t n = std::min(next_.load(), ring_.size());
+        const size_t first = next_.load() - n;
+        if (first > 0 && rank == 0) {
+            std::fprintf(stderr, "trace: 环已满, 丢弃了最早的 %zu 个事件\n", first);
+        }
+        for (size_t i = first; i < first + n; ++i) {
+            const TraceEvent& event = ring_[i % ring_.size()];
+            std::snprintf(line, sizeof(line),
+                          "{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%u,"
+                          "\"args\":{\"detail\":\"%s\"}},\n",
+                          escape(event.name).c_str(), event.begin * 1e6, (event.end - event.begin) * 1e6,
+                          rank, event.tid, escape(event.detail).c_str());
+            local += line;
+        }
+
+        int length = static_cast<int>(local.size());
+        std::vector<int> lengths(size), displs(size);
+        MPI_Gather(&length, 1, MPI_INT, lengths.data(), 1, MPI_INT, 0, comm);
+        std::string merged;
+        if (rank == 0) {
+            int total = 0;
+            for (int r = 0; r < size; ++r) {
+                displs[r] = total;
+                total += lengths[r];
+            }
+            merged.resize(total);
+        }
+        MPI_Gatherv(local.data(), length, MPI_CHAR, rank == 0 ? &merged[0] : nullptr,
+                    lengths.data(), displs.data(), MPI_CHAR, 0, comm);
+
+        if (rank == 0) {
+            // 去掉最后一个逗号
+            if (merged.size() >= 2) merged.resize(merged.size() - 2);
+            std::ofstream out(filename);
+            out << "{\"traceEvents\":[\n" << merged << "\n],\"displayTimeUnit\":\"ms\"}\n";
+            if (!out) throw std::runtime_error("无法写trace文件: " + filename);
+        }
+    }
+};
+
+// 记录一个作用域的起止时间
+class TraceScope {
+private:
+    const char* name_;
+    double begin_;
+    bool active_;
+
+public:
+    explicit TraceScope(const char* name)
+        : name_(name), begin_(0), active_(Tracer::instance().enabled()) {
+        if (active_) begin_ = Tracer::instance().now();
+    }
+
+    ~TraceScope() { finish(); }
+
+    // 提前结束计时, 用于对象生存期必须长于计时范围的场合
+    void finish() {
+        if (active_) Tracer::instance().record(name_, begin_, Tracer::instance().now());
+        active_ = false;
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+};
+
+// 记录上一次数据传输实际使用的I/O方式, 以及没有走集体I/O的原因(本地/全局),
+// 让集体I/O悄悄退化为独立I/O的情况在时间线上可见
+// requested_collective为调用方请求的方式; 只有请求集体I/O而实际为独立I/O时才记为mpio.fallback,
+// 有意使用的独立I/O记为mpio.mode
+inline void trace_mpio(const H5::DSetMemXferPropList& xfer_plist, bool requested_collective) {
+    Tracer& tracer = Tracer::instance();
+    if (!tracer.enabled()) return;
+
+    H5D_mpio_actual_io_mode_t mode = H5D_MPIO_NO_COLLECTIVE;
+    uint32_t local_cause = 0, global_cause = 0;
+    H5Pget_mpio_actual_io_mode(xfer_plist.getId(), &mode);
+    H5Pget_mpio_no_collective_cause(xfer_plist.getId(), &local_cause, &global_cause);
+
+    const char* mode_name = "none";
+    switch (mode) {
+        case H5D_MPIO_NO_COLLECTIVE:         mode_name = "independent"; break;
+        case H5D_MPIO_CHUNK_INDEPENDENT:     mode_name = "chunk-independent"; break;
+        case H5D_MPIO_CHUNK_COLLECTIVE:      mode_name = "chunk-collective"; break;
+        case H5D_MPIO_CHUNK_MIXED:           mode_name = "chunk-mixed"; break;
+        case H5D_MPIO_CONTIGUOUS_COLLECTIVE: mode_name = "contiguous-collective"; break;
+    }
+    char detail[112];
+    std::snprintf(detail, sizeof(detail), "requested=%s mode=%s cause=0x%x global=0x%x",
+                  requested_collective ? "collective" : "independent", mode_name, local_cause, global_cause);
+    const double t = tracer.now();
+    const bool fallback = requested_collective && mode == H5D_MPIO_NO_COLLECTIVE;
+    tracer.record(fallback ? "mpio.fallback" : "mpio.mode", t, t, detail);
+}
+
+// 工具程序的 --trace=file.json 选项: 给出文件名时开启记录
+inline void trace_init(MPI_Comm comm, const std::string& filename) {
+    if (!filename.empty()) Tracer::instance().enable(comm);
+}
+
+inline void trace_finish(MPI_Comm comm, const std::string& filename) {
+    if (!filename.empty()) Tracer::instance().write(comm, filename);
+}
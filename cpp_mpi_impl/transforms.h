@@ -0,0 +1,177 @@
+#pragma once
+
+#include <H5Cpp.h>
+#include <algorithm>
+#include <array>
+#include <complex>
+#include <string>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "grid.h"
+#include "halo.h"
+#include "lattice_io.h"
+#include "public.h"
+#include "trace.h"
+
+// 读入规范场后对每个链接 U_mu(x) 做的变换, 每读入一个t切片块就在块还在缓存中时一遍做完:
+//   1. 边界相位: 跨越全局边界的链接 (x_mu = L_mu - 1) 乘以boundary_phase[mu], 时间方向反周期为 -1
+//   2. 规范变换: U_mu(x) -> g(x) U_mu(x) g(x + mu)^dagger
+//   3. 精度转换: 结果直接写入求解器精度的数组 (complex<float>或complex<double>)
+// 代替读入后对整个格子分别做的多遍处理, 读入之后的内存流量从多遍降到一遍
+// 用OpenMP在 (方向, t, z) 上并行, 不带规范变换时逐元素的乘法可以向量化
+struct LinkTransforms {
+    std::array<std::complex<double>, Nd> boundary_phase = {{1.0, 1.0, 1.0, 1.0}};
+    // g(x), 布局 [1, Lt, Lz, Ly, Lx, Nc, Nc], 正方向至少1层ghost且已交换 (见load_gauge_transform)
+    const LatticeField<std::complex<double>, 2>* gauge_transform = nullptr;
+};
+
+// 读取规范变换g(x), 数据集布局 [1, Lt, Lz, Ly, Lx, Nc, 2*Nc], 读入后交换ghost区
+inline LatticeField<std::complex<double>, 2> load_gauge_transform(const ProcessGrid& grid,
+                                                                  const std::string& filename,
+                                                                  const std::string& dataset_name,
+                                                                  const IoOptions& options = IoOptions()) {
+    Hdf5Lock hdf5_lock;
+    size_t Nc;
+    {
+        H5::H5File file = open7d(grid, filename, options);
+        const auto dims = dataset_dims7d(file.openDataSet(dataset_name));
+        if (dims[0] != 1 || dims[6] != 2 * dims[5]) {
+            throw std::runtime_error("规范变换数据集的尺寸应为 [1, Lt, Lz, Ly, Lx, Nc, 2*Nc]");
+        }
+        Nc = dims[5];
+    }
+    auto g = read_field<std::complex<double>, 2>(grid, filename, dataset_name, {Nc, Nc}, {1, 1, 1, 1}, options);
+    HaloExchange<std::complex<double>> halo(grid, g);
+    halo.exchange();
+    return g;
+}
+
+// 对slab中前nt个t切片的全部链接做变换, 写入out中从本地t_begin开始的对应位置
+// slab不带ghost区; global_offset/global_extent为本地子格子的全局偏移和全局格子尺寸
+template <typename Out>
+inline void apply_link_transforms(const LinkTransforms& transforms, const Array7D<std::complex<double>>& slab,
+                                  size_t nt, size_t t_begin,
+                                  const std::array<size_t, Nd>& global_offset,
+                                  const std::array<size_t, Nd>& global_extent,
+                                  Array7D<std::complex<Out>>& out) {
+    const size_t Nc = slab.get_Nc();
+    const size_t n = Nc * Nc;
+    const size_t lz = slab.get_Lz(), ly = slab.get_Ly(), lx = slab.get_Lx();
+    const LatticeField<std::complex<double>, 2>* g = transforms.gauge_transform;
+    const long long outer = static_cast<long long>(Nd * nt * lz);
+
+    #pragma omp parallel
+    {
+        std::vector<std::complex<double>> tmp(n);
+        #pragma omp for schedule(static)
+        for (long long idx = 0; idx < outer; ++idx) {
+            const size_t mu = idx / (nt * lz);
+            const size_t ts = idx / lz % nt;
+            const size_t z = idx % lz;
+            const size_t t = t_begin + ts;
+            for (size_t y = 0; y < ly; ++y) {
+                for (size_t x = 0; x < lx; ++x) {
+                    const std::array<size_t, Nd> local = {x, y, z, t};
+                    const bool boundary = global_offset[mu] + local[mu] == global_extent[mu] - 1;
+                    const std::complex<double> phase = boundary ? transforms.boundary_phase[mu] : 1.0;
+                    const std::complex<double>* u = slab.site_ptr(mu, ts, z, y, x);
+                    std::complex<Out>* dst = out.site_ptr(mu, t, z, y, x);
+
+                    if (g == nullptr) {
+                        #pragma omp simd
+                        for (size_t i = 0; i < n; ++i) dst[i] = static_cast<std::complex<Out>>(phase * u[i]);
+                        continue;
+                    }
+
+                    // tmp = g(x) U, 再乘 g(x + mu)^dagger, 边界相位在最后一步一起乘上
+                    const std::array<std::ptrdiff_t, Nd> hop = {
+                        static_cast<std::ptrdiff_t>(x + (mu == X_DIM)), static_cast<std::ptrdiff_t>(y + (mu == Y_DIM)),
+                        static_cast<std::ptrdiff_t>(z + (mu == Z_DIM)), static_cast<std::ptrdiff_t>(t + (mu == T_DIM))
+                    };
+                    const std::complex<double>* gx = g->site_ptr(0, t, z, y, x);
+                    const std::complex<double>* gy = &g->halo(0, hop[T_DIM], hop[Z_DIM], hop[Y_DIM], hop[X_DIM], 0, 0);
+                    for (size_t a = 0; a < Nc; ++a) {
+                        for (size_t b = 0; b < Nc; ++b) {
+                            std::complex<double> sum = 0;
+                            for (size_t c = 0; c < Nc; ++c) sum += gx[a * Nc + c] * u[c * Nc + b];
+                            tmp[a * Nc + b] = sum;
+                        }
+                    }
+                    for (size_t a = 0; a < Nc; ++a) {
+                        for (size_t b = 0; b < Nc; ++b) {
+                            std::complex<double> sum = 0;
+                            for (size_t c = 0; c < Nc; ++c) sum += tmp[a * Nc + c] * std::conj(gy[b * Nc + c]);
+                            dst[a * Nc + b] = static_cast<std::complex<Out>>(phase * sum);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+// 按t切片块读取规范场并在每块读入后立即做变换, 结果写入out的内部区域
+// 每块约slab_bytes (至少一个t切片), 读入不带ghost区的暂存块, 块内再按max_transfer_bytes拆分;
+// 本地尺寸在各进程相同, 所以各进程的块数一致, 集体调用次数相同
+template <typename Out>
+inline void read7d_fused(const ProcessGrid& grid, const H5::DataSet& dataset,
+                         Array7D<std::complex<Out>>& out, const LinkTransforms& transforms,
+                         const IoOptions& options = IoOptions(), size_t slab_bytes = 8 << 20) {
+    static_assert(std::is_same<Out, float>::value || std::is_same<Out, double>::value,
+                  "输出精度必须是float或double");
+    const auto dims = dataset_dims7d(dataset);
+    const std::array<size_t, Nd> global = {dims[4], dims[3], dims[2], dims[1]};
+    const auto local = grid.local_extent(global);
+    const auto offset_local = grid.local_offset(local);
+    const size_t Nc = dims[5];
+    if (out.get_Lt() != local[T_DIM] || out.get_Lz() != local[Z_DIM] || out.get_Ly() != local[Y_DIM] ||
+        out.get_Lx() != local[X_DIM] || out.get_Nc() != Nc || dims[0] != Nd || dims[6] != 2 * Nc) {
+        throw std::runtime_error("本地数组尺寸与数据集不一致");
+    }
+    const auto* g = transforms.gauge_transform;
+    if (g != nullptr && (g->get_Lt() != local[T_DIM] || g->get_Lz() != local[Z_DIM] ||
+                         g->get_Ly() != local[Y_DIM] || g->get_Lx() != local[X_DIM] ||
+                         g->get_inner(0) != Nc || g->get_ghost(X_DIM) == 0 || g->get_ghost(Y_DIM) == 0 ||
+                         g->get_ghost(Z_DIM) == 0 || g->get_ghost(T_DIM) == 0)) {
+        throw std::runtime_error("规范变换的尺寸与规范场不一致或缺少ghost区");
+    }
+
+    const size_t slice_bytes = Nd * local[Z_DIM] * local[Y_DIM] * local[X_DIM] * Nc * Nc
+                             * sizeof(std::complex<double>);
+    const size_t slab_t = std::max<size_t>(1, std::min(local[T_DIM], slab_bytes / slice_bytes));
+    Array7D<std::complex<double>> slab(slab_t, local[Z_DIM], local[Y_DIM], local[X_DIM], Nc);
+
+    H5::DataSpace filespace = dataset.getSpace();
+    H5::DSetMemXferPropList xfer_plist = make_dxpl(options);
+    double* buffer = reinterpret_cast<double*>(slab.data_ptr());
+
+    for (size_t t0 = 0; t0 < local[T_DIM]; t0 += slab_t) {
+        const size_t nt = std::min(slab_t, local[T_DIM] - t0);
+        StridedView7D view = make_view(slab);
+        view.count[1] = nt;
+        const std::array<hsize_t, 7> file_offset = {
+            0, offset_local[T_DIM] + t0, offset_local[Z_DIM], offset_local[Y_DIM], offset_local[X_DIM], 0, 0
+        };
+        H5::DataSpace memspace = view_memspace(view);
+        transfer_pieces(grid.comm(), view, file_offset, memspace, filespace, options,
+            [&](const H5::DataSpace& mem, const H5::DataSpace& file) {
+                dataset.read(buffer, H5::PredType::NATIVE_DOUBLE, mem, file, xfer_plist);
+                trace_mpio(xfer_plist, options.collective);
+            });
+
+        TraceScope scope("transform");
+        apply_link_transforms(transforms, slab, nt, t0, offset_local, global, out);
+    }
+}
+
+// 按文件名读取, out需要预先按本地尺寸分配 (可以带ghost区)
+template <typename Out>
+inline void read7d_fused(const ProcessGrid& grid, const std::string& filename, const std::string& dataset_name,
+                         Array7D<std::complex<Out>>& out, const LinkTransforms& transforms,
+                         const IoOptions& options = IoOptions(), size_t slab_bytes = 8 << 20) {
+    Hdf5Lock hdf5_lock;
+    H5::H5File file = open7d(grid, filename, options);
+    read7d_fused(grid, file.openDataSet(dataset_name), out, transforms, options, slab_bytes);
+}
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <mpi.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <complex>
+#include <stdexcept>
+#include <vector>
+
+#include "grid.h"
+#include "halo.h"
+#include "public.h"
+#include "trace.h"
+
+// 规范场的物理检查, 读入后整体算一遍:
+//   平均plaquette: 每个格点6个平面上 Re tr(U_mu(x) U_nu(x+mu) U_mu(x+nu)^dagger U_nu(x)^dagger) / Nc 的平均
+//   幺正性偏差: 所有链接上 max |U^dagger U - 1| (逐元素绝对值的最大值)
+//   各方向的范数: sum |U|_F^2 / (Nc * 格点数), 幺正矩阵为1
+// 各进程的部分和用一次MPI_Reduce (求和与取最大值合在一个自定义操作中) 汇总到rank 0
+struct GaugeSummary {
+    double plaquette = 0;
+    double max_unitarity = 0;
+    std::array<double, Nd> norm = {0, 0, 0, 0};
+    double sites = 0;
+};
+
+namespace detail {
+
+// 归约的缓冲区: [plaquette和, 幺正性偏差最大值, 4个方向的范数和, 格点数]
+constexpr int kSummaryFields = 3 + Nd;
+constexpr int kSummaryMax = 1;
+
+inline void reduce_summary(void* in, void* inout, int* len, MPI_Datatype*) {
+    const double* a = static_cast<const double*>(in);
+    double* b = static_cast<double*>(inout);
+    for (int n = 0; n < *len; ++n, a += kSummaryFields, b += kSummaryFields) {
+        for (int i = 0; i < kSummaryFields; ++i) {
+            b[i] = i == kSummaryMax ? std::max(a[i], b[i]) : a[i] + b[i];
+        }
+    }
+}
+
+// c = a * b, Nc * Nc行主序
+inline void mat_mul(const std::complex<double>* a, const std::complex<double>* b, std::complex<double>* c,
+                    size_t Nc) {
+    for (size_t i = 0; i < Nc; ++i) {
+        for (size_t j = 0; j < Nc; ++j) {
+            std::complex<double> sum = 0;
+            for (size_t k = 0; k < Nc; ++k) sum += a[i * Nc + k] * b[k * Nc + j];
+            c[i * Nc + j] = sum;
+        }
+    }
+}
+
+}  // namespace detail
+
+// 集体调用, 结果只在rank 0有效; u的各方向都需要至少1层ghost区, 函数内部做面交换,
+// 幺正性和范数只用内部区域, 与面交换重叠计算; plaquette在交换完成后计算
+inline GaugeSummary validate_gauge(const ProcessGrid& grid, Array7D<std::complex<double>>& u) {
+    for (int d = 0; d < Nd; ++d) {
+        if (u.get_ghost(d) == 0) throw std::runtime_error("计算plaquette需要各方向至少1层ghost区");
+    }
+    const size_t Nc = u.get_Nc(), n = Nc * Nc;
+    const size_t lt = u.get_Lt(), lz = u.get_Lz(), ly = u.get_Ly(), lx = u.get_Lx();
+    const long long slices = static_cast<long long>(lt * lz);
+
+    HaloExchange<std::complex<double>> halo(grid, u);
+    halo.start();
+
+    double local[detail::kSummaryFields] = {0};
+    {
+        TraceScope scope("validate.unitarity");
+        double max_unitarity = 0;
+        double norm[Nd] = {0, 0, 0, 0};
+        #pragma omp parallel for reduction(max : max_unitarity) reduction(+ : norm[:Nd])
+        for (long long idx = 0; idx < slices; ++idx) {
+            const size_t t = idx / lz, z = idx % lz;
+            for (size_t mu = 0; mu < Nd; ++mu) {
+                for (size_t y = 0; y < ly; ++y) {
+                    for (size_t x = 0; x < lx; ++x) {
+                        const std::complex<double>* link = u.site_ptr(mu, t, z, y, x);
+                        double frob = 0;
+                        #pragma omp simd reduction(+ : frob)
+                        for (size_t k = 0; k < n; ++k) frob += std::norm(link[k]);
+                        norm[mu] += frob;
+                        // (U^dagger U)_{ij} = sum_k conj(U_ki) U_kj
+                        for (size_t i = 0; i < Nc; ++i) {
+                            for (size_t j = 0; j < Nc; ++j) {
+                                std::complex<double> sum = i == j ? -1.0 : 0.0;
+                                for (size_t k = 0; k < Nc; ++k) sum += std::conj(link[k * Nc + i]) * link[k * Nc + j];
+                                max_unitarity = std::max(max_unitarity, std::abs(sum));
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        local[1] = max_unitarity;
+        for (int mu = 0; mu < Nd; ++mu) local[2 + mu] = norm[mu];
+        local[2 + Nd] = static_cast<double>(lt * lz * ly * lx);
+    }
+
+    {
+        TraceScope scope("halo.wait");
+        halo.wait();
+    }
+
+    {
+        TraceScope scope("validate.plaquette");
+        double plaquette = 0;
+        #pragma omp parallel reduction(+ : plaquette)
+        {
+            std::vector<std::complex<double>> a(n), b(n);
+            #pragma omp for
+            for (long long idx = 0; idx < slices; ++idx) {
+                const std::ptrdiff_t t = idx / lz, z = idx % lz;
+                for (std::ptrdiff_t y = 0; y < static_cast<std::ptrdiff_t>(ly); ++y) {
+                    for (std::ptrdiff_t x = 0; x < static_cast<std::ptrdiff_t>(lx); ++x) {
+                        const std::array<std::ptrdiff_t, Nd> site = {x, y, z, t};
+                        auto link = [&](size_t dir, size_t hop) {
+                            std::array<std::ptrdiff_t, Nd> s = site;
+                            if (hop < Nd) ++s[hop];
+                            return &u.halo(dir, s[T_DIM], s[Z_DIM], s[Y_DIM], s[X_DIM], 0, 0);
+                        };
+                        for (size_t mu = 0; mu < Nd; ++mu) {
+                            for (size_t nu = mu + 1; nu < Nd; ++nu) {
+                                // a = U_mu(x) U_nu(x+mu), b = U_nu(x) U_mu(x+nu), tr(a b^dagger)
+                                detail::mat_mul(link(mu, Nd), link(nu, mu), a.data(), Nc);
+                                detail::mat_mul(link(nu, Nd), link(mu, nu), b.data(), Nc);
+                                double trace = 0;
+                                #pragma omp simd reduction(+ : trace)
+                                for (size_t k = 0; k < n; ++k) trace += (a[k] * std::conj(b[k])).real();
+                                plaquette += trace / Nc;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        local[0] = plaquette;
+    }
+
+    MPI_Datatype summary_type;
+    MPI_Type_contiguous(detail::kSummaryFields, MPI_DOUBLE, &summary_type);
+    MPI_Type_commit(&summary_type);
+    MPI_Op op;
+    MPI_Op_create(&detail::reduce_summary, 1, &op);
+    double total[detail::kSummaryFields] = {0};
+    {
+        TraceScope scope("validate.reduce");
+        MPI_Reduce(local, total, 1, summary_type, op, 0, grid.comm());
+    }
+    MPI_Op_free(&op);
+    MPI_Type_free(&summary_type);
+
+    GaugeSummary summary;
+    summary.sites = total[2 + Nd];
+    if (summary.sites > 0) {
+        summary.plaquette = total[0] / (summary.sites * Nd * (Nd - 1) / 2);
+        summary.max_unitarity = total[1];
+        for (int mu = 0; mu < Nd; ++mu) summary.norm[mu] = total[2 + mu] / (summary.sites * Nc);
+    }
+    return summary;
+}